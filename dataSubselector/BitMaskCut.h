@@ -12,6 +12,10 @@
 #ifndef dataSubselector_BitMaskCut_h
 #define dataSubselector_BitMaskCut_h
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "dataSubselector/CutBase.h"
 
 namespace dataSubselector {
@@ -25,9 +29,18 @@ class BitMaskCut : public CutBase {
 
 public:
 
+   /// @brief Immutable snapshot of the EVENT_CLASS and EVENT_TYPE
+   /// validity masks read from a pair of validity mask files.
+   class ValidityMasks;
+
+   typedef std::shared_ptr<const ValidityMasks> ValidityMasksPtr;
+
+   /// @param masks Validity masks used by supercedes().  If null,
+   ///        the current process-wide masks are used.
    BitMaskCut(const std::string & colname,
               unsigned int mask,
-              const std::string & pass_ver="");
+              const std::string & pass_ver="",
+              const ValidityMasksPtr & masks=ValidityMasksPtr());
 
    virtual ~BitMaskCut() {}
 
@@ -35,6 +48,11 @@ public:
 
    virtual bool accept(const std::map<std::string, double> & params) const;
 
+   /// @brief True if any of the masked bits are set in the value.
+   bool accept(unsigned int value) const {
+      return (value & m_mask) != 0;
+   }
+
    virtual CutBase * clone() const {return new BitMaskCut(*this);}
 
    virtual bool supercedes(const CutBase & cut) const;
@@ -57,16 +75,35 @@ public:
 
    static bool post_P7(const std::string & pass_ver);
 
+   /// @brief Read the validity mask files and make them the current
+   /// process-wide masks.  Cuts created previously keep the masks
+   /// that were current when they were constructed.
    static void setValidityMasks(const std::string & evclassFile,
                                 const std::string & evtypeFile);
 
-   static const void * evclassValidityMasks() {
-      return s_evclassPrecedence;
-   }
+   /// @brief Make the given masks the current process-wide masks.
+   static void setValidityMasks(const ValidityMasksPtr & masks);
 
-   static const void * evtypeValidityMasks() {
-      return s_evtypePrecedence;
-   }
+   /// @return The current process-wide masks (may be null).  This
+   /// is safe to call concurrently with setValidityMasks.
+   static ValidityMasksPtr validityMasks();
+
+   /// @return The masks from the valid_ev*_selections.txt files
+   /// under the given CALDB root.  Each root is read only once.
+   static ValidityMasksPtr caldbValidityMasks(const std::string & caldb);
+
+   /// @brief If no masks have been set, use those from $CALDB.  Only
+   /// the first call does any work.
+   static void initValidityMasks();
+
+   /// @return The current process-wide event class masks, or null
+   /// if none have been set.  The pointer is valid only until the
+   /// masks are replaced; validityMasks() keeps them alive.
+   static const void * evclassValidityMasks();
+
+   /// @return The current process-wide event type masks, or null
+   /// if none have been set.
+   static const void * evtypeValidityMasks();
 
 protected:
 
@@ -85,7 +122,9 @@ private:
 
    bool m_post_P7;
 
-   bool accept(unsigned int value) const;
+   ValidityMasksPtr m_validityMasks;
+
+   ValidityMasksPtr currentValidityMasks() const;
 
    class BitMaskPrecedence {
 
@@ -103,14 +142,37 @@ private:
 
       std::string m_maskFile;
 
-      std::map<unsigned int, unsigned int> m_validityMasks;
-      
+      /// (bit mask, validity mask) pairs, sorted on bit mask.
+      std::vector<std::pair<unsigned int, unsigned int> > m_validityMasks;
+
 
    };
 
-   static BitMaskPrecedence * s_evclassPrecedence;
+   static ValidityMasksPtr s_validityMasks;
+
+};
+
+class BitMaskCut::ValidityMasks {
+
+public:
+
+   ValidityMasks(const std::string & evclassFile,
+                 const std::string & evtypeFile)
+      : m_evclass(evclassFile), m_evtype(evtypeFile) {}
+
+   const BitMaskPrecedence & evclass() const {
+      return m_evclass;
+   }
+
+   const BitMaskPrecedence & evtype() const {
+      return m_evtype;
+   }
+
+private:
+
+   const BitMaskPrecedence m_evclass;
 
-   static BitMaskPrecedence * s_evtypePrecedence;
+   const BitMaskPrecedence m_evtype;
 
 };
 
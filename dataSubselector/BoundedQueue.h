@@ -0,0 +1,104 @@
+/**
+ * @file BoundedQueue.h
+ * @brief A fixed-capacity FIFO queue for passing work between threads.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_BoundedQueue_h
+#define dataSubselector_BoundedQueue_h
+
+#include <cstddef>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+
+namespace dataSubselector {
+
+/**
+ * @class BoundedQueue
+ * @brief A FIFO queue connecting the stages of a pipeline.  push()
+ * blocks while the queue is full, so a fast producer cannot run
+ * arbitrarily far ahead of its consumers, and pop() blocks while the
+ * queue is empty.  Once close() is called, push() fails and pop()
+ * returns the remaining items and then fails, so consumers can drain
+ * the queue and exit.
+ */
+
+template <typename T>
+class BoundedQueue {
+
+public:
+
+   explicit BoundedQueue(size_t capacity) : m_capacity(capacity),
+                                            m_closed(false) {
+      if (capacity == 0) {
+         throw std::runtime_error("BoundedQueue: capacity must be positive.");
+      }
+   }
+
+   /// @brief Add an item, waiting for space if the queue is full.
+   /// @return False if the queue has been closed, in which case the
+   ///         item is not added.
+   bool push(const T & item) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (!m_closed && m_items.size() >= m_capacity) {
+         m_notFull.wait(lock);
+      }
+      if (m_closed) {
+         return false;
+      }
+      m_items.push_back(item);
+      m_notEmpty.notify_one();
+      return true;
+   }
+
+   /// @brief Remove the oldest item, waiting for one if the queue is
+   ///        empty.
+   /// @return False if the queue is closed and empty.
+   bool pop(T & item) {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      while (!m_closed && m_items.empty()) {
+         m_notEmpty.wait(lock);
+      }
+      if (m_items.empty()) {
+         return false;
+      }
+      item = m_items.front();
+      m_items.pop_front();
+      m_notFull.notify_one();
+      return true;
+   }
+
+   /// @brief Stop accepting items and wake all waiting threads.
+   void close() {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+      m_notFull.notify_all();
+      m_notEmpty.notify_all();
+   }
+
+   size_t capacity() const {
+      return m_capacity;
+   }
+
+private:
+
+   size_t m_capacity;
+
+   bool m_closed;
+
+   std::deque<T> m_items;
+
+   std::mutex m_mutex;
+   std::condition_variable m_notFull;
+   std::condition_variable m_notEmpty;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_BoundedQueue_h
@@ -0,0 +1,80 @@
+/**
+ * @file ChunkScheduler.h
+ * @brief Apply a task to numbered chunks of work using a pool of
+ * threads that steal work from each other.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_ChunkScheduler_h
+#define dataSubselector_ChunkScheduler_h
+
+#include <cstddef>
+
+#include <functional>
+#include <vector>
+
+namespace dataSubselector {
+
+/**
+ * @class ChunkScheduler
+ * @brief Each thread starts with a contiguous block of the chunk
+ * numbers, which it processes from the front.  A thread that runs out
+ * of work steals chunks from the back of another thread's block, so
+ * uneven chunk costs, e.g., from a cut that rejects most of one part
+ * of a file, do not leave threads idle.
+ *
+ * Since chunks may be processed in any order, a task that produces a
+ * variable number of results per chunk should count them first; the
+ * prefix sums of the counts then give the offset of each chunk's
+ * results in the combined output.
+ */
+
+class ChunkScheduler {
+
+public:
+
+   /// @param chunk The chunk number.
+   /// @param thread The number of the thread running the task, in
+   ///        [0, numThreads()), e.g., for indexing per-thread buffers.
+   typedef std::function<void (size_t chunk, unsigned int thread)> Task_t;
+
+   /// @param nthreads The number of threads.  The calling thread is
+   ///        used if this is 1.
+   explicit ChunkScheduler(unsigned int nthreads);
+
+   /// @brief Apply the task to chunks 0 through nchunks - 1, each
+   ///        exactly once, and wait for them to finish.  If a task
+   ///        throws, the remaining chunks are abandoned and the first
+   ///        exception is rethrown.
+   void run(size_t nchunks, const Task_t & task);
+
+   unsigned int numThreads() const {
+      return m_nthreads;
+   }
+
+   /// @brief The number of chunks taken from another thread's block
+   ///        in the last call to run().
+   size_t numSteals() const {
+      return m_numSteals;
+   }
+
+   /// @brief Exclusive prefix sums.
+   /// @param counts The number of results from each chunk.
+   /// @param offsets Set to the offset of the results of each chunk,
+   ///        followed by the total.
+   static void prefixSums(const std::vector<size_t> & counts,
+                          std::vector<size_t> & offsets);
+
+private:
+
+   unsigned int m_nthreads;
+
+   size_t m_numSteals;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_ChunkScheduler_h
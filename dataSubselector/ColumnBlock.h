@@ -0,0 +1,70 @@
+/**
+ * @file ColumnBlock.h
+ * @brief A block of events stored column-wise, for evaluating cuts
+ * on many events at once.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_ColumnBlock_h
+#define dataSubselector_ColumnBlock_h
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+namespace dataSubselector {
+
+/**
+ * @class ColumnBlock
+ * @brief Non-owning view of per-column arrays of event data, keyed
+ * by the column names used in the DSS keywords, e.g., "ENERGY" or
+ * "CALIB_VERSION[1]".  Integer-valued columns such as EVENT_CLASS
+ * are passed as doubles, as for Cuts::accept(params).
+ */
+
+class ColumnBlock {
+
+public:
+
+   ColumnBlock(size_t nevents) : m_nevents(nevents) {}
+
+   /// @brief Add a column.  The array must hold size() values and
+   ///        outlive this object.
+   void addColumn(const std::string & colname, const double * values) {
+      m_columns[colname] = values;
+   }
+
+   bool hasColumn(const std::string & colname) const {
+      return m_columns.count(colname) != 0;
+   }
+
+   /// @return The values for the named column, or 0 if it is absent.
+   ///        As with Cuts::accept(params), cuts on absent columns
+   ///        are passed.
+   const double * column(const std::string & colname) const {
+      std::map<std::string, const double *>::const_iterator it
+         = m_columns.find(colname);
+      if (it == m_columns.end()) {
+         return 0;
+      }
+      return it->second;
+   }
+
+   /// @brief The number of events.
+   size_t size() const {
+      return m_nevents;
+   }
+
+private:
+
+   size_t m_nevents;
+
+   std::map<std::string, const double *> m_columns;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_ColumnBlock_h
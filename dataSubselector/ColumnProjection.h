@@ -0,0 +1,95 @@
+/**
+ * @file ColumnProjection.h
+ * @brief Write a subset of the columns of an event table.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_ColumnProjection_h
+#define dataSubselector_ColumnProjection_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dataSubselector {
+
+class Cuts;
+
+/**
+ * @class ColumnProjection
+ * @brief The columns of an event table to be written by gtselect.
+ * Rows copied as raw bytes are projected by packing the bytes of the
+ * kept columns, and the other columns are removed from the output
+ * table while it is still empty, so that rows copied by tip need only
+ * be written once.  The header keywords, including the DSS keywords,
+ * are unaffected, so the columns of the range cuts written to the
+ * output must be kept; see addCutColumns.
+ */
+
+class ColumnProjection {
+
+public:
+
+   /// @param fitsFile The input event file.
+   /// @param extension The event table extension name.
+   /// @param colnames The columns to keep.  An empty list keeps all
+   ///        of the columns.
+   ColumnProjection(const std::string & fitsFile, const std::string & extension,
+                    const std::vector<std::string> & colnames);
+
+   /// @brief False if all of the columns are kept.
+   bool active() const {
+      return !m_dropped.empty();
+   }
+
+   long inputRowSize() const {
+      return m_inputRowSize;
+   }
+
+   long outputRowSize() const {
+      return m_outputRowSize;
+   }
+
+   /// @brief Pack the kept columns of consecutive rows.  The output
+   ///        may be the same buffer as the input.
+   /// @param input The raw bytes of nrows input rows.
+   /// @param nrows The number of rows.
+   /// @param output The nrows*outputRowSize() projected bytes.
+   void project(const unsigned char * input, long nrows,
+                unsigned char * output) const;
+
+   /// @brief Remove the other columns from a table with the same
+   ///        layout as the input table.
+   void removeColumns(const std::string & fitsFile,
+                      const std::string & extension) const;
+
+   /// @brief Split a list of column names separated by commas or
+   ///        spaces.  "all" gives an empty list.
+   static void parseColumns(const std::string & columns,
+                            std::vector<std::string> & colnames);
+
+   /// @brief Add the columns of the range cuts in cuts to a
+   ///        non-empty list of columns to keep.  Cuts read from the
+   ///        DSS keywords of a table check that these columns
+   ///        exist.  Vector elements, e.g., CALIB_VERSION[1], keep
+   ///        the whole column.
+   static void addCutColumns(const Cuts & cuts,
+                             std::vector<std::string> & colnames);
+
+private:
+
+   long m_inputRowSize;
+   long m_outputRowSize;
+
+   /// The offsets and widths of the runs of adjacent kept columns.
+   std::vector<std::pair<long, long> > m_segments;
+
+   std::vector<std::string> m_dropped;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_ColumnProjection_h
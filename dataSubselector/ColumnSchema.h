@@ -0,0 +1,84 @@
+/**
+ * @file ColumnSchema.h
+ * @brief Assign integer slots to column names so that event values
+ * can be passed as flat arrays.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_ColumnSchema_h
+#define dataSubselector_ColumnSchema_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace dataSubselector {
+
+/**
+ * @class ColumnSchema
+ * @brief An ordered set of column names, e.g., "ENERGY", "RA", or
+ * "CALIB_VERSION[1]".  The n-th registered column occupies slot n
+ * of the per-event value arrays passed to SchemaCuts.
+ */
+
+class ColumnSchema {
+
+public:
+
+   ColumnSchema() {}
+
+   ColumnSchema(const std::vector<std::string> & colnames) {
+      for (size_t i(0); i < colnames.size(); i++) {
+         addColumn(colnames[i]);
+      }
+   }
+
+   /// @brief Register a column.
+   /// @return The slot for this column.  If the column is already
+   ///         registered, its existing slot is returned.
+   unsigned int addColumn(const std::string & colname) {
+      std::map<std::string, unsigned int>::const_iterator it
+         = m_slots.find(colname);
+      if (it != m_slots.end()) {
+         return it->second;
+      }
+      unsigned int slot(m_colnames.size());
+      m_colnames.push_back(colname);
+      m_slots[colname] = slot;
+      return slot;
+   }
+
+   /// @return True if the column is registered, in which case its
+   ///         slot is returned in the second argument.
+   bool slot(const std::string & colname, unsigned int & slot) const {
+      std::map<std::string, unsigned int>::const_iterator it
+         = m_slots.find(colname);
+      if (it == m_slots.end()) {
+         return false;
+      }
+      slot = it->second;
+      return true;
+   }
+
+   const std::string & colname(unsigned int slot) const {
+      return m_colnames.at(slot);
+   }
+
+   /// @brief The number of registered columns.
+   size_t size() const {
+      return m_colnames.size();
+   }
+
+private:
+
+   std::vector<std::string> m_colnames;
+
+   std::map<std::string, unsigned int> m_slots;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_ColumnSchema_h
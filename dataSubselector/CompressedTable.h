@@ -0,0 +1,248 @@
+/**
+ * @file CompressedTable.h
+ * @brief Tile-compressed event tables, for writing compact filtered
+ * event files and reading them back.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_CompressedTable_h
+#define dataSubselector_CompressedTable_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tip/tip_types.h"
+
+namespace tip {
+   class Header;
+}
+
+namespace dataSubselector {
+
+class ColumnProjection;
+class ColumnSchema;
+class Cuts;
+class SchemaCuts;
+
+/**
+ * @class CompressedTable
+ * @brief Read access to an event table that may be stored as a FITS
+ * tile-compressed binary table (ZTABLE = T).  The columns of such a
+ * table are compressed in tiles of rows using cfitsio's default
+ * algorithms, i.e., Rice for integer columns and byte-shuffled gzip
+ * (GZIP_2) for floating point columns, and the header keywords,
+ * including the DSS keywords, are kept.
+ *
+ * cfitsio cannot read the rows of a compressed table in place, so
+ * the tiles holding the rows requested are uncompressed into a
+ * cfitsio memory file, along with the other HDUs of the file, e.g.,
+ * for gtifilter().  Only those tiles are held in memory, and they
+ * are kept until rows of other tiles are requested, so reading the
+ * table in order uncompresses each tile once.  Uncompressed tables
+ * are read in place, so the same interface serves both.  The values
+ * of a column are returned in the column-wise form used by
+ * SchemaCuts, and the raw rows and filter expressions are as for
+ * cfitsio.  An instance should not be shared among threads.
+ *
+ * tip, and so the tools that read events through it, cannot read the
+ * rows of a compressed table; only its header.  Compressed event
+ * files are read by gtselect, gtmktime, and the classes that take a
+ * CompressedTable, e.g., Cuts::select(const CompressedTable &).
+ */
+
+class CompressedTable {
+
+public:
+
+   /// A range of rows, [first, last), using 0-based indexing.
+   typedef std::pair<tip::Index_t, tip::Index_t> RowRange_t;
+
+   /**
+    * @class Writer
+    * @brief Append raw rows to the event table of a file, e.g., one
+    * made by createFile().  If the table is tile-compressed, the rows
+    * are compressed a tile at a time as they are appended, so the
+    * table is written only once and at most one tile of rows is held
+    * in memory.  Rows of a partial last tile are written by close()
+    * or the destructor, and are read back to complete the tile if
+    * rows are appended to the table later.
+    */
+   class Writer {
+
+   public:
+
+      /// @param outFile The output file.
+      /// @param extension The event table extension name.
+      /// @param tileRows The number of rows per tile, if the table is
+      ///        compressed and has no rows yet.
+      Writer(const std::string & outFile, const std::string & extension,
+             tip::Index_t tileRows=10000);
+
+      /// @brief Write any pending rows, ignoring errors.
+      ~Writer();
+
+      /// @brief The number of bytes per uncompressed row.
+      long rowSize() const;
+
+      /// @brief The number of rows in the table, including those not
+      ///        yet written.
+      tip::Index_t numRecords() const;
+
+      /// @brief Append the raw bytes of nrows rows.
+      void append(const unsigned char * bytes, tip::Index_t nrows);
+
+      /// @brief Write any pending rows and close the file.
+      void close();
+
+   private:
+
+      /// The cfitsio handles and tile buffer, which are not exposed in
+      /// this header.
+      struct Output;
+
+      Output * m_output;
+
+      /// Disable copying, since the handles are owned.
+      Writer(const Writer &);
+      Writer & operator=(const Writer &);
+
+   };
+
+   /// @param fitsFile The event file.
+   /// @param extension The event table extension name.
+   CompressedTable(const std::string & fitsFile, const std::string & extension);
+
+   ~CompressedTable();
+
+   /// @brief True if the original table is compressed.
+   bool compressed() const {
+      return m_compressed;
+   }
+
+   tip::Index_t getNumRecords() const {
+      return m_nrows;
+   }
+
+   /// @brief The number of bytes per uncompressed row.
+   long rowSize() const {
+      return m_rowSize;
+   }
+
+   /// @brief The DATASUM keyword value of the table, or "" if there
+   ///        is none.  For a compressed table, this is the checksum
+   ///        of the compressed data.
+   const std::string & datasum() const {
+      return m_datasum;
+   }
+
+   /// @brief True if the table has the column.  The element index of
+   ///        a name such as CALIB_VERSION[1] is ignored.
+   bool hasColumn(const std::string & colname) const;
+
+   /// @brief Read the raw bytes of consecutive uncompressed rows.
+   /// @param first The first row, using 0-based indexing.
+   /// @param nrows The number of rows.
+   /// @param bytes The nrows*rowSize() bytes read.
+   void readRows(tip::Index_t first, tip::Index_t nrows,
+                 unsigned char * bytes) const;
+
+   /// @brief Evaluate a cfitsio filter expression for consecutive
+   ///        rows.  An empty expression passes every row.
+   /// @param accepted Set to 1 for each row that passes, 0 otherwise.
+   /// @return The number of rows that pass.
+   long findRows(const std::string & filterString, tip::Index_t first,
+                 tip::Index_t nrows, std::vector<char> & accepted) const;
+
+   /// @brief Read the values of a scalar numeric column, of an element
+   ///        of a vector column, e.g., CALIB_VERSION[1], or of a bit
+   ///        column of at most 32 bits, whose first bit is the most
+   ///        significant.  TSCALn and TZEROn are applied.
+   void readColumn(const std::string & colname, tip::Index_t first,
+                   tip::Index_t nrows, std::vector<double> & values) const;
+
+   /// @brief The columns of this table used by a set of cuts.  As
+   ///        with Cuts::accept(params), cuts on absent columns pass.
+   ColumnSchema schema(const Cuts & cuts) const;
+
+   /// @brief Apply cuts to consecutive rows, reading only the
+   ///        columns in their schema, e.g., schema(cuts).
+   /// @param accepted Set to 1 for each row that passes, 0 otherwise.
+   /// @return The number of rows that pass.
+   long accept(const SchemaCuts & cuts, tip::Index_t first,
+               tip::Index_t nrows, std::vector<char> & accepted) const;
+
+   /// @brief Write a file with the HDUs of the input file, in which
+   ///        the event table is uncompressed and has no rows, for
+   ///        appending rows read from this table.
+   void createFile(const std::string & outFile) const;
+
+   /// @brief Append the rows that pass a filter expression to the
+   ///        event table of another file, whose rows have the layout
+   ///        of this table or of the projection.  The table may be
+   ///        compressed; see Writer.
+   /// @param outFile The output file, e.g., made by createFile().
+   /// @param filterString A cfitsio filter expression.
+   /// @param ranges Sorted, disjoint ranges of the rows to filter.
+   /// @param projection If not null, only its columns are written.
+   /// @return The number of rows appended.
+   tip::Index_t appendRows(const std::string & outFile,
+                           const std::string & filterString,
+                           const std::vector<RowRange_t> & ranges,
+                           const ColumnProjection * projection=0) const;
+
+   /// @brief As above, filtering all of the rows.
+   tip::Index_t appendRows(const std::string & outFile,
+                           const std::string & filterString,
+                           const ColumnProjection * projection=0) const;
+
+   /// @brief As above, appending to an open table, e.g., to append the
+   ///        rows of several tables without reading back a partial
+   ///        tile of a compressed table for each of them.
+   tip::Index_t appendRows(Writer & output, const std::string & filterString,
+                           const std::vector<RowRange_t> & ranges,
+                           const ColumnProjection * projection=0) const;
+
+   /// @brief True if the header of a table has ZTABLE = T.
+   static bool isCompressed(const tip::Header & header);
+
+   /// @brief True if the extension is a tile-compressed table.
+   static bool isCompressed(const std::string & fitsFile,
+                            const std::string & extension);
+
+   /// @brief Replace the extension of a file with its tile-compressed
+   ///        version.  The other HDUs are copied as they are.  The
+   ///        checksums of the file must be rewritten afterwards.  A
+   ///        table with no rows is cheap to compress, so an output
+   ///        table is compressed before its rows are appended by a
+   ///        Writer, rather than rewritten afterwards.
+   static void compress(const std::string & fitsFile,
+                        const std::string & extension);
+
+private:
+
+   /// The cfitsio handles, which are not exposed in this header.
+   struct FitsHandle;
+
+   std::string m_fileName;
+   std::string m_extension;
+   FitsHandle * m_fits;
+   bool m_compressed;
+   tip::Index_t m_nrows;
+   long m_rowSize;
+   tip::Index_t m_tileRows;
+   std::string m_datasum;
+
+   /// Disable copying, since the handle is owned.
+   CompressedTable(const CompressedTable &);
+   CompressedTable & operator=(const CompressedTable &);
+
+   void checkStatus(int status, const std::string & routine) const;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_CompressedTable_h
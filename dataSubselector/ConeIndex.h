@@ -0,0 +1,109 @@
+/**
+ * @file ConeIndex.h
+ * @brief Pixelized sky index for fast acceptance tests against one or
+ * more SkyConeCuts.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_ConeIndex_h
+#define dataSubselector_ConeIndex_h
+
+#include <vector>
+
+#include "dataSubselector/SkyConeCut.h"
+#include "dataSubselector/SkyGrid.h"
+
+namespace dataSubselector {
+
+/**
+ * @class ConeIndex
+ * @brief Classify the pixels of a SkyGrid as lying inside, outside,
+ * or on the boundary of each cone.  Only events in boundary pixels
+ * need the exact SkyConeCut::accept(ra, dec) test, so the cost per
+ * event is nearly independent of the number of cones.
+ *
+ * Only the declination bands that overlap a cone are stored.
+ */
+
+class ConeIndex {
+
+public:
+
+   enum Status {OUTSIDE, BOUNDARY, INSIDE};
+
+   /// @param cones The acceptance cones.  These are copied.
+   /// @param pixelSize The declination band height (degrees).  If
+   ///        zero, a size is chosen based on the smallest cone radius.
+   ConeIndex(const std::vector<SkyConeCut> & cones, double pixelSize=0);
+
+   /// @brief True if the direction lies within any of the cones.
+   /// @param ra Right Ascension (J2000 degrees)
+   /// @param dec Declination (J2000 degrees)
+   bool accept(double ra, double dec) const;
+
+   /// @brief Find the cones containing a direction.
+   /// @param ra Right Ascension (J2000 degrees)
+   /// @param dec Declination (J2000 degrees)
+   /// @param cones The indices of the cones, in no particular order.
+   void findCones(double ra, double dec,
+                  std::vector<unsigned int> & cones) const;
+
+   /// @brief The classification of the pixel containing the
+   ///        direction: INSIDE if the pixel is wholly inside any cone,
+   ///        OUTSIDE if it is outside all of them.
+   Status status(double ra, double dec) const;
+
+   const std::vector<SkyConeCut> & cones() const {
+      return m_cones;
+   }
+
+   /// @brief The declination band height (degrees).
+   double pixelSize() const {
+      return m_grid.bandHeight();
+   }
+
+   /// @brief The number of pixels stored.
+   size_t numPixels() const {
+      return m_status.size();
+   }
+
+private:
+
+   /// A cone that overlaps a pixel.
+   struct Entry {
+      unsigned int cone;
+      bool inside;
+   };
+
+   std::vector<SkyConeCut> m_cones;
+
+   SkyGrid m_grid;
+
+   /// The range of stored declination bands.
+   int m_firstBand;
+   int m_lastBand;
+
+   /// The SkyGrid number of the first stored pixel.
+   unsigned int m_pixelOffset;
+
+   std::vector<unsigned char> m_status;
+
+   /// The entries for pixel i are m_entries[m_entryStart[i]] through
+   /// m_entries[m_entryStart[i+1] - 1], with those for the cones
+   /// containing the whole pixel first.
+   std::vector<unsigned int> m_entryStart;
+   std::vector<Entry> m_entries;
+
+   static double defaultPixelSize(const std::vector<SkyConeCut> & cones);
+
+   /// @return The stored pixel containing the direction, or -1 if it
+   ///         lies in a band that overlaps none of the cones.
+   long pixel(double ra, double dec) const;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_ConeIndex_h
@@ -31,8 +31,21 @@ class CutBase {
 
 public:
 
-   /// @param type "range", "GTI", or "SkyCone"
-   CutBase(const std::string & type="none") : m_type(type) {}
+   /// @brief Tags for the concrete cut classes. These allow
+   ///        containers such as Cuts to dispatch on the kind of cut
+   ///        without string comparisons or dynamic_casts.
+   enum Kind {NONE, RANGE, GTI, SKYCONE, BIT_MASK, VERSION, RANGE_SET};
+
+   /// @brief Constructor for cuts defined outside of this package.
+   ///        Their kind is always NONE, even if the type string is
+   ///        that of one of the cut classes here, since Cuts casts
+   ///        a cut to the class that its kind names.
+   /// @param type The type string written to DSTYPn.
+   CutBase(const std::string & type="none") 
+      : m_type(type), m_kind(NONE) {}
+
+   /// @brief Constructor for the cut classes of this package.
+   explicit CutBase(Kind kind) : m_type(typeName(kind)), m_kind(kind) {}
    
    virtual ~CutBase() {}
    
@@ -51,12 +64,24 @@ public:
    /// @brief The cut type, "range", "GTI", or "SkyCone"
    virtual const std::string & type() const {return m_type;}
 
+   /// @brief The kind tag corresponding to type().
+   Kind kind() const {return m_kind;}
+
+   /// @return The kind tag for a type string, or NONE if it is not
+   ///         one of the dataSubselector cut types.
+   static Kind kindOf(const std::string & type);
+
+   /// @return The type string for a kind tag.
+   static const std::string & typeName(Kind kind);
+
    /// @brief Write this cut to the output stream as the keynum-th
    ///        DSS keyword.
    virtual void writeCut(std::ostream & stream, unsigned int keynum) const;
 
    /// @brief Write this cut to the tip::Header object as the keynum-th
-   ///        DSS keyword.
+   ///        DSS keyword.  An exception is thrown if the DSVAL value
+   ///        does not fit on one header card, e.g., for a RangeSetCut
+   ///        with too many ranges.
    virtual void writeDssKeywords(tip::Header & header, 
                                  unsigned int keynum) const;
 
@@ -81,6 +106,7 @@ protected:
 private:
 
    std::string m_type;
+   Kind m_kind;
 
    void writeDssKeywords(tip::Header & header, unsigned int keynum,
                          const std::string & type,
@@ -0,0 +1,129 @@
+/**
+ * @file CutController.h
+ * @brief Manage the cuts specified in the par file.
+ * @author J. Chiang
+ *
+ * $Header: /nfs/slac/g/glast/ground/cvs/ScienceTools-scons/dataSubselector/src/dataSubselector/CutController.h,v 1.13 2010/07/21 21:09:26 jchiang Exp $
+ */
+
+#ifndef dataSubselector_CutController_h
+#define dataSubselector_CutController_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "dataSubselector/Cuts.h"
+
+namespace st_app {
+   class AppParGroup;
+}
+
+namespace tip {
+   class ConstTableRecord;
+}
+
+namespace dataSubselector {
+
+class Gti;
+
+/**
+ * @class CutController
+ * @brief Controller interface between application and CutBase hierarchy.
+ * @author J. Chiang
+ *
+ */
+
+class CutController {
+
+public:
+
+   /// Parameter name-value pairs, e.g., "emin", "zmax", "evclass".
+   /// Absent entries are treated as INDEF, i.e., no cut is applied.
+   typedef std::map<std::string, double> ParMap;
+
+   static CutController * instance(st_app::AppParGroup & pars,
+                                   const std::vector<std::string> & eventFiles,
+                                   const std::string & evtable);
+
+   static void delete_instance();
+
+   /// @brief Build the cuts from the gtselect parameters.  The
+   /// phases and energies window lists, e.g., "0.1:0.3,0.6:0.7",
+   /// add RangeSetCuts that are applied along with any phasemin,
+   /// phasemax, emin, and emax range cuts.
+   CutController(st_app::AppParGroup & pars,
+                 const std::vector<std::string> & eventFiles,
+                 const std::string & evtable);
+
+   /// @brief Build the cuts from a map of parameter values, using
+   /// the same parameter names as gtselect.par.  Unlike the
+   /// singleton accessed via instance(), any number of these may
+   /// exist at once, so independent selections can be prepared
+   /// and applied concurrently.
+   CutController(const ParMap & pars,
+                 const std::vector<std::string> & eventFiles,
+                 const std::string & evtable);
+
+   bool accept(tip::ConstTableRecord & row) const;
+
+   void writeDssKeywords(tip::Header & header) const {
+      m_cuts.writeDssKeywords(header);
+   }
+
+   void updateGti(const std::string & filename) const;
+
+   /// @brief Intersect the GTI with all of the TIME range cuts.
+   void applyTimeRangeCuts(Gti & gti) const;
+
+   std::string filterString() const;
+
+   const Cuts & cuts() const {
+      return m_cuts;
+   }
+
+   /// @brief True if any of the event tables is tile-compressed, as
+   ///        found from the headers read to check PASS_VER.
+   bool compressed() const {
+      return m_compressed;
+   }
+
+   /// @brief The cut parameters from the gtselect parameters.
+   /// INDEF values are left out of the map.
+   static ParMap parMap(st_app::AppParGroup & pars);
+
+   /// @return True if name is one of the cut parameters, e.g.,
+   ///         "emin" or "evclass".
+   static bool isParName(const std::string & name);
+
+private:
+
+   Cuts m_cuts;
+
+   std::string m_passVer;
+   std::string m_evclsFilter;
+   bool m_compressed;
+
+   static CutController * s_instance;
+
+   static double parValue(const ParMap & pars, const std::string & name,
+                          double defaultValue);
+
+   void setCuts(const ParMap & pars);
+
+   void addRangeCut(const std::string & colname, const std::string & unit,
+                    double minVal, double maxVal, unsigned int indx=0,
+                    bool force=false);
+
+   /// @brief Add a cut accepting any of a list of windows, unless
+   ///        the list is "none".
+   void addRangeSetCut(const std::string & colname, const std::string & unit,
+                       const std::string & windows);
+
+   void checkPassVersion(const std::vector<std::string> & evfiles);
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_CutController_h
@@ -12,9 +12,11 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "dataSubselector/BitMaskCut.h"
 #include "dataSubselector/GtiCut.h"
 #include "dataSubselector/RangeCut.h"
 
@@ -26,9 +28,12 @@ namespace tip {
 
 namespace dataSubselector {
 
-class BitMaskCut;
+class CompressedTable;
 class Gti;
 class GtiCuts;
+class RowSelection;
+class SelectionStore;
+class VersionCut;
 
 /**
  * @class Cuts
@@ -42,7 +47,13 @@ class Cuts {
 
 public: 
 
-   Cuts() {}
+   Cuts() : m_post_P7(false) {}
+
+   /// @param validityMasks The validity masks given to the
+   ///        BitMaskCuts created by this object, e.g., those of a
+   ///        particular CALDB root from BitMaskCut::caldbValidityMasks.
+   explicit Cuts(const BitMaskCut::ValidityMasksPtr & validityMasks)
+      : m_post_P7(false), m_validityMasks(validityMasks) {}
 
    /// @brief This constructor reads the data selections from the event 
    ///        extension header.
@@ -63,9 +74,14 @@ public:
    ///        keywords will not be read in.  Since the GTI extension
    ///        should already include any time range cuts, explicit
    ///        time range cuts are not needed.
+   /// @param validityMasks The validity masks given to the
+   ///        BitMaskCuts read from the header.  If null, the
+   ///        process-wide masks, by default those of $CALDB, are used.
    Cuts(const std::string & eventFile, const std::string & extension,
         bool check_columns=true, bool skipTimeRangeCuts=false,
-        bool skipEventClassCuts=false);
+        bool skipEventClassCuts=false,
+        const BitMaskCut::ValidityMasksPtr & validityMasks
+        =BitMaskCut::ValidityMasksPtr());
 
    /// @brief This constructor reads in a vector of eventFiles, verifying
    ///        that the non-GTI cuts are the same in all files, and merging
@@ -74,17 +90,29 @@ public:
         const std::string & extension,
         bool check_columns=true,
         bool skipTimeRangeCuts=false,
-        bool skipEventClassCuts=false);
+        bool skipEventClassCuts=false,
+        const BitMaskCut::ValidityMasksPtr & validityMasks
+        =BitMaskCut::ValidityMasksPtr());
 
-   /// A copy constructor is needed since there are pointer data members.
+   /// A copy constructor is needed since there are pointer data
+   /// members.  Each cut is cloned.
    Cuts(const Cuts & rhs);
 
-   /// Deletes the CutBase pointers.
    ~Cuts();
 
-   /// Copy assignment operator
+   /// Copy assignment operator.  Only the cuts are copied.
    Cuts & operator=(const Cuts & rhs);
 
+#ifndef SWIG
+   /// @brief Take ownership of the cuts in rhs without copying them
+   ///        (and, in particular, their GTIs).  rhs is left empty.
+   Cuts(Cuts && rhs) noexcept;
+
+   /// Move assignment operator.  As with copy assignment, only the
+   /// cuts are transferred; rhs is left empty.
+   Cuts & operator=(Cuts && rhs) noexcept;
+#endif
+
 #ifndef SWIG
    /// @brief True if the data in the row passes all of the cuts.
    /// @param row A row of FITS binary table.
@@ -96,6 +124,41 @@ public:
    ///        FITS format.
    bool accept(const std::map<std::string, double> & params) const;
 
+   /// @brief Find the rows of an event table that pass all of the
+   ///        cuts, without copying them.  RangeCuts read their column
+   ///        through RangeCut::Bound, so it is resolved only once.
+   /// @param events The event table.
+   RowSelection select(const tip::Table & events) const;
+
+   /// @brief As above, for an event table that may be tile-compressed,
+   ///        which tip cannot read.  The columns used by the cuts are
+   ///        read a block of rows at a time and tested via SchemaCuts.
+   /// @param events The event table.
+   RowSelection select(const CompressedTable & events) const;
+
+   /// @brief Divide the cuts into those whose selections of the
+   ///        table are in the store and those that must be evaluated.
+   /// @param events The event table.
+   /// @param store The stored selections.
+   /// @param cached The indices of the cuts with stored selections.
+   /// @param uncached The indices of the other cuts.
+   void planSelection(const tip::Table & events, const SelectionStore & store,
+                      std::vector<unsigned int> & cached,
+                      std::vector<unsigned int> & uncached) const;
+
+   /// @brief As select(events), but intersecting the stored
+   ///        selections of individual cuts with fresh selections for
+   ///        the rest.
+   /// @param events The event table.
+   /// @param store The stored selections.
+   /// @param storeNew If true, the uncached cuts are each applied to
+   ///        the whole table, in one pass over its rows, and their
+   ///        selections are added to the store.
+   ///        Otherwise, the uncached cuts are applied only to the rows
+   ///        that pass the cached ones, and nothing is stored.
+   RowSelection select(const tip::Table & events, const SelectionStore & store,
+                       bool storeNew=true) const;
+
    /// @brief This method will add a cut if it is not equal to
    ///        and if it is not superceded by an existing cut.
    ///        If the added cut supercedes an existing cut, that cut
@@ -116,6 +179,20 @@ public:
                             RangeCut::IntervalType type=RangeCut::CLOSED,
                             unsigned int indx=0);
 
+   /// @brief Add a cut accepting values in any of several ranges.
+   /// @return The current number of cuts stored.
+   /// @param colname The column name of the value to be selected on.
+   /// @param unit The units of this quantity.
+   /// @param intervals The (min, max] ranges to be accepted.  Use
+   ///        infinite bounds for open-ended ranges.
+   /// @param indx If the column is a vector, the (1-based) index of
+   ///        the element to be cut on.
+   unsigned int addRangeSetCut(const std::string & colname,
+                               const std::string & unit,
+                               const std::vector<std::pair<double, double> >
+                               & intervals,
+                               unsigned int indx=0);
+
    /// @brief Add a GTI cut.  Here an existing GTI extension is 
    ///        read from a FITS file as a tip::Table.
    /// @return The current number of cuts stored.
@@ -143,6 +220,7 @@ public:
    /// desired event class)
    /// @param pass_ver Pass version of IRFs, e.g., "P7V6".
    ///        This should be left blank for pre-Pass 7 IRFs.
+   ///        The cut is given the validity masks of this object.
    unsigned int addBitMaskCut(const std::string & colname,
                               unsigned int bitPosition,
                               const std::string & pass_ver="");
@@ -158,7 +236,8 @@ public:
                               const std::string & version);
 
    unsigned int addCut(const CutBase & newCut) {
-      m_cuts.push_back(newCut.clone());
+      m_cuts.push_back(CutPtr(newCut.clone()));
+      reindex();
       return m_cuts.size();
    }
 
@@ -229,6 +308,16 @@ public:
 
    /// @return A vector of pointers to the GtiCuts that are present.
    void getGtiCuts(std::vector<const GtiCut *> & gtiCuts);
+
+   /// @return The first GtiCut, or zero if there is none.
+   const GtiCut * gtiCut() const {
+      return m_gtiCuts.empty() ? 0 : m_gtiCuts.front();
+   }
+
+   /// @return The RangeCuts applied to the named column, in the
+   ///         order in which they are stored.
+   const std::vector<RangeCut *> & 
+   rangeCuts(const std::string & colname) const;
 #endif
 
    /// @return The irfs named in the DSS keywords.
@@ -273,10 +362,23 @@ public:
 
 #endif
 
+   /// @return A copy of the BitMaskCut applied to the named column,
+   ///         or zero if there is none.  The caller owns the copy.
    BitMaskCut * bitMaskCut(const std::string & colname="EVENT_CLASS") const;
 
+   /// @return Copies of all of the BitMaskCuts, in the order in which
+   ///         they were applied.  The caller owns the copies.
    std::vector<BitMaskCut *> bitMaskCuts() const;
 
+   /// @return The BitMaskCut applied to the named column, or zero if
+   ///         there is none.  The cut is owned by this object.
+   const BitMaskCut * 
+   findBitMaskCut(const std::string & colname="EVENT_CLASS") const;
+
+   /// @return All of the BitMaskCuts, in the order in which they
+   ///         were applied.  These are owned by this object.
+   std::vector<const BitMaskCut *> findBitMaskCuts() const;
+
    const std::string & pass_ver() const {
       return m_pass_ver;
    }
@@ -285,6 +387,12 @@ public:
       return m_post_P7;
    }
 
+   /// @return The validity masks given to new BitMaskCuts, or null
+   ///         if they use the process-wide masks.
+   const BitMaskCut::ValidityMasksPtr & validityMasks() const {
+      return m_validityMasks;
+   }
+
    /// Replace or add an existing BitMaskCut applied to the same column.
    void setBitMaskCut(BitMaskCut * bitMaskCut);
 
@@ -292,18 +400,34 @@ public:
                                     std::string & pass_ver,
                                     std::string & irf_ver);
 
+   /// @brief Copy the event class name to bit mask mapping from
+   /// the (cached) BITMASK_MAPPING extension of irf_index.fits.
+   /// See IrfIndex.
    static void read_bitmask_mapping(std::map<std::string,
                                     unsigned int> & irfs);
 
 private:
 
-   std::vector<CutBase *> m_cuts;
+   typedef std::unique_ptr<CutBase> CutPtr;
+   std::vector<CutPtr> m_cuts;
+
+   /// Per-kind indices into m_cuts.  These must be rebuilt by
+   /// reindex() whenever m_cuts is modified.
+   typedef std::map<std::string, std::vector<RangeCut *> > RangeCutIndex_t;
+   std::vector<GtiCut *> m_gtiCuts;
+   RangeCutIndex_t m_rangeCuts;
+   std::map<std::string, BitMaskCut *> m_bitMaskCuts;
+   std::map<std::string, VersionCut *> m_versionCuts;
 
    std::string m_irfName;
 
    std::string m_pass_ver;
    bool m_post_P7;
 
+   /// The validity masks for new BitMaskCuts, or null for the
+   /// process-wide ones.
+   BitMaskCut::ValidityMasksPtr m_validityMasks;
+
    unsigned int parseColname(const std::string & colname,
                              std::string & col) const;
 
@@ -311,6 +435,11 @@ private:
 
    unsigned int find(const CutBase * cut) const;
 
+   void reindex();
+
+   /// @brief Exchange the cuts and their indices with those of rhs.
+   void swapCuts(Cuts & rhs);
+
    /// @brief Add a cut. The passed cut will not be added if an 
    ///        existing cut supercedes it, but it will be deleted.  If
    ///        added, this cut will be deleted by the destructor ~Cut().
@@ -0,0 +1,133 @@
+/**
+ * @file EventIndex.h
+ * @brief Block summaries of an event table, stored in a sidecar file,
+ * for skipping blocks of rows that cannot pass a set of Cuts.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_EventIndex_h
+#define dataSubselector_EventIndex_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tip/tip_types.h"
+
+#include "dataSubselector/SkyGrid.h"
+
+namespace tip {
+   class Table;
+}
+
+namespace dataSubselector {
+
+class Cuts;
+
+/**
+ * @class EventIndex
+ * @brief Summaries of consecutive blocks of rows of an event table:
+ * the minimum and maximum TIME, ENERGY, and ZENITH_ANGLE, the bitwise
+ * OR of EVENT_CLASS and EVENT_TYPE, and the SkyGrid pixels occupied
+ * by the RA, DEC directions.  A block can be skipped if these show
+ * that none of its rows can pass a RangeCut, RangeSetCut, GtiCut,
+ * BitMaskCut, or SkyConeCut.  Columns that are absent from the event
+ * table are not summarized.
+ *
+ * The index is written to a FITS file with a BLOCKS extension, by
+ * convention named by sidecarName().
+ */
+
+class EventIndex {
+
+public:
+
+   /// A range of rows, [first, last), using 0-based indexing.
+   typedef std::pair<tip::Index_t, tip::Index_t> RowRange_t;
+
+   struct Block {
+      /// The first row (0-based) and the number of rows.
+      tip::Index_t first;
+      tip::Index_t nrows;
+
+      /// The minimum and maximum of each of rangeColumns().
+      std::vector<double> minValues;
+      std::vector<double> maxValues;
+
+      /// The bitwise OR of each of maskColumns().
+      std::vector<unsigned int> masks;
+
+      /// Bit i is set if SkyGrid pixel i is occupied.
+      std::vector<unsigned char> pixels;
+
+      bool occupied(unsigned int pixel) const {
+         return (pixels[pixel/8] >> (pixel % 8)) & 1;
+      }
+   };
+
+   /// @brief Summarize an event table.
+   /// @param events The event table, e.g., an FT1 EVENTS extension.
+   /// @param blockSize The number of rows per block.
+   /// @param pixelSize The SkyGrid pixel size (degrees).
+   EventIndex(const tip::Table & events, tip::Index_t blockSize=16384,
+              double pixelSize=2.);
+
+   /// @brief Read an index file.
+   explicit EventIndex(const std::string & indexFile);
+
+   /// @brief Write the index to a FITS file.  An existing file is
+   ///        overwritten.
+   void write(const std::string & indexFile) const;
+
+   /// @brief True if the index was made from this table, as judged
+   ///        by the number of rows and the DATASUM keyword.  A table
+   ///        without a DATASUM keyword never matches.
+   bool matches(const tip::Table & events) const;
+
+   /// @brief Find the rows in blocks that may pass the cuts.
+   /// @param cuts The cuts to be applied.
+   /// @param ranges The sorted, disjoint row ranges.
+   void rowRanges(const Cuts & cuts, std::vector<RowRange_t> & ranges) const;
+
+   const std::vector<Block> & blocks() const {
+      return m_blocks;
+   }
+
+   const std::vector<std::string> & rangeColumns() const {
+      return m_rangeColumns;
+   }
+
+   const std::vector<std::string> & maskColumns() const {
+      return m_maskColumns;
+   }
+
+   const SkyGrid & skyGrid() const {
+      return m_grid;
+   }
+
+   /// @brief The conventional index file name for an event file.
+   static std::string sidecarName(const std::string & eventFile) {
+      return eventFile + ".idx";
+   }
+
+private:
+
+   std::vector<std::string> m_rangeColumns;
+   std::vector<std::string> m_maskColumns;
+   bool m_hasSky;
+
+   SkyGrid m_grid;
+
+   std::vector<Block> m_blocks;
+
+   /// The number of rows and DATASUM value of the event table.
+   tip::Index_t m_nrows;
+   std::string m_datasum;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_EventIndex_h
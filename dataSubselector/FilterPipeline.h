@@ -0,0 +1,133 @@
+/**
+ * @file FilterPipeline.h
+ * @brief Copy the rows of an event table that pass a set of cuts,
+ * overlapping the reading, filtering, and writing of the rows.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_FilterPipeline_h
+#define dataSubselector_FilterPipeline_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tip/tip_types.h"
+
+#include "dataSubselector/ColumnSchema.h"
+#include "dataSubselector/Cuts.h"
+
+namespace dataSubselector {
+
+class ColumnProjection;
+class SchemaCuts;
+
+/**
+ * @class FilterPipeline
+ * @brief A three-stage pipeline for filtering an event table.  An I/O
+ * thread reads chunks of raw rows from the input file, worker threads
+ * decode the columns used by the cuts and apply them via SchemaCuts,
+ * and a writer thread appends the accepted rows to the output table
+ * in their original order.  The stages are connected by
+ * BoundedQueues, and a fixed pool of chunk buffers bounds the memory
+ * used.  Alternatively, runChunked() filters batches of chunks on a
+ * work-stealing ChunkScheduler, which suits tables whose filtering
+ * costs more than reading them.
+ *
+ * The cut columns must be scalar numeric columns or bit columns of at
+ * most 32 bits, and the table must not have variable-length columns;
+ * supported() is false otherwise, e.g., for a cut on an element of a
+ * vector column.
+ */
+
+class FilterPipeline {
+
+public:
+
+   /// A range of rows, [first, last), using 0-based indexing.
+   typedef std::pair<tip::Index_t, tip::Index_t> RowRange_t;
+
+   /// @param infile The input event file.
+   /// @param extension The event table extension name.
+   /// @param cuts The cuts to apply.  The GTIs of infile are added.
+   /// @param nworkers The number of filtering threads.
+   /// @param chunkSize The number of rows read at a time.
+   FilterPipeline(const std::string & infile, const std::string & extension,
+                  const Cuts & cuts, unsigned int nworkers,
+                  tip::Index_t chunkSize=10000);
+
+   /// @brief True if the cuts can be applied by the pipeline.
+   bool supported() const {
+      return m_supported;
+   }
+
+   /// @brief Write only the columns kept by a projection, which must
+   ///        outlive the pipeline.  By default, all columns are kept.
+   void setProjection(const ColumnProjection * projection) {
+      m_projection = projection;
+   }
+
+   /// @brief Copy the rows in the given ranges that pass the cuts.
+   /// @param ranges Sorted, disjoint row ranges of the input table.
+   /// @param outfile A file with an empty copy of the event table,
+   ///        to which the accepted rows are appended.
+   /// @return The number of rows written.
+   tip::Index_t run(const std::vector<RowRange_t> & ranges,
+                    const std::string & outfile) const;
+
+   /// @brief Copy the rows in the given ranges that pass the cuts,
+   ///        filtering batches of chunks on a ChunkScheduler rather
+   ///        than streaming them through the pipeline.  Each chunk of
+   ///        accepted rows is written directly to its final offset.
+   /// @param ranges Sorted, disjoint row ranges of the input table.
+   /// @param outfile A file with an empty copy of the event table,
+   ///        to which the accepted rows are appended.
+   /// @return The number of rows written.
+   tip::Index_t runChunked(const std::vector<RowRange_t> & ranges,
+                           const std::string & outfile) const;
+
+private:
+
+   /// The location and encoding of a cut column within a row.
+   struct Column {
+      unsigned int slot;
+      long offset;
+      char type;
+      long repeat;
+      double scale;
+      double zero;
+   };
+
+   struct Chunk;
+
+   std::string m_infile;
+   std::string m_extension;
+   Cuts m_cuts;
+   unsigned int m_nworkers;
+   tip::Index_t m_chunkSize;
+
+   ColumnSchema m_schema;
+   std::vector<Column> m_columns;
+   long m_rowSize;
+   bool m_supported;
+
+   const ColumnProjection * m_projection;
+
+   /// @brief The number of bytes per output row.
+   long outputRowSize() const;
+
+   void findColumns();
+
+   void decode(Chunk & chunk) const;
+
+   /// @brief Apply the cuts to a chunk and move the accepted rows to
+   ///        the front of its buffer.
+   void filter(const SchemaCuts & schemaCuts, Chunk & chunk) const;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_FilterPipeline_h
@@ -10,6 +10,9 @@
 #ifndef dataSubselector_Gti_h
 #define dataSubselector_Gti_h
 
+#include <utility>
+#include <vector>
+
 #include "evtbin/Gti.h"
 
 namespace tip {
@@ -32,6 +35,9 @@ public:
    Gti(const std::string & filename, const std::string & extension="GTI") 
       : evtbin::Gti(filename, extension) {}
 
+   /// @brief Read the intervals from a GTI extension.  The START
+   /// and STOP columns are read in full; if the rows are not in time
+   /// order or overlap, they are sorted and merged before insertion.
    Gti(const tip::Table & gtiTable);
 
    Gti(const evtbin::Gti & gti);
@@ -40,6 +46,10 @@ public:
 
    bool accept2(double time) const;
 
+   /// @brief Write the intervals to the GTI extension of the FITS
+   /// file, creating the extension if necessary.  The START and STOP
+   /// columns are each written with a single cfitsio call, and
+   /// ONTIME is updated in the same pass.
    void writeExtension(const std::string & filename) const;
 
    /// @brief Given a start and stop time this method recomputes the
@@ -55,6 +65,12 @@ public:
    /// @return The maximum upper bound of the GTIs (MET seconds)
    double maxValue() const;
 
+private:
+
+   /// @brief Insert a set of intervals, sorting and merging them
+   /// first if they are not already time-ordered and disjoint.
+   void insertIntervals(std::vector<std::pair<double, double> > & intervals);
+
 };
 
 } // namespace dataSubselector
@@ -29,11 +29,11 @@ class GtiCut : public CutBase {
 public:
 
    GtiCut(const std::string & filename, const std::string & ext="GTI") 
-      : CutBase("GTI"), m_gti(Gti(filename, ext)) {}
+      : CutBase(GTI), m_gti(Gti(filename, ext)) {}
 
-   GtiCut(const tip::Table & gtiTable) : CutBase("GTI"), m_gti(gtiTable) {}
+   GtiCut(const tip::Table & gtiTable) : CutBase(GTI), m_gti(gtiTable) {}
 
-   GtiCut(const Gti & gti) : CutBase("GTI"), m_gti(gti) {}
+   GtiCut(const Gti & gti) : CutBase(GTI), m_gti(gti) {}
 
    virtual ~GtiCut() {}
 
@@ -41,6 +41,11 @@ public:
 
    virtual bool accept(const std::map<std::string, double> & params) const;
 
+   /// @brief True if the time lies within one of the GTIs.
+   bool accept(double time) const {
+      return m_gti.accept2(time);
+   }
+
    virtual void writeCut(std::ostream & stream, unsigned int keynum) const;
 
    virtual GtiCut * clone() const {return new GtiCut(*this);}
@@ -59,8 +64,6 @@ private:
 
    const Gti m_gti;
 
-   bool accept(double value) const;
-
 };
 
 } // namespace dataSubselector
@@ -0,0 +1,95 @@
+/**
+ * @file IrfIndex.h
+ * @brief Cached contents of the BITMASK_MAPPING extension of the
+ * CALDB irf_index.fits file.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_IrfIndex_h
+#define dataSubselector_IrfIndex_h
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dataSubselector {
+
+/**
+ * @class IrfIndex
+ * @brief Map between IRF (event class) names and EVENT_CLASS bit
+ * masks as given by $CALDB/data/glast/lat/bcf/irf_index.fits.
+ *
+ * Instances are immutable.  The static accessors share one instance
+ * per CALDB root across the process; it is re-read only if the
+ * irf_index.fits modification time changes.
+ */
+
+class IrfIndex {
+
+public:
+
+   typedef std::shared_ptr<const IrfIndex> IrfIndexPtr;
+
+   typedef std::unordered_map<std::string, unsigned int> MaskMap_t;
+
+   /// An IRF name and its version number, e.g., (6, "P8R2_SOURCE_V6").
+   typedef std::pair<unsigned int, std::string> IrfVersion_t;
+
+   typedef std::vector<IrfVersion_t> IrfVersions_t;
+
+   /// @brief Read the BITMASK_MAPPING extension of the given file.
+   IrfIndex(const std::string & irf_index_file);
+
+   /// @return The cached index for $CALDB.
+   static IrfIndexPtr instance();
+
+   /// @return The cached index for the given CALDB root.
+   static IrfIndexPtr instance(const std::string & caldb);
+
+   /// @return True if the event class name is in the index, in
+   ///        which case its bit mask is set.
+   bool mask(const std::string & event_class, unsigned int & mask) const;
+
+   /// @return The names of all event classes with this bit mask.
+   const std::vector<std::string> & irfs(unsigned int mask) const;
+
+   /// @return The IRFs with the given PASS_VER and bit mask, newest
+   ///        version first.  IRFs with the same version number are
+   ///        in name order.
+   const IrfVersions_t & versions(const std::string & pass_ver,
+                                  unsigned int mask) const;
+
+   /// @return The name of the newest IRF with the given PASS_VER and
+   ///        bit mask, or an empty string if there is none.
+   std::string latest(const std::string & pass_ver, unsigned int mask) const;
+
+   /// @return The full event class name to bit mask mapping.
+   const MaskMap_t & masks() const {
+      return m_masks;
+   }
+
+   const std::string & filename() const {
+      return m_filename;
+   }
+
+private:
+
+   std::string m_filename;
+
+   MaskMap_t m_masks;
+
+   std::unordered_map<unsigned int, std::vector<std::string> > m_irfs;
+
+   std::unordered_map<unsigned int, 
+                      std::unordered_map<std::string, IrfVersions_t> >
+   m_versions;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_IrfIndex_h
@@ -9,8 +9,17 @@
 #ifndef dataSubselector_RangeCut_h
 #define dataSubselector_RangeCut_h
 
+#include <vector>
+
+#include "tip/tip_types.h"
+
 #include "dataSubselector/CutBase.h"
 
+namespace tip {
+   class IColumn;
+   class Table;
+}
+
 namespace dataSubselector {
 
 /**
@@ -39,6 +48,52 @@ public:
 
    virtual bool accept(const std::map<std::string, double> & params) const;
 
+   /// @brief True if the column value lies in the accepted range.
+   bool accept(double value) const {
+      if (m_intervalType == MINONLY) {
+         return m_min < value;
+      } else if (m_intervalType == MAXONLY) {
+         return value <= m_max;
+      } else if (m_min == m_max) {
+         // Fully closed interval to support selecting on a specific value.
+         return m_min <= value && value <= m_max;
+      }
+      return m_min < value && value <= m_max;
+   }
+
+   /**
+    * @class Bound
+    * @brief A RangeCut bound to the column of a specific table.  The
+    * column is resolved once, so records can be tested by index
+    * without a field name lookup per row.  Vector column elements
+    * are read into a buffer that is reused from row to row, so a
+    * Bound object should not be shared among threads.
+    */
+   class Bound {
+   public:
+      Bound(const RangeCut & cut, const tip::Table & table);
+
+      /// @brief True if the record passes the cut.
+      bool accept(tip::Index_t record) const {
+         return m_cut->accept(value(record));
+      }
+
+      /// @brief The value of the cut column (or column element) for
+      ///        the record.
+      double value(tip::Index_t record) const;
+
+   private:
+      const RangeCut * m_cut;
+      const tip::IColumn * m_column;
+      mutable std::vector<double> m_buffer;
+   };
+
+   /// @brief Bind this cut to a table.  The table and this cut
+   ///        must outlive the returned object.
+   Bound bind(const tip::Table & table) const {
+      return Bound(*this, table);
+   }
+
    virtual CutBase * clone() const {return new RangeCut(*this);}
 
    virtual bool supercedes(const CutBase & cut) const;
@@ -92,7 +147,6 @@ private:
    unsigned int m_index;
    std::string m_fullName;
 
-   bool accept(double value) const;
    double extractValue(tip::ConstTableRecord & row) const;
    void setFullName();
 
@@ -0,0 +1,128 @@
+/**
+ * @file RangeSetCut.h
+ * @brief Cut on a column value lying in any of a set of ranges.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_RangeSetCut_h
+#define dataSubselector_RangeSetCut_h
+
+#include <utility>
+#include <vector>
+
+#include "dataSubselector/CutBase.h"
+
+namespace dataSubselector {
+
+/**
+ * @class RangeSetCut
+ * @brief Accept column values lying in the union of several ranges,
+ * e.g., disjoint PULSE_PHASE windows or ENERGY bands.  Each range
+ * follows the RangeCut conventions: it is open below and closed
+ * above, (min, max], unless min == max, in which case only that value
+ * is accepted.  Infinite bounds give ranges that are open-ended.
+ *
+ * The DSVALn keyword value is a comma-separated list of ranges,
+ * e.g., "0.1:0.2,0.6:0.7", with open-ended ranges written as in
+ * RangeCut, ":0.2" or "0.6:".
+ *
+ * @author agent
+ */
+
+class RangeSetCut : public CutBase {
+
+public:
+
+   typedef std::pair<double, double> Interval_t;
+
+   /// @param colname The column name.
+   /// @param unit The units of the column.
+   /// @param intervals The (min, max] ranges to accept.  These need
+   ///        not be sorted or disjoint.
+   /// @param indx If the column is a vector, the (1-based) index of
+   ///        the element to be cut on.
+   RangeSetCut(const std::string & colname, const std::string & unit,
+               const std::vector<Interval_t> & intervals,
+               unsigned int indx=0);
+
+   /// @brief Construct from DSS keyword values.
+   /// @param colname The bare column name.
+   /// @param unit The DSUNIn value.
+   /// @param value The DSVALn value.
+   /// @param indx The vector element index, or 0 for scalar columns.
+   RangeSetCut(const std::string & colname, const std::string & unit,
+               const std::string & value, unsigned int indx);
+
+   virtual ~RangeSetCut() {}
+
+   virtual bool accept(tip::ConstTableRecord & row) const;
+
+   virtual bool accept(const std::map<std::string, double> & params) const;
+
+   /// @brief True if the value lies in one of the ranges.  This is a
+   ///        binary search over the sorted, disjoint ranges.
+   bool accept(double value) const;
+
+   virtual CutBase * clone() const {return new RangeSetCut(*this);}
+
+   /// @brief True if the cut is on the same column and every range
+   ///        of this cut lies within a range of the other.
+   virtual bool supercedes(const CutBase & cut) const;
+
+   virtual std::string filterString() const;
+
+   /// @brief The column name as it appears in the DSTYPn keyword,
+   ///        e.g., "PULSE_PHASE" or "CALIB_VERSION[1]".
+   const std::string & colname() const {
+      return m_fullName;
+   }
+
+   const std::string & unit() const {
+      return m_unit;
+   }
+
+   unsigned int index() const {
+      return m_index;
+   }
+
+   /// @brief The sorted, disjoint ranges.
+   const std::vector<Interval_t> & intervals() const {
+      return m_intervals;
+   }
+
+   /// @brief True if the value lies in the (min, max] range, or
+   ///        equals min if min == max.
+   static bool contains(const Interval_t & interval, double value) {
+      if (interval.first == interval.second) {
+         return value == interval.first;
+      }
+      return interval.first < value && value <= interval.second;
+   }
+
+protected:
+
+   virtual bool equals(const CutBase & rhs) const;
+
+   virtual void getKeyValues(std::string & type, std::string & unit,
+                             std::string & value, std::string & ref) const;
+
+private:
+
+   std::string m_colname;
+   std::string m_unit;
+   unsigned int m_index;
+   std::string m_fullName;
+
+   std::vector<Interval_t> m_intervals;
+
+   void setIntervals(std::vector<Interval_t> intervals);
+
+   double extractValue(tip::ConstTableRecord & row) const;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_RangeSetCut_h
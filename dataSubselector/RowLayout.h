@@ -0,0 +1,73 @@
+/**
+ * @file RowLayout.h
+ * @brief The byte layout of the rows of a FITS binary table.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_RowLayout_h
+#define dataSubselector_RowLayout_h
+
+#include <string>
+#include <vector>
+
+namespace dataSubselector {
+
+/**
+ * @class RowLayout
+ * @brief The position and encoding of each column within a row of a
+ * binary table, as given by its TTYPEn, TFORMn, TSCALn, and TZEROn
+ * keywords, for working with the raw bytes of the rows.  For a
+ * tile-compressed table, this is the layout of the uncompressed rows,
+ * as given by ZNAXIS1 and the ZFORMn keywords.
+ */
+
+class RowLayout {
+
+public:
+
+   struct Field {
+      std::string name;
+      /// The offset and number of bytes within a row.
+      long offset;
+      long width;
+      /// The TFORM data type code, e.g., 'D' or 'X', and repeat
+      /// count, which is the number of bits for an 'X' column.
+      char type;
+      long repeat;
+      double scale;
+      double zero;
+   };
+
+   RowLayout(const std::string & fitsFile, const std::string & extension);
+
+   /// @brief The number of bytes per row.
+   long rowSize() const {
+      return m_rowSize;
+   }
+
+   const std::vector<Field> & fields() const {
+      return m_fields;
+   }
+
+   /// @return The field with the given name, compared without regard
+   ///         to case, or 0 if there is none.
+   const Field * field(const std::string & name) const;
+
+   /// @brief True if any column is variable-length ('P' or 'Q').
+   ///        The rows of such a table hold descriptors into the heap,
+   ///        so they cannot be copied as raw bytes.
+   bool hasVariableLength() const;
+
+private:
+
+   long m_rowSize;
+
+   std::vector<Field> m_fields;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_RowLayout_h
@@ -0,0 +1,155 @@
+/**
+ * @file RowSelection.h
+ * @brief The rows of an event table that pass a set of cuts, stored
+ * as ranges of row numbers rather than as a copy of the rows.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_RowSelection_h
+#define dataSubselector_RowSelection_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tip/tip_types.h"
+
+namespace tip {
+   class Table;
+}
+
+namespace dataSubselector {
+
+class CompressedTable;
+class Cuts;
+class Gti;
+
+/**
+ * @class RowSelection
+ * @brief A selection of rows of an event table, stored as sorted,
+ * disjoint row ranges.  Since the events passing typical cuts come in
+ * runs, this is usually far smaller than a list of row numbers, and
+ * tools that only need the selected events can read those ranges
+ * from the original file instead of a filtered copy.
+ *
+ * A selection is written to a FITS file with a SELECTION extension
+ * holding the ranges, delta-encoded as the number of rows skipped
+ * since the end of the previous range (ROW_GAP) and the number of
+ * rows in the range (NROWS).  Its header has the DSS keywords of the
+ * cuts and identifies the source table, and a GTI extension gives
+ * the GTIs that go with the selection.
+ *
+ * Selections of the same table can be combined with &= and |=, so
+ * that, e.g., a stored selection for one cut can be intersected with
+ * a fresh selection for another; see SelectionStore.
+ */
+
+class RowSelection {
+
+public:
+
+   /// A range of rows, [first, last), using 0-based indexing.
+   typedef std::pair<tip::Index_t, tip::Index_t> RowRange_t;
+
+   RowSelection() : m_nrows(0), m_numSelected(0) {}
+
+   /// @brief An empty selection of rows from an event table.
+   explicit RowSelection(const tip::Table & events);
+
+   /// @brief An empty selection of rows from an event table that may
+   ///        be tile-compressed.  The rows are counted as uncompressed.
+   explicit RowSelection(const CompressedTable & events);
+
+   /// @brief Read a selection file.
+   explicit RowSelection(const std::string & selectionFile);
+
+   /// @brief Add a row.  Rows must be added in increasing order.
+   void addRow(tip::Index_t row) {
+      if (!m_ranges.empty() && m_ranges.back().second == row) {
+         m_ranges.back().second++;
+         m_numSelected++;
+      } else {
+         addRange(RowRange_t(row, row + 1));
+      }
+   }
+
+   /// @brief Add a range of rows, which must follow those already
+   ///        added.
+   void addRange(const RowRange_t & range);
+
+   /// @brief True if the row is selected.
+   bool contains(tip::Index_t row) const;
+
+   /// @brief The number of selected rows.
+   tip::Index_t numSelected() const {
+      return m_numSelected;
+   }
+
+   const std::vector<RowRange_t> & ranges() const {
+      return m_ranges;
+   }
+
+   /// @brief True if the selection was made from this table, as
+   ///        judged by the number of rows and the DATASUM keyword.  A
+   ///        table without a DATASUM keyword never matches.
+   bool matches(const tip::Table & events) const;
+
+   /// @brief As above, for a table that may be tile-compressed, whose
+   ///        rows tip counts as tiles.
+   bool matches(const CompressedTable & events) const;
+
+   /// @brief True if both selections were made from the same table.
+   bool sameSource(const RowSelection & rhs) const {
+      return m_nrows == rhs.m_nrows && m_datasum == rhs.m_datasum;
+   }
+
+   /// @brief Keep only the rows that are also selected by rhs, e.g.,
+   ///        to combine the selections made by separate cuts.  Both
+   ///        selections must be from the same table.
+   RowSelection & operator&=(const RowSelection & rhs);
+
+   /// @brief Add the rows selected by rhs.  Both selections must be
+   ///        from the same table.
+   RowSelection & operator|=(const RowSelection & rhs);
+
+   /// @brief Write the selection to a FITS file.  An existing file
+   ///        is overwritten.
+   /// @param selectionFile The output file.
+   /// @param cuts The cuts used to make the selection.
+   /// @param gti The GTIs of the selected events.
+   /// @param eventFile The name of the source event file.
+   /// @param extension The name of the source event table.
+   void write(const std::string & selectionFile, const Cuts & cuts,
+              const Gti & gti, const std::string & eventFile="",
+              const std::string & extension="EVENTS") const;
+
+   /// @brief The source event file and table named in a selection
+   ///        file.
+   const std::string & sourceFile() const {
+      return m_sourceFile;
+   }
+
+   const std::string & sourceExtension() const {
+      return m_sourceExtension;
+   }
+
+private:
+
+   std::vector<RowRange_t> m_ranges;
+
+   /// The number of rows and DATASUM value of the event table.
+   tip::Index_t m_nrows;
+   std::string m_datasum;
+
+   tip::Index_t m_numSelected;
+
+   std::string m_sourceFile;
+   std::string m_sourceExtension;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_RowSelection_h
@@ -0,0 +1,93 @@
+/**
+ * @file SchemaCuts.h
+ * @brief Apply a set of Cuts to event values stored in flat arrays
+ * laid out according to a ColumnSchema.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_SchemaCuts_h
+#define dataSubselector_SchemaCuts_h
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dataSubselector/ColumnSchema.h"
+#include "dataSubselector/ConeIndex.h"
+#include "dataSubselector/CutBase.h"
+
+namespace dataSubselector {
+
+class Cuts;
+
+/**
+ * @class SchemaCuts
+ * @brief Cuts bound to a ColumnSchema.  Column names are resolved to
+ * slots once, at construction, so that each event can be tested
+ * without string lookups or memory allocation.  As with
+ * Cuts::accept(params), cuts on columns that are absent from the
+ * schema are passed.  Sky cone cuts are evaluated through a
+ * ConeIndex, so that the exact separation is only computed for
+ * events near the edge of the cone.
+ *
+ * Cut objects are shared among copies of a SchemaCuts object, which
+ * may be used concurrently from several threads.
+ */
+
+class SchemaCuts {
+
+public:
+
+   /// @param cuts The cuts to apply.  These are copied.
+   /// @param schema The layout of the value arrays.
+   SchemaCuts(const Cuts & cuts, const ColumnSchema & schema);
+
+   /// @brief True if the event passes all of the cuts.
+   /// @param values The event's values, indexed by schema slot.
+   bool accept(const double * values) const;
+
+   /// @brief Apply the cuts to a block of events stored column-wise.
+   /// @param columns Arrays of nevents values, indexed by schema slot.
+   /// @param nevents The number of events.
+   /// @param accepted Set to 1 for each event that passes, 0 otherwise.
+   void accept(const double * const * columns, size_t nevents,
+               std::vector<char> & accepted) const;
+
+   const ColumnSchema & schema() const {
+      return m_schema;
+   }
+
+   /// @brief Append the names of the columns used by a set of cuts,
+   ///        e.g., to build a schema for them.  Vector elements are
+   ///        named as in the DSS keywords, e.g., "CALIB_VERSION[1]".
+   static void columns(const Cuts & cuts, std::vector<std::string> & colnames);
+
+private:
+
+   /// A cut with its column slots resolved.
+   struct Term {
+      CutBase::Kind kind;
+      const CutBase * cut;
+      unsigned int slot;
+      unsigned int slot2;
+      const ConeIndex * index;
+   };
+
+   std::shared_ptr<const Cuts> m_cuts;
+
+   std::vector<std::shared_ptr<const ConeIndex> > m_coneIndices;
+
+   ColumnSchema m_schema;
+
+   std::vector<Term> m_terms;
+
+   static bool accept(const Term & term, double value, double value2);
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_SchemaCuts_h
@@ -0,0 +1,121 @@
+/**
+ * @file SelectionSplitter.h
+ * @brief Distribute the events of one pass over the input among
+ * several selections.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_SelectionSplitter_h
+#define dataSubselector_SelectionSplitter_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tip/tip_types.h"
+
+#include "dataSubselector/CompressedTable.h"
+#include "dataSubselector/ConeIndex.h"
+#include "dataSubselector/Cuts.h"
+
+namespace tip {
+   class Table;
+}
+
+namespace dataSubselector {
+
+class ColumnProjection;
+
+/**
+ * @class SelectionSplitter
+ * @brief Copy the events passing each of several sets of cuts to a
+ * separate output table while reading the input only once.  Cuts
+ * shared by all of the selections, typically the EVENT_CLASS,
+ * ZENITH_ANGLE, and input DSS cuts, are collected in common(), so
+ * they can be applied once by cfitsio as the input is read, and only
+ * the remaining cuts of each selection are tested per event.  If each
+ * selection has its own acceptance cone, e.g., for many ROIs, the
+ * selections whose cones contain an event are found from a ConeIndex.
+ *
+ * The output tables are grown in blocks of rows as events are
+ * accepted, so no more than one block per output is written beyond
+ * the accepted events.
+ */
+
+class SelectionSplitter {
+
+public:
+
+   /// @param selections The cuts of each selection.  These are copied.
+   /// @param blockSize The number of rows by which an output table is
+   ///        grown when it is full.
+   SelectionSplitter(const std::vector<Cuts> & selections,
+                     tip::Index_t blockSize=10000);
+
+   size_t size() const {
+      return m_residuals.size();
+   }
+
+   /// @brief The cuts shared by all of the selections.
+   const Cuts & common() const {
+      return m_common;
+   }
+
+   /// @brief The cuts of selection k that are not in common().
+   const Cuts & residual(size_t k) const {
+      return m_residuals.at(k);
+   }
+
+   /// @brief A cfitsio filter expression for the events that pass
+   ///        common() and at least one of the residual cuts.
+   std::string filterString() const;
+
+   /// @brief Append the rows of the input that pass the residual cuts
+   ///        of each selection to its output table.  The input rows
+   ///        are assumed to pass common(), e.g., if the input table
+   ///        was read with filterString().
+   /// @param input The input event table.
+   /// @param outputs The output tables, one per selection, with the
+   ///        same columns as the input or a subset of them.
+   /// @param nrows The number of rows in each output.  These are
+   ///        updated, and each output table is resized to match.
+   void copyRows(const tip::Table & input,
+                 const std::vector<tip::Table *> & outputs,
+                 std::vector<tip::Index_t> & nrows) const;
+
+   /// @brief As copyRows, for an input table that may be
+   ///        tile-compressed and outputs that may be compressed.  The
+   ///        input is read a block of rows at a time, the rows that
+   ///        pass the filter expression are tested against the
+   ///        residual cuts via SchemaCuts, and the raw rows are
+   ///        appended to the outputs.
+   /// @param input The input event table.
+   /// @param filterString A cfitsio filter expression, e.g.,
+   ///        filterString(), that the rows must also pass.
+   /// @param outputs The output tables, one per selection.
+   /// @param projection If not null, only its columns are written.
+   void appendRows(const CompressedTable & input,
+                   const std::string & filterString,
+                   const std::vector<CompressedTable::Writer *> & outputs,
+                   const ColumnProjection * projection=0) const;
+
+private:
+
+   tip::Index_t m_blockSize;
+
+   Cuts m_common;
+
+   std::vector<Cuts> m_residuals;
+
+   /// If each selection has one cone, the cones of the selections
+   /// and their residual cuts without the cones.
+   std::unique_ptr<ConeIndex> m_coneIndex;
+   std::vector<Cuts> m_otherCuts;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_SelectionSplitter_h
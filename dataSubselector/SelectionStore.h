@@ -0,0 +1,78 @@
+/**
+ * @file SelectionStore.h
+ * @brief A directory of RowSelection files, one for each cut applied
+ * to an event table.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_SelectionStore_h
+#define dataSubselector_SelectionStore_h
+
+#include <string>
+
+namespace tip {
+   class Table;
+}
+
+namespace dataSubselector {
+
+class CutBase;
+class RowSelection;
+
+/**
+ * @class SelectionStore
+ * @brief Stores the selection made by each individual cut on an event
+ * table, so that repeated analyses of the same data need only
+ * evaluate the cuts that change; see Cuts::select(events, store).
+ *
+ * A selection is keyed by a hash of the cut's DSS description, with
+ * the intervals of a GtiCut at full precision, and by the number of
+ * rows and DATASUM of the table.  Tables without a DATASUM keyword cannot be
+ * identified, so their selections are not stored.
+ */
+
+class SelectionStore {
+
+public:
+
+   /// @param directory An existing directory for the selection files.
+   explicit SelectionStore(const std::string & directory);
+
+   /// @brief True if the store has a selection for this cut and table.
+   bool contains(const CutBase & cut, const tip::Table & events) const;
+
+   /// @brief Read the selection for a cut.
+   /// @return False if there is no selection for this cut and table.
+   bool find(const CutBase & cut, const tip::Table & events,
+             RowSelection & selection) const;
+
+   /// @brief Add the selection made by a cut, replacing any existing
+   ///        selection.  The file is written under a temporary name
+   ///        and then renamed, so that concurrent readers never see
+   ///        a partial file.
+   void store(const CutBase & cut, const tip::Table & events,
+              const RowSelection & selection) const;
+
+   /// @return The selection file name for a cut and table, or an
+   ///         empty string if the table has no DATASUM keyword.
+   std::string fileName(const CutBase & cut, const tip::Table & events) const;
+
+   /// @brief A hash of the cut's DSS description, and for a GtiCut of
+   ///        its exact intervals, as 16 hex digits.
+   static std::string cutKey(const CutBase & cut);
+
+   const std::string & directory() const {
+      return m_directory;
+   }
+
+private:
+
+   std::string m_directory;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_SelectionStore_h
@@ -27,11 +27,11 @@ class SkyConeCut : public CutBase {
 public:
 
    SkyConeCut(double ra, double dec, double radius) 
-      : CutBase("SkyCone"), m_ra(ra), m_dec(dec),
+      : CutBase(SKYCONE), m_ra(ra), m_dec(dec),
         m_coneCenter(astro::SkyDir(ra, dec)), m_radius(radius) {}
 
    SkyConeCut(const astro::SkyDir & dir, double radius) : 
-      CutBase("SkyCone"), m_coneCenter(dir), m_radius(radius) {
+      CutBase(SKYCONE), m_coneCenter(dir), m_radius(radius) {
       m_ra = m_coneCenter.ra();
       m_dec = m_coneCenter.dec();
    }
@@ -45,6 +45,11 @@ public:
 
    virtual bool accept(const std::map<std::string, double> & params) const;
 
+   /// @brief True if the direction lies within the cone.
+   /// @param ra Right Ascension (J2000 degrees)
+   /// @param dec Declination (J2000 degrees)
+   bool accept(double ra, double dec) const;
+
    virtual CutBase * clone() const {return new SkyConeCut(*this);}
 
    virtual bool supercedes(const CutBase &) const;
@@ -78,7 +83,6 @@ private:
    astro::SkyDir m_coneCenter;
    double m_radius;
 
-   bool accept(double ra, double dec) const;
    void getArgs(const std::string & value, 
                 std::vector<std::string> & args) const;
 
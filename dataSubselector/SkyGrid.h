@@ -0,0 +1,85 @@
+/**
+ * @file SkyGrid.h
+ * @brief Division of the sky into declination bands and RA pixels of
+ * roughly equal area.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_SkyGrid_h
+#define dataSubselector_SkyGrid_h
+
+#include <vector>
+
+namespace dataSubselector {
+
+/**
+ * @class SkyGrid
+ * @brief The sky is divided into declination bands of equal height,
+ * and each band into equal RA intervals, with the number of RA pixels
+ * per band scaled by the cosine of the band's equatorward edge.
+ * Pixels are numbered from RA = 0 in the southernmost band.
+ */
+
+class SkyGrid {
+
+public:
+
+   /// @param pixelSize The approximate band height (degrees).  The
+   ///        actual height divides 180 degrees evenly.
+   SkyGrid(double pixelSize);
+
+   /// @brief The declination band height (degrees).
+   double bandHeight() const {
+      return m_bandHeight;
+   }
+
+   int numBands() const {
+      return static_cast<int>(m_nra.size());
+   }
+
+   unsigned int numPixels() const {
+      return m_bandStart.back();
+   }
+
+   /// @brief The band containing the declination (degrees).
+   int band(double dec) const;
+
+   unsigned int numRaPixels(int band) const {
+      return m_nra[band];
+   }
+
+   /// @brief The number of the first pixel of a band.
+   unsigned int bandStart(int band) const {
+      return m_bandStart[band];
+   }
+
+   /// @brief The pixel containing the direction.
+   /// @param ra Right Ascension (J2000 degrees)
+   /// @param dec Declination (J2000 degrees)
+   unsigned int pixel(double ra, double dec) const;
+
+   /// @brief The center of a pixel and the angular distance from the
+   ///        center to the farthest point in the pixel (degrees).
+   void pixelCircle(unsigned int pixel, double & ra, double & dec,
+                    double & radius) const;
+
+   /// @brief The angle (degrees) between two directions.
+   static double separation(double ra1, double dec1, double ra2, double dec2);
+
+private:
+
+   double m_bandHeight;
+
+   std::vector<unsigned int> m_nra;
+
+   /// The first pixel of each band, with the total number of pixels
+   /// as the last entry.
+   std::vector<unsigned int> m_bandStart;
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_SkyGrid_h
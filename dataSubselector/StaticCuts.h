@@ -0,0 +1,295 @@
+/**
+ * @file StaticCuts.h
+ * @brief A selection whose composition is fixed at compile time.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_StaticCuts_h
+#define dataSubselector_StaticCuts_h
+
+#include <cstddef>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+#include <vector>
+
+#include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/ColumnBlock.h"
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/GtiCut.h"
+#include "dataSubselector/RangeCut.h"
+#include "dataSubselector/SkyConeCut.h"
+#include "dataSubselector/VersionCut.h"
+
+namespace dataSubselector {
+
+/**
+ * @class BoundCut
+ * @brief A cut bound to the columns of a ColumnBlock that it reads.
+ * There is one specialization per concrete cut class.
+ */
+
+template <typename Cut_t> class BoundCut;
+
+template <> class BoundCut<RangeCut> {
+public:
+   BoundCut(const RangeCut & cut, const ColumnBlock & block)
+      : m_cut(cut), m_values(block.column(cut.colname())) {}
+   bool operator()(size_t i) const {
+      return m_values == 0 || m_cut.accept(m_values[i]);
+   }
+private:
+   const RangeCut & m_cut;
+   const double * m_values;
+};
+
+template <> class BoundCut<GtiCut> {
+public:
+   BoundCut(const GtiCut & cut, const ColumnBlock & block)
+      : m_cut(cut), m_times(block.column("TIME")) {}
+   bool operator()(size_t i) const {
+      return m_times == 0 || m_cut.accept(m_times[i]);
+   }
+private:
+   const GtiCut & m_cut;
+   const double * m_times;
+};
+
+template <> class BoundCut<SkyConeCut> {
+public:
+   BoundCut(const SkyConeCut & cut, const ColumnBlock & block)
+      : m_cut(cut), m_ra(block.column("RA")), m_dec(block.column("DEC")) {}
+   bool operator()(size_t i) const {
+      return m_ra == 0 || m_dec == 0 || m_cut.accept(m_ra[i], m_dec[i]);
+   }
+private:
+   const SkyConeCut & m_cut;
+   const double * m_ra;
+   const double * m_dec;
+};
+
+template <> class BoundCut<BitMaskCut> {
+public:
+   BoundCut(const BitMaskCut & cut, const ColumnBlock & block)
+      : m_cut(cut), m_values(block.column(cut.colname())) {}
+   bool operator()(size_t i) const {
+      return m_values == 0 
+         || m_cut.accept(static_cast<unsigned int>(m_values[i]));
+   }
+private:
+   const BitMaskCut & m_cut;
+   const double * m_values;
+};
+
+template <> class BoundCut<VersionCut> {
+public:
+   BoundCut(const VersionCut &, const ColumnBlock &) {}
+   bool operator()(size_t) const {
+      return true;
+   }
+};
+
+/**
+ * @class StaticCuts
+ * @brief A selection made up of a fixed list of cut types, e.g.,
+ *
+ *    StaticCuts<RangeCut, SkyConeCut, GtiCut, BitMaskCut>
+ *
+ * The cuts are held by value and evaluated with non-virtual calls,
+ * so that for a ColumnBlock the compiler can inline all of the
+ * predicates into a single loop over the events.  A StaticCuts can
+ * be built from, and converted back to, a Cuts object, so DSS
+ * keyword handling is unchanged.
+ */
+
+template <typename... Cut_t>
+class StaticCuts {
+
+public:
+
+   StaticCuts(const Cut_t &... cuts) : m_cuts(cuts...) {}
+
+   /// @brief Take the cuts from a Cuts object.  The n-th cut of a
+   ///        given type in the template argument list is the n-th
+   ///        cut of that type in the Cuts object.  An exception is
+   ///        thrown if the Cuts object has a different composition.
+   explicit StaticCuts(const Cuts & cuts)
+      : StaticCuts(cuts, positions(cuts),
+                   typename MakeIndices<sizeof...(Cut_t)>::type()) {}
+
+   /// @return The equivalent Cuts object.
+   Cuts cuts() const {
+      Cuts my_cuts;
+      AddTo adder = {my_cuts};
+      forEach(adder);
+      return my_cuts;
+   }
+
+   bool accept(tip::ConstTableRecord & row) const {
+      RowAccept pred = {row};
+      return all(pred);
+   }
+
+   bool accept(const std::map<std::string, double> & params) const {
+      ParamsAccept pred = {params};
+      return all(pred);
+   }
+
+   /// @brief Evaluate the selection for every event in the block.
+   /// @param accepted Set to 1 for events that pass all cuts, 0 otherwise.
+   void accept(const ColumnBlock & block, std::vector<char> & accepted) const {
+      acceptBlock(block, accepted, typename MakeIndices<sizeof...(Cut_t)>::type());
+   }
+
+   /// @return The I-th cut.
+   template <std::size_t I>
+   const typename std::tuple_element<I, std::tuple<Cut_t...> >::type &
+   get() const {
+      return std::get<I>(m_cuts);
+   }
+
+   static std::size_t size() {
+      return sizeof...(Cut_t);
+   }
+
+private:
+
+   std::tuple<Cut_t...> m_cuts;
+
+   template <std::size_t... I> struct Indices {};
+
+   template <std::size_t N, std::size_t... I>
+   struct MakeIndices : MakeIndices<N - 1, N - 1, I...> {};
+
+   template <std::size_t... I>
+   struct MakeIndices<0, I...> {
+      typedef Indices<I...> type;
+   };
+
+   /// Short-circuiting conjunction over the cuts, in order.
+   template <std::size_t I, std::size_t N>
+   struct Loop {
+      template <typename Tuple, typename Pred>
+      static bool all(const Tuple & cuts, const Pred & pred) {
+         return pred(std::get<I>(cuts)) && Loop<I + 1, N>::all(cuts, pred);
+      }
+      template <typename Tuple, typename Func>
+      static void forEach(const Tuple & cuts, Func & func) {
+         func(std::get<I>(cuts));
+         Loop<I + 1, N>::forEach(cuts, func);
+      }
+   };
+
+   template <std::size_t N>
+   struct Loop<N, N> {
+      template <typename Tuple, typename Pred>
+      static bool all(const Tuple &, const Pred &) {
+         return true;
+      }
+      template <typename Tuple, typename Func>
+      static void forEach(const Tuple &, Func &) {}
+   };
+
+   template <typename Pred>
+   bool all(const Pred & pred) const {
+      return Loop<0, sizeof...(Cut_t)>::all(m_cuts, pred);
+   }
+
+   template <typename Func>
+   void forEach(Func & func) const {
+      Loop<0, sizeof...(Cut_t)>::forEach(m_cuts, func);
+   }
+
+   // The qualified calls below bypass the virtual dispatch.
+
+   struct RowAccept {
+      tip::ConstTableRecord & row;
+      template <typename Cut>
+      bool operator()(const Cut & cut) const {
+         return cut.Cut::accept(row);
+      }
+   };
+
+   struct ParamsAccept {
+      const std::map<std::string, double> & params;
+      template <typename Cut>
+      bool operator()(const Cut & cut) const {
+         return cut.Cut::accept(params);
+      }
+   };
+
+   struct RowIndex {
+      size_t i;
+      template <typename Bound>
+      bool operator()(const Bound & bound) const {
+         return bound(i);
+      }
+   };
+
+   struct AddTo {
+      Cuts & cuts;
+      template <typename Cut>
+      void operator()(const Cut & cut) {
+         cuts.addCut(cut);
+      }
+   };
+
+   template <std::size_t... I>
+   void acceptBlock(const ColumnBlock & block, std::vector<char> & accepted,
+                    Indices<I...>) const {
+      std::tuple<BoundCut<Cut_t>...> 
+         bound(BoundCut<Cut_t>(std::get<I>(m_cuts), block)...);
+      size_t nevents(block.size());
+      accepted.resize(nevents);
+      for (size_t i(0); i < nevents; i++) {
+         RowIndex pred = {i};
+         accepted[i] = Loop<0, sizeof...(Cut_t)>::all(bound, pred);
+      }
+   }
+
+   template <std::size_t... I>
+   StaticCuts(const Cuts & cuts, const std::vector<unsigned int> & pos,
+              Indices<I...>)
+      : m_cuts(dynamic_cast<const Cut_t &>(cuts[pos[I]])...) {}
+
+   /// @return The index in the Cuts object of the cut to use for
+   /// each template argument.
+   static std::vector<unsigned int> positions(const Cuts & cuts) {
+      if (cuts.size() != sizeof...(Cut_t)) {
+         std::ostringstream message;
+         message << "dataSubselector::StaticCuts: selection has "
+                 << cuts.size() << " cuts, expected " << sizeof...(Cut_t);
+         throw std::runtime_error(message.str());
+      }
+      const std::type_info * types[] = {&typeid(Cut_t)...};
+      std::vector<bool> used(cuts.size(), false);
+      std::vector<unsigned int> pos;
+      for (std::size_t k(0); k < sizeof...(Cut_t); k++) {
+         unsigned int i(0);
+         for ( ; i < cuts.size(); i++) {
+            if (!used[i] && typeid(cuts[i]) == *types[k]) {
+               break;
+            }
+         }
+         if (i == cuts.size()) {
+            std::ostringstream message;
+            message << "dataSubselector::StaticCuts: selection does not "
+                    << "match the cut types, e.g., " << types[k]->name();
+            throw std::runtime_error(message.str());
+         }
+         used[i] = true;
+         pos.push_back(i);
+      }
+      return pos;
+   }
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_StaticCuts_h
@@ -0,0 +1,98 @@
+/**
+ * @file TimePlanner.h
+ * @brief Find the row ranges of a TIME-sorted table that can pass the
+ * time cuts in a set of Cuts.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_TimePlanner_h
+#define dataSubselector_TimePlanner_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tip/tip_types.h"
+
+namespace tip {
+   class Table;
+}
+
+namespace dataSubselector {
+
+class Cuts;
+class Gti;
+
+/**
+ * @class TimePlanner
+ * @brief Intersect the GtiCuts and TIME RangeCuts of a set of Cuts
+ * and locate the rows that lie within the allowed times by binary
+ * search of the TIME column.  Only those rows need to be read and
+ * filtered.  The allowed times are treated as closed intervals, so
+ * that the row ranges include every row that can pass; the cuts
+ * themselves must still be applied to those rows.
+ */
+
+class TimePlanner {
+
+public:
+
+   typedef std::pair<double, double> Interval_t;
+
+   /// A range of rows, [first, last), using 0-based indexing.
+   typedef std::pair<tip::Index_t, tip::Index_t> RowRange_t;
+
+   /// @param cuts The GtiCuts and TIME RangeCuts to be used.
+   TimePlanner(const Cuts & cuts);
+
+   /// @brief Further restrict the allowed times, e.g., to the GTIs
+   ///        of the input file.
+   void addGti(const Gti & gti);
+
+   /// @brief True if any time cuts have been applied.
+   bool restricted() const {
+      return m_restricted;
+   }
+
+   /// @brief The sorted, disjoint, allowed time intervals.
+   const std::vector<Interval_t> & intervals() const {
+      return m_intervals;
+   }
+
+   /// @brief Find the rows of a table, sorted by the time column,
+   ///        that lie within the allowed time intervals.
+   /// @param table The table to be filtered.
+   /// @param ranges The sorted, disjoint row ranges.
+   /// @param timeColumn The name of the column holding the times.
+   void rowRanges(const tip::Table & table,
+                  std::vector<RowRange_t> & ranges,
+                  const std::string & timeColumn="TIME") const;
+
+   /// @brief Spot-check that the time column is sorted by reading
+   ///        the values at evenly spaced rows.  This will not detect
+   ///        every unsorted table, e.g., a merged file that is out of
+   ///        order locally, so it is no proof that rowRanges() is
+   ///        safe, but it does catch concatenations of files that are
+   ///        out of time order.
+   /// @param table The table to check.
+   /// @param timeColumn The name of the column holding the times.
+   /// @param nsamples The number of rows to read.
+   static bool isSorted(const tip::Table & table,
+                        const std::string & timeColumn="TIME",
+                        tip::Index_t nsamples=1000);
+
+private:
+
+   bool m_restricted;
+
+   std::vector<Interval_t> m_intervals;
+
+   void intersect(std::vector<Interval_t> intervals);
+
+};
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_TimePlanner_h
@@ -5,6 +5,7 @@ def generate(env, **kw):
     env.Tool('tipLib')
     env.Tool('astroLib')
     env.Tool('st_facilitiesLib')
+    env.Tool('st_appLib')
     env.Tool('facilitiesLib')
     env.Tool('irfLoaderLib')
     env.Tool('evtbinLib')
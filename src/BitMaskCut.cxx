@@ -12,12 +12,16 @@
 #include <cstdlib>
 #include <cmath>
 
+#include <algorithm>
 #include <iomanip>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 
 #include "st_stream/StreamFormatter.h"
-#include "facilities/Util.h"
+#include "facilities/commonUtilities.h"
+#include "st_facilities/Environment.h"
 #include "st_facilities/Util.h"
 #include "tip/Table.h"
 
@@ -27,19 +31,27 @@ namespace {
 unsigned int bitPosition(unsigned int mask) {
    return static_cast<unsigned int>(std::log(mask)/std::log(2.));
 }
+
+bool mask_comp(const std::pair<unsigned int, unsigned int> & a,
+               const std::pair<unsigned int, unsigned int> & b) {
+   return a.first < b.first;
+}
 }
 
 namespace dataSubselector {
 
-BitMaskCut::BitMaskPrecedence * BitMaskCut::s_evclassPrecedence(0);
-
-BitMaskCut::BitMaskPrecedence * BitMaskCut::s_evtypePrecedence(0);
+BitMaskCut::ValidityMasksPtr BitMaskCut::s_validityMasks;
 
 BitMaskCut::BitMaskCut(const std::string & colname,
                        unsigned int mask,
-                       const std::string & pass_ver) 
-   : CutBase("bit_mask"), m_colname(colname), m_mask(mask),
-     m_pass_ver(pass_ver), m_post_P7(post_P7(pass_ver)) {
+                       const std::string & pass_ver,
+                       const ValidityMasksPtr & masks) 
+   : CutBase(BIT_MASK), m_colname(colname), m_mask(mask),
+     m_pass_ver(pass_ver), m_post_P7(post_P7(pass_ver)),
+     m_validityMasks(masks) {
+   if (!m_validityMasks) {
+      m_validityMasks = validityMasks();
+   }
 }
 
 bool BitMaskCut::accept(tip::ConstTableRecord & row) const {
@@ -57,23 +69,17 @@ bool BitMaskCut::accept(const std::map<std::string, double> & params) const {
    return true;
 }
 
-bool BitMaskCut::accept(unsigned int value) const {
-   bool result((value & m_mask) != 0);
-   return result;
-}
-
 bool BitMaskCut::supercedes(const CutBase & cut) const {
-   if (cut.type() != "bit_mask") {
+   if (cut.kind() != BIT_MASK) {
       return false;
    }
-   BitMaskCut & bitMaskCut = 
-      dynamic_cast<BitMaskCut &>(const_cast<CutBase &>(cut));
+   const BitMaskCut & bitMaskCut = static_cast<const BitMaskCut &>(cut);
    if (bitMaskCut.colname() != m_colname) {
       return false;
    }
    if (m_colname == "EVENT_TYPE") {
-      bool valid_mask 
-         = s_evtypePrecedence->validMask(*this, bitMaskCut.mask());
+      bool valid_mask = currentValidityMasks()->evtype()
+         .validMask(*this, bitMaskCut.mask());
       if (!valid_mask) {
          throw std::runtime_error("The requested evtype selection, " +
                                   this->dstype() + " is inconsistent "
@@ -84,8 +90,8 @@ bool BitMaskCut::supercedes(const CutBase & cut) const {
    }
    if (m_colname == "EVENT_CLASS") {
       if (m_post_P7) {
-         bool valid_mask 
-            = s_evclassPrecedence->validMask(*this, bitMaskCut.mask());
+         bool valid_mask = currentValidityMasks()->evclass()
+            .validMask(*this, bitMaskCut.mask());
          if (!valid_mask) {
             throw std::runtime_error("The requested evclass selection, " +
                                      this->dstype() + " is inconsistent "
@@ -182,19 +188,46 @@ BitMaskPrecedence(const std::string & maskFile)
    : m_maskFile(maskFile) {
    std::vector<std::string> lines;
    st_facilities::Util::readLines(maskFile, lines, "#", true);
+   m_validityMasks.reserve(lines.size());
    for (size_t i(0); i < lines.size(); i++) {
-      std::vector<std::string> tokens;
-      facilities::Util::stringTokenize(lines[i], ",", tokens);
-      m_validityMasks[std::atoi(tokens.at(0).c_str())]
-         = std::atoi(tokens.at(1).c_str());
+      const char * line(lines[i].c_str());
+      char * end;
+      unsigned int mask(std::strtoul(line, &end, 10));
+      while (*end == ' ' || *end == '\t') {
+         end++;
+      }
+      if (end == line || *end != ',') {
+         throw std::runtime_error("dataSubselector::BitMaskCut: "
+                                  "invalid line in " + maskFile + ": "
+                                  + lines[i]);
+      }
+      unsigned int validityMask(std::strtoul(end + 1, 0, 10));
+      m_validityMasks.push_back(std::make_pair(mask, validityMask));
+   }
+   // Sort on the bit mask, keeping the last entry for any duplicates
+   // as the previous std::map-based implementation did.
+   std::stable_sort(m_validityMasks.begin(), m_validityMasks.end(),
+                    ::mask_comp);
+   std::vector<std::pair<unsigned int, unsigned int> >::iterator last
+      = m_validityMasks.begin();
+   for (size_t i(1); i < m_validityMasks.size(); i++) {
+      if (m_validityMasks[i].first == last->first) {
+         *last = m_validityMasks[i];
+      } else {
+         *(++last) = m_validityMasks[i];
+      }
+   }
+   if (!m_validityMasks.empty()) {
+      m_validityMasks.erase(last + 1, m_validityMasks.end());
    }
 }
 
 bool BitMaskCut::BitMaskPrecedence::
 validMask(const BitMaskCut & self, unsigned int currentMask) const {
-   std::map<unsigned int, unsigned int>::const_iterator it
-      = m_validityMasks.find(currentMask);
-   if (it == m_validityMasks.end()) {
+   std::vector<std::pair<unsigned int, unsigned int> >::const_iterator it
+      = std::lower_bound(m_validityMasks.begin(), m_validityMasks.end(),
+                         std::make_pair(currentMask, 0u), ::mask_comp);
+   if (it == m_validityMasks.end() || it->first != currentMask) {
       std::ostringstream message;
       message << "Current bit mask, " << currentMask 
               << ", not found in validity mask file.";
@@ -208,13 +241,78 @@ const std::string & BitMaskCut::BitMaskPrecedence::maskFile() const {
    return m_maskFile;
 }
 
+BitMaskCut::ValidityMasksPtr BitMaskCut::currentValidityMasks() const {
+   // Cuts created before any masks were available use the ones that
+   // are current now.
+   ValidityMasksPtr masks(m_validityMasks ? m_validityMasks 
+                          : validityMasks());
+   if (!masks) {
+      throw std::runtime_error("dataSubselector::BitMaskCut: "
+                               "validity masks have not been set.");
+   }
+   return masks;
+}
+
 void BitMaskCut::setValidityMasks(const std::string & evclassFile,
                                   const std::string & evtypeFile) {
-   delete s_evclassPrecedence;
-   s_evclassPrecedence = new BitMaskCut::BitMaskPrecedence(evclassFile);
+   setValidityMasks(ValidityMasksPtr(new ValidityMasks(evclassFile,
+                                                       evtypeFile)));
+}
+
+void BitMaskCut::setValidityMasks(const ValidityMasksPtr & masks) {
+   std::atomic_store(&s_validityMasks, masks);
+}
+
+BitMaskCut::ValidityMasksPtr BitMaskCut::validityMasks() {
+   return std::atomic_load(&s_validityMasks);
+}
+
+BitMaskCut::ValidityMasksPtr 
+BitMaskCut::caldbValidityMasks(const std::string & caldb) {
+   static std::mutex registry_mutex;
+   static std::map<std::string, ValidityMasksPtr> registry;
+   std::lock_guard<std::mutex> lock(registry_mutex);
+   std::map<std::string, ValidityMasksPtr>::const_iterator it
+      = registry.find(caldb);
+   if (it != registry.end()) {
+      return it->second;
+   }
+   const char * subdirs[] = {"data", "glast", "lat", "bcf"};
+   std::string bcf(caldb);
+   for (size_t i(0); i < 4; i++) {
+      bcf = facilities::commonUtilities::joinPath(bcf, subdirs[i]);
+   }
+   std::string evclassPath = facilities::commonUtilities::joinPath(
+      bcf, "valid_evclass_selections.txt");
+   std::string evtypePath = facilities::commonUtilities::joinPath(
+      bcf, "valid_evtype_selections.txt");
+   ValidityMasksPtr masks(new ValidityMasks(evclassPath, evtypePath));
+   registry[caldb] = masks;
+   return masks;
+}
+
+void BitMaskCut::initValidityMasks() {
+   static std::once_flag init_flag;
+   std::call_once(init_flag, []() {
+         if (!validityMasks()) {
+            ValidityMasksPtr masks = 
+               caldbValidityMasks(st_facilities::Environment::getEnv("CALDB"));
+            // Do not replace masks set by another thread in the meantime.
+            ValidityMasksPtr none;
+            std::atomic_compare_exchange_strong(&s_validityMasks, 
+                                                &none, masks);
+         }
+      });
+}
+
+const void * BitMaskCut::evclassValidityMasks() {
+   ValidityMasksPtr masks(validityMasks());
+   return masks ? &masks->evclass() : 0;
+}
 
-   delete s_evtypePrecedence;
-   s_evtypePrecedence = new BitMaskCut::BitMaskPrecedence(evtypeFile);
+const void * BitMaskCut::evtypeValidityMasks() {
+   ValidityMasksPtr masks(validityMasks());
+   return masks ? &masks->evtype() : 0;
 }
 
 } // namespace dataSubselector 
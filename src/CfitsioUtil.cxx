@@ -0,0 +1,56 @@
+/**
+ * @file CfitsioUtil.cxx
+ * @brief cfitsio error handling and event table identity checks shared
+ * by the library sources.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdio>
+
+#include <stdexcept>
+
+#include "tip/Header.h"
+#include "tip/Table.h"
+#include "tip/TipException.h"
+
+#include "CfitsioUtil.h"
+
+namespace dataSubselector {
+
+namespace CfitsioUtil {
+
+void checkStatus(int status, const std::string & context, fitsfile * fptr) {
+   if (status != 0) {
+      fits_report_error(stderr, status);
+      if (fptr) {
+         int close_status(0);
+         fits_close_file(fptr, &close_status);
+      }
+      throw std::runtime_error("dataSubselector::" + context
+                               + ": cfitsio error.");
+   }
+}
+
+std::string datasum(const tip::Table & events) {
+   std::string value("");
+   try {
+      events.getHeader()["DATASUM"].get(value);
+   } catch (tip::TipException &) {
+   }
+   return value;
+}
+
+bool matches(const tip::Table & events, tip::Index_t nrows,
+             const std::string & datasum) {
+// Without a DATASUM, an edit that keeps the number of rows cannot be
+// detected, so the table is never taken to match.
+   std::string events_datasum(CfitsioUtil::datasum(events));
+   return (events.getNumRecords() == nrows && events_datasum != "" &&
+           events_datasum == datasum);
+}
+
+} // namespace CfitsioUtil
+
+} // namespace dataSubselector
@@ -0,0 +1,47 @@
+/**
+ * @file CfitsioUtil.h
+ * @brief cfitsio error handling and event table identity checks shared
+ * by the library sources.  This header is not installed.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#ifndef dataSubselector_CfitsioUtil_h
+#define dataSubselector_CfitsioUtil_h
+
+#include <string>
+
+#include "fitsio.h"
+
+#include "tip/tip_types.h"
+
+namespace tip {
+   class Table;
+}
+
+namespace dataSubselector {
+
+namespace CfitsioUtil {
+
+/// @brief If status is nonzero, report the cfitsio error stack, close
+///        fptr, if given, and throw std::runtime_error.
+/// @param context The class and routine for the exception message,
+///        e.g., "EventIndex::write".
+void checkStatus(int status, const std::string & context,
+                 fitsfile * fptr=0);
+
+/// @return The DATASUM keyword value of a table, or "" if there is none.
+std::string datasum(const tip::Table & events);
+
+/// @brief True if an event table has the given number of rows and
+///        DATASUM value, i.e., if it is the table from which an index
+///        or a selection with those values was made.
+bool matches(const tip::Table & events, tip::Index_t nrows,
+             const std::string & datasum);
+
+} // namespace CfitsioUtil
+
+} // namespace dataSubselector
+
+#endif // dataSubselector_CfitsioUtil_h
@@ -0,0 +1,139 @@
+/**
+ * @file ChunkScheduler.cxx
+ * @brief Apply a task to numbered chunks of work using a pool of
+ * threads that steal work from each other.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "dataSubselector/ChunkScheduler.h"
+
+namespace {
+   /// The chunks that remain in one thread's block.
+   struct WorkQueue {
+      std::mutex mutex;
+      std::deque<size_t> chunks;
+   };
+
+   /// Take a chunk from the front of a thread's own queue.
+   bool popFront(WorkQueue & queue, size_t & chunk) {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.chunks.empty()) {
+         return false;
+      }
+      chunk = queue.chunks.front();
+      queue.chunks.pop_front();
+      return true;
+   }
+
+   /// Take a chunk from the back of another thread's queue, far from
+   /// where its owner is working.
+   bool popBack(WorkQueue & queue, size_t & chunk) {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.chunks.empty()) {
+         return false;
+      }
+      chunk = queue.chunks.back();
+      queue.chunks.pop_back();
+      return true;
+   }
+}
+
+namespace dataSubselector {
+
+ChunkScheduler::ChunkScheduler(unsigned int nthreads)
+   : m_nthreads(nthreads), m_numSteals(0) {
+   if (nthreads == 0) {
+      throw std::runtime_error("ChunkScheduler: the number of threads "
+                               "must be positive.");
+   }
+}
+
+void ChunkScheduler::run(size_t nchunks, const Task_t & task) {
+   m_numSteals = 0;
+   unsigned int nthreads(std::min<size_t>(m_nthreads, nchunks));
+   if (nthreads <= 1) {
+      for (size_t chunk(0); chunk < nchunks; chunk++) {
+         task(chunk, 0);
+      }
+      return;
+   }
+
+// Give each thread a contiguous block of chunks.  No chunks are added
+// once the threads start, so a thread is finished when it finds every
+// queue empty.
+   std::vector<std::unique_ptr<WorkQueue> > queues;
+   for (unsigned int i(0); i < nthreads; i++) {
+      queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+      size_t first(nchunks*i/nthreads);
+      size_t last(nchunks*(i + 1)/nthreads);
+      for (size_t chunk(first); chunk < last; chunk++) {
+         queues.back()->chunks.push_back(chunk);
+      }
+   }
+
+   std::atomic<bool> failed(false);
+   std::atomic<size_t> numSteals(0);
+   std::exception_ptr error;
+   std::mutex errorMutex;
+   auto work = [&](unsigned int thread) {
+      try {
+         size_t chunk;
+         while (!failed) {
+            if (popFront(*queues[thread], chunk)) {
+               task(chunk, thread);
+               continue;
+            }
+            bool stolen(false);
+            for (unsigned int i(1); i < nthreads && !stolen; i++) {
+               stolen = popBack(*queues[(thread + i) % nthreads], chunk);
+            }
+            if (!stolen) {
+               return;
+            }
+            numSteals++;
+            task(chunk, thread);
+         }
+      } catch (...) {
+         std::lock_guard<std::mutex> lock(errorMutex);
+         if (!error) {
+            error = std::current_exception();
+         }
+         failed = true;
+      }
+   };
+
+   std::vector<std::thread> threads;
+   for (unsigned int i(1); i < nthreads; i++) {
+      threads.push_back(std::thread(work, i));
+   }
+   work(0);
+   for (size_t i(0); i < threads.size(); i++) {
+      threads[i].join();
+   }
+   m_numSteals = numSteals;
+   if (error) {
+      std::rethrow_exception(error);
+   }
+}
+
+void ChunkScheduler::prefixSums(const std::vector<size_t> & counts,
+                                std::vector<size_t> & offsets) {
+   offsets.resize(counts.size() + 1);
+   offsets[0] = 0;
+   for (size_t i(0); i < counts.size(); i++) {
+      offsets[i + 1] = offsets[i] + counts[i];
+   }
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,152 @@
+/**
+ * @file ColumnProjection.cxx
+ * @brief Write a subset of the columns of an event table.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "fitsio.h"
+
+#include "facilities/Util.h"
+
+#include "dataSubselector/ColumnProjection.h"
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/RangeSetCut.h"
+#include "dataSubselector/RowLayout.h"
+
+#include "CfitsioUtil.h"
+
+namespace {
+   std::string toUpper(std::string name) {
+      std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+      return name;
+   }
+}
+
+namespace dataSubselector {
+
+ColumnProjection::
+ColumnProjection(const std::string & fitsFile, const std::string & extension,
+                 const std::vector<std::string> & colnames) {
+   RowLayout layout(fitsFile, extension);
+   m_inputRowSize = layout.rowSize();
+   m_outputRowSize = m_inputRowSize;
+   if (colnames.empty()) {
+      m_segments.push_back(std::make_pair(0L, m_inputRowSize));
+      return;
+   }
+   std::vector<bool> keep(layout.fields().size(), false);
+   for (size_t i(0); i < colnames.size(); i++) {
+      const RowLayout::Field * field(layout.field(colnames[i]));
+      if (field == 0) {
+         throw std::runtime_error("ColumnProjection: column " + colnames[i]
+                                  + " is not in " + fitsFile + "["
+                                  + extension + "].");
+      }
+      keep[field - &layout.fields()[0]] = true;
+   }
+
+// Join adjacent kept columns into segments, so that a row is packed
+// with as few copies as possible.
+   m_outputRowSize = 0;
+   for (size_t i(0); i < keep.size(); i++) {
+      const RowLayout::Field & field(layout.fields()[i]);
+      if (!keep[i]) {
+         m_dropped.push_back(field.name);
+         continue;
+      }
+      if (!m_segments.empty() &&
+          m_segments.back().first + m_segments.back().second == field.offset) {
+         m_segments.back().second += field.width;
+      } else {
+         m_segments.push_back(std::make_pair(field.offset, field.width));
+      }
+      m_outputRowSize += field.width;
+   }
+}
+
+void ColumnProjection::project(const unsigned char * input, long nrows,
+                               unsigned char * output) const {
+// Each segment moves toward the start of the buffer, so the rows can
+// be packed in place, in order.
+   for (long row(0); row < nrows; row++) {
+      const unsigned char * in(input + row*m_inputRowSize);
+      unsigned char * out(output + row*m_outputRowSize);
+      for (size_t j(0); j < m_segments.size(); j++) {
+         std::memmove(out, in + m_segments[j].first, m_segments[j].second);
+         out += m_segments[j].second;
+      }
+   }
+}
+
+void ColumnProjection::removeColumns(const std::string & fitsFile,
+                                     const std::string & extension) const {
+   if (!active()) {
+      return;
+   }
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, fitsFile.c_str(), READWRITE, &status);
+   CfitsioUtil::checkStatus(status, "ColumnProjection");
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   for (size_t i(0); i < m_dropped.size() && status == 0; i++) {
+      int colnum(0);
+      fits_get_colnum(fptr, CASEINSEN, const_cast<char *>(m_dropped[i].c_str()),
+                      &colnum, &status);
+      fits_delete_col(fptr, colnum, &status);
+   }
+   CfitsioUtil::checkStatus(status, "ColumnProjection", fptr);
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "ColumnProjection");
+}
+
+void ColumnProjection::parseColumns(const std::string & columns,
+                                    std::vector<std::string> & colnames) {
+   colnames.clear();
+   if (columns == "" || columns == "all" || columns == "ALL") {
+      return;
+   }
+   std::vector<std::string> tokens;
+   facilities::Util::stringTokenize(columns, ", ", tokens);
+   for (size_t i(0); i < tokens.size(); i++) {
+      if (tokens[i] != "") {
+         colnames.push_back(tokens[i]);
+      }
+   }
+}
+
+void ColumnProjection::addCutColumns(const Cuts & cuts,
+                                     std::vector<std::string> & colnames) {
+   if (colnames.empty()) {
+      return;
+   }
+   for (unsigned int i(0); i < cuts.size(); i++) {
+      std::string colname;
+      if (cuts[i].kind() == CutBase::RANGE) {
+         colname = static_cast<const RangeCut &>(cuts[i]).colname();
+      } else if (cuts[i].kind() == CutBase::RANGE_SET) {
+         colname = static_cast<const RangeSetCut &>(cuts[i]).colname();
+      } else {
+         continue;
+      }
+      colname = toUpper(colname.substr(0, colname.find("[")));
+      bool found(false);
+      for (size_t j(0); j < colnames.size() && !found; j++) {
+         found = (toUpper(colnames[j]) == colname);
+      }
+      if (!found) {
+         colnames.push_back(colname);
+      }
+   }
+}
+
+} // namespace dataSubselector
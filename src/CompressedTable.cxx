@@ -0,0 +1,855 @@
+/**
+ * @file CompressedTable.cxx
+ * @brief Tile-compressed event tables, for writing compact filtered
+ * event files and reading them back.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "fitsio.h"
+
+#include "tip/Header.h"
+#include "tip/TipException.h"
+
+#include "dataSubselector/ColumnProjection.h"
+#include "dataSubselector/ColumnSchema.h"
+#include "dataSubselector/CompressedTable.h"
+#include "dataSubselector/SchemaCuts.h"
+
+#include "CfitsioUtil.h"
+
+namespace {
+   bool ztable(fitsfile * fptr, int & status) {
+      int value(0);
+      fits_read_key(fptr, TLOGICAL, "ZTABLE", &value, 0, &status);
+      if (status == KEY_NO_EXIST) {
+         status = 0;
+         value = 0;
+      }
+      return value != 0;
+   }
+
+   /// Read an integer keyword that may be absent.
+   LONGLONG readKey(fitsfile * fptr, const char * keyword,
+                    LONGLONG defaultValue, int & status) {
+      LONGLONG value(defaultValue);
+      fits_read_key(fptr, TLONGLONG, keyword, &value, 0, &status);
+      if (status == KEY_NO_EXIST) {
+         status = 0;
+         value = defaultValue;
+      }
+      return value;
+   }
+
+   void deleteKey(fitsfile * fptr, const char * keyword, int & status) {
+      fits_delete_key(fptr, keyword, &status);
+      if (status == KEY_NO_EXIST) {
+         status = 0;
+      }
+   }
+
+   /// Create a memory file with a null primary HDU, to which tables
+   /// can be appended.
+   fitsfile * createMemFile(int & status) {
+      fitsfile * fptr(0);
+      fits_create_file(&fptr, "mem://", &status);
+      fits_create_img(fptr, BYTE_IMG, 0, 0, &status);
+      return fptr;
+   }
+
+   void closeFile(fitsfile *& fptr) {
+      if (fptr) {
+         int status(0);
+         fits_close_file(fptr, &status);
+         fptr = 0;
+      }
+   }
+
+   /// Copy the compressed bytes of each column of a tile, i.e., of a
+   /// row of a compressed table, to a row of another compressed table
+   /// with the same columns.  The row of the output must exist.
+   void copyTile(fitsfile * infptr, LONGLONG inRow, fitsfile * outfptr,
+                 LONGLONG outRow, int & status) {
+      int ncols(0);
+      fits_get_num_cols(infptr, &ncols, &status);
+      std::vector<unsigned char> bytes;
+      for (int col(1); col <= ncols && status == 0; col++) {
+         int typecode(0);
+         long repeat(0);
+         long width(0);
+         fits_get_coltype(infptr, col, &typecode, &repeat, &width, &status);
+         if (status == 0 && typecode >= 0) {
+            throw std::runtime_error("dataSubselector::CompressedTable: "
+                                     "the columns of a compressed table "
+                                     "are expected to be variable-length "
+                                     "byte arrays.");
+         }
+         LONGLONG nbytes(0);
+         LONGLONG offset(0);
+         fits_read_descriptll(infptr, col, inRow, &nbytes, &offset, &status);
+         if (status != 0 || nbytes == 0) {
+            continue;
+         }
+         bytes.resize(nbytes);
+         int anynul(0);
+         fits_read_col(infptr, TBYTE, col, inRow, 1, nbytes, 0, &bytes[0],
+                       &anynul, &status);
+         fits_write_col(outfptr, TBYTE, col, outRow, 1, nbytes, &bytes[0],
+                        &status);
+      }
+   }
+
+   /// Append the rows of tiles [tile0, tile1) of the compressed table
+   /// at the current HDU of infptr to outfptr as an uncompressed
+   /// table.  cfitsio can only uncompress whole tables, so those
+   /// tiles are first copied to a compressed table of their own.
+   /// @param tileRows The number of rows per tile, ZTILELEN.
+   /// @param nrows The number of rows in the table, ZNAXIS2.
+   void uncompressTiles(fitsfile * infptr, LONGLONG tile0, LONGLONG tile1,
+                        LONGLONG tileRows, LONGLONG nrows, fitsfile * outfptr,
+                        int & status) {
+      fitsfile * subset(createMemFile(status));
+      fits_copy_header(infptr, subset, &status);
+      fits_modify_key_lng(subset, "NAXIS2", 0, 0, &status);
+      fits_modify_key_lng(subset, "PCOUNT", 0, 0, &status);
+      deleteKey(subset, "THEAP", status);
+      fits_set_hdustruc(subset, &status);
+      fits_insert_rows(subset, 0, tile1 - tile0, &status);
+      try {
+         for (LONGLONG tile(tile0); tile < tile1 && status == 0; tile++) {
+            copyTile(infptr, tile + 1, subset, tile - tile0 + 1, status);
+         }
+      } catch (...) {
+         closeFile(subset);
+         throw;
+      }
+      LONGLONG subsetRows(std::min(tile1*tileRows, nrows) - tile0*tileRows);
+      fits_modify_key_lng(subset, "ZNAXIS2", std::max(subsetRows, 0LL), 0,
+                          &status);
+      fits_uncompress_table(subset, outfptr, &status);
+      closeFile(subset);
+   }
+
+   /// Split a column name such as CALIB_VERSION[1] into the name and
+   /// the 1-based element index, which is 0 for a plain name.
+   std::string columnName(const std::string & colname, long & index) {
+      index = 0;
+      std::string::size_type pos(colname.find("["));
+      if (pos == std::string::npos) {
+         return colname;
+      }
+      index = std::atol(colname.substr(pos + 1).c_str());
+      return colname.substr(0, pos);
+   }
+}
+
+namespace dataSubselector {
+
+/// The original table, and a memory file holding the other HDUs and
+/// the uncompressed rows of the tiles read last.
+struct CompressedTable::FitsHandle {
+   fitsfile * fptr;
+   int hdu;
+   bool compressed;
+   LONGLONG nrows;
+   LONGLONG ntiles;
+   LONGLONG tileRows;
+   fitsfile * window;
+   LONGLONG windowFirst;
+   LONGLONG windowRows;
+
+   ~FitsHandle() {
+      closeFile(window);
+      closeFile(fptr);
+   }
+
+   /// @return The table holding the uncompressed rows [first, first +
+   ///         count), and set row to the 1-based number of the first
+   ///         of them within it.
+   fitsfile * rows(LONGLONG first, LONGLONG count, LONGLONG & row,
+                   int & status) {
+      if (!compressed) {
+         row = first + 1;
+         return fptr;
+      }
+      if (window == 0 || first < windowFirst
+          || first + count > windowFirst + windowRows) {
+         LONGLONG tile0(first/tileRows);
+         LONGLONG tile1(count > 0 ? (first + count - 1)/tileRows + 1 : tile0);
+         load(std::min(tile0, ntiles), std::min(tile1, ntiles), status);
+      }
+      row = first - windowFirst + 1;
+      return window;
+   }
+
+   /// Rebuild the memory file with the rows of tiles [tile0, tile1).
+   /// The other HDUs are copied as well, so that the file can be used
+   /// as a copy of the original, e.g., for gtifilter().
+   void load(LONGLONG tile0, LONGLONG tile1, int & status) {
+      closeFile(window);
+      int nhdus(0);
+      fits_get_num_hdus(fptr, &nhdus, &status);
+      fits_create_file(&window, "mem://", &status);
+      for (int i(1); i <= nhdus && status == 0; i++) {
+         fits_movabs_hdu(fptr, i, 0, &status);
+         if (i != hdu) {
+            fits_copy_hdu(fptr, window, 0, &status);
+         } else {
+            uncompressTiles(fptr, tile0, tile1, tileRows, nrows, window,
+                            status);
+         }
+      }
+      int move_status(0);
+      fits_movabs_hdu(fptr, hdu, 0, &move_status);
+      fits_movabs_hdu(window, hdu, 0, &status);
+      if (status != 0) {
+         closeFile(window);
+      }
+      windowFirst = tile0*tileRows;
+      windowRows = std::min(tile1*tileRows, nrows) - windowFirst;
+   }
+};
+
+CompressedTable::CompressedTable(const std::string & fitsFile,
+                                 const std::string & extension)
+   : m_fileName(fitsFile), m_extension(extension), m_fits(0),
+     m_compressed(false), m_nrows(0), m_rowSize(0), m_tileRows(1) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, fitsFile.c_str(), READONLY, &status);
+   CfitsioUtil::checkStatus(status, "CompressedTable");
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   m_compressed = ztable(fptr, status);
+   LONGLONG ntiles(0);
+   LONGLONG nrows(0);
+   LONGLONG tileRows(0);
+   fits_get_num_rowsll(fptr, &ntiles, &status);
+   if (m_compressed) {
+      fits_read_key(fptr, TLONG, "ZNAXIS1", &m_rowSize, 0, &status);
+      fits_read_key(fptr, TLONGLONG, "ZNAXIS2", &nrows, 0, &status);
+      tileRows = readKey(fptr, "ZTILELEN", nrows, status);
+   } else {
+      fits_read_key(fptr, TLONG, "NAXIS1", &m_rowSize, 0, &status);
+      nrows = ntiles;
+      tileRows = nrows;
+   }
+   char datasum[FLEN_VALUE];
+   fits_read_key(fptr, TSTRING, "DATASUM", datasum, 0, &status);
+   if (status == KEY_NO_EXIST) {
+      status = 0;
+      datasum[0] = '\0';
+   }
+   CfitsioUtil::checkStatus(status, "CompressedTable", fptr);
+   m_nrows = nrows;
+   m_tileRows = std::max(tileRows, 1LL);
+   m_datasum = datasum;
+   m_fits = new FitsHandle();
+   m_fits->fptr = fptr;
+   fits_get_hdu_num(fptr, &m_fits->hdu);
+   m_fits->compressed = m_compressed;
+   m_fits->nrows = nrows;
+   m_fits->ntiles = ntiles;
+   m_fits->tileRows = m_tileRows;
+   m_fits->window = 0;
+   m_fits->windowFirst = 0;
+   m_fits->windowRows = 0;
+}
+
+CompressedTable::~CompressedTable() {
+   delete m_fits;
+}
+
+bool CompressedTable::hasColumn(const std::string & colname) const {
+   long index;
+   std::string name(columnName(colname, index));
+   int status(0);
+   int colnum(0);
+   fits_get_colnum(m_fits->fptr, CASEINSEN, const_cast<char *>(name.c_str()),
+                   &colnum, &status);
+   if (status == COL_NOT_FOUND) {
+      fits_clear_errmsg();
+      return false;
+   }
+   checkStatus(status, "hasColumn");
+   return true;
+}
+
+void CompressedTable::readRows(tip::Index_t first, tip::Index_t nrows,
+                               unsigned char * bytes) const {
+   if (nrows <= 0) {
+      return;
+   }
+   int status(0);
+   LONGLONG row(0);
+   fitsfile * fptr(m_fits->rows(first, nrows, row, status));
+   fits_read_tblbytes(fptr, row, 1, static_cast<LONGLONG>(nrows)*m_rowSize,
+                      bytes, &status);
+   checkStatus(status, "readRows");
+}
+
+long CompressedTable::findRows(const std::string & filterString,
+                               tip::Index_t first, tip::Index_t nrows,
+                               std::vector<char> & accepted) const {
+   accepted.resize(nrows);
+   if (nrows <= 0) {
+      return 0;
+   }
+   if (filterString == "") {
+      std::fill(accepted.begin(), accepted.end(), 1);
+      return nrows;
+   }
+   int status(0);
+   LONGLONG row(0);
+   fitsfile * fptr(m_fits->rows(first, nrows, row, status));
+   long ngood(0);
+   fits_find_rows(fptr, const_cast<char *>(filterString.c_str()), row, nrows,
+                  &ngood, &accepted[0], &status);
+   checkStatus(status, "findRows");
+   return ngood;
+}
+
+void CompressedTable::readColumn(const std::string & colname,
+                                 tip::Index_t first, tip::Index_t nrows,
+                                 std::vector<double> & values) const {
+   values.resize(nrows);
+   if (nrows <= 0) {
+      return;
+   }
+   long index;
+   std::string name(columnName(colname, index));
+   int status(0);
+   LONGLONG row(0);
+   fitsfile * fptr(m_fits->rows(first, nrows, row, status));
+   int colnum(0);
+   fits_get_colnum(fptr, CASEINSEN, const_cast<char *>(name.c_str()),
+                   &colnum, &status);
+   int typecode(0);
+   long repeat(0);
+   long width(0);
+   fits_get_coltype(fptr, colnum, &typecode, &repeat, &width, &status);
+   checkStatus(status, "readColumn");
+   if (typecode == TBIT && index == 0) {
+      if (repeat > 32) {
+         throw std::runtime_error("dataSubselector::CompressedTable::"
+                                  "readColumn: " + colname + " has more "
+                                  "than 32 bits.");
+      }
+      std::vector<unsigned int> bits(nrows);
+      fits_read_col_bit_uint(fptr, colnum, row, nrows, 1, repeat, &bits[0],
+                             &status);
+      for (tip::Index_t i(0); i < nrows; i++) {
+         values[i] = bits[i];
+      }
+   } else if (typecode == TSTRING || typecode == TLOGICAL || typecode == TBIT
+              || typecode < 0 || (index == 0 && repeat != 1)
+              || index < 0 || index > repeat) {
+      throw std::runtime_error("dataSubselector::CompressedTable::"
+                               "readColumn: " + colname + " is not a "
+                               "numeric column or element.");
+   } else if (index == 0) {
+      int anynul(0);
+      fits_read_col(fptr, TDOUBLE, colnum, row, 1, nrows, 0, &values[0],
+                    &anynul, &status);
+   } else {
+// Read the whole vectors, and keep the element.
+      std::vector<double> vectors(static_cast<size_t>(nrows)*repeat);
+      int anynul(0);
+      fits_read_col(fptr, TDOUBLE, colnum, row, 1, vectors.size(), 0,
+                    &vectors[0], &anynul, &status);
+      for (tip::Index_t i(0); i < nrows; i++) {
+         values[i] = vectors[i*repeat + index - 1];
+      }
+   }
+   checkStatus(status, "readColumn");
+}
+
+ColumnSchema CompressedTable::schema(const Cuts & cuts) const {
+   std::vector<std::string> colnames;
+   SchemaCuts::columns(cuts, colnames);
+   ColumnSchema schema;
+   for (size_t i(0); i < colnames.size(); i++) {
+      if (hasColumn(colnames[i])) {
+         schema.addColumn(colnames[i]);
+      }
+   }
+   return schema;
+}
+
+long CompressedTable::accept(const SchemaCuts & cuts, tip::Index_t first,
+                             tip::Index_t nrows,
+                             std::vector<char> & accepted) const {
+   accepted.resize(nrows);
+   if (nrows <= 0) {
+      return 0;
+   }
+   const ColumnSchema & schema(cuts.schema());
+   std::vector<std::vector<double> > columns(schema.size());
+   std::vector<const double *> pointers(schema.size());
+   for (unsigned int slot(0); slot < schema.size(); slot++) {
+      readColumn(schema.colname(slot), first, nrows, columns[slot]);
+      pointers[slot] = &columns[slot][0];
+   }
+   cuts.accept(pointers.empty() ? 0 : &pointers[0], nrows, accepted);
+   return std::count(accepted.begin(), accepted.end(), 1);
+}
+
+void CompressedTable::createFile(const std::string & outFile) const {
+   int status(0);
+   LONGLONG row(0);
+   fitsfile * fptr(m_fits->rows(0, std::min(m_nrows, tip::Index_t(1)), row,
+                                status));
+   checkStatus(status, "createFile");
+   int target(m_fits->hdu);
+   int nhdus(0);
+   fits_get_num_hdus(fptr, &nhdus, &status);
+   checkStatus(status, "createFile");
+
+   std::remove(outFile.c_str());
+   fitsfile * outfptr(0);
+   fits_create_file(&outfptr, outFile.c_str(), &status);
+   checkStatus(status, "createFile");
+   for (int hdu(1); hdu <= nhdus && status == 0; hdu++) {
+      fits_movabs_hdu(fptr, hdu, 0, &status);
+      if (hdu != target) {
+         fits_copy_hdu(fptr, outfptr, 0, &status);
+      } else {
+// Only the header of the event table is copied, with no rows, as
+// for a cfitsio row filter.
+         fits_copy_header(fptr, outfptr, &status);
+         fits_modify_key_lng(outfptr, "NAXIS2", 0, 0, &status);
+         fits_set_hdustruc(outfptr, &status);
+      }
+   }
+   int close_status(0);
+   fits_movabs_hdu(fptr, target, 0, &close_status);
+   fits_close_file(outfptr, &close_status);
+   if (status != 0 || close_status != 0) {
+      std::remove(outFile.c_str());
+   }
+   checkStatus(status, "createFile");
+   checkStatus(close_status, "createFile");
+}
+
+tip::Index_t CompressedTable::
+appendRows(const std::string & outFile, const std::string & filterString,
+           const std::vector<RowRange_t> & ranges,
+           const ColumnProjection * projection) const {
+   Writer output(outFile, m_extension);
+   tip::Index_t nrows(appendRows(output, filterString, ranges, projection));
+   output.close();
+   return nrows;
+}
+
+tip::Index_t CompressedTable::
+appendRows(const std::string & outFile, const std::string & filterString,
+           const ColumnProjection * projection) const {
+   std::vector<RowRange_t> ranges(1, RowRange_t(0, m_nrows));
+   return appendRows(outFile, filterString, ranges, projection);
+}
+
+tip::Index_t CompressedTable::
+appendRows(Writer & output, const std::string & filterString,
+           const std::vector<RowRange_t> & ranges,
+           const ColumnProjection * projection) const {
+   bool project(projection && projection->active());
+   if (output.rowSize() != (project ? projection->outputRowSize()
+                            : m_rowSize)) {
+      throw std::runtime_error("dataSubselector::CompressedTable::"
+                               "appendRows: the rows of the output "
+                               "do not match those of " + m_fileName);
+   }
+   tip::Index_t nstart(output.numRecords());
+
+// Apply the filter expression to each row range in chunks, and pack
+// the bytes of the runs of accepted rows, or of their projections.
+   const tip::Index_t chunkSize(10000);
+   std::vector<char> accepted;
+   std::vector<unsigned char> buffer;
+   for (size_t i(0); i < ranges.size(); i++) {
+      for (tip::Index_t first(ranges[i].first); first < ranges[i].second;
+           first += chunkSize) {
+         tip::Index_t nchunk(std::min(chunkSize, ranges[i].second - first));
+         long ngood(findRows(filterString, first, nchunk, accepted));
+         if (ngood == 0) {
+            continue;
+         }
+         buffer.resize(static_cast<size_t>(ngood)*m_rowSize);
+         tip::Index_t npacked(0);
+         tip::Index_t j(0);
+         while (j < nchunk) {
+            if (!accepted[j]) {
+               j++;
+               continue;
+            }
+            tip::Index_t k(j);
+            while (k < nchunk && accepted[k]) {
+               k++;
+            }
+            readRows(first + j, k - j, &buffer[npacked*m_rowSize]);
+            npacked += k - j;
+            j = k;
+         }
+         if (project) {
+            projection->project(&buffer[0], ngood, &buffer[0]);
+         }
+         output.append(&buffer[0], ngood);
+      }
+   }
+   return output.numRecords() - nstart;
+}
+
+bool CompressedTable::isCompressed(const tip::Header & header) {
+   bool value(false);
+   try {
+      header["ZTABLE"].get(value);
+   } catch (tip::TipException &) {
+      return false;
+   }
+   return value;
+}
+
+bool CompressedTable::isCompressed(const std::string & fitsFile,
+                                   const std::string & extension) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, fitsFile.c_str(), READONLY, &status);
+   CfitsioUtil::checkStatus(status, "CompressedTable::isCompressed");
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   bool compressed(ztable(fptr, status));
+   CfitsioUtil::checkStatus(status, "CompressedTable::isCompressed", fptr);
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "CompressedTable::isCompressed");
+   return compressed;
+}
+
+void CompressedTable::compress(const std::string & fitsFile,
+                               const std::string & extension) {
+   int status(0);
+   fitsfile * infptr(0);
+   fits_open_file(&infptr, fitsFile.c_str(), READONLY, &status);
+   CfitsioUtil::checkStatus(status, "CompressedTable::compress");
+   fits_movnam_hdu(infptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   bool compressed(ztable(infptr, status));
+   LONGLONG nrows(0);
+   fits_get_num_rowsll(infptr, &nrows, &status);
+   CfitsioUtil::checkStatus(status, "CompressedTable::compress", infptr);
+   if (compressed) {
+      fits_close_file(infptr, &status);
+      return;
+   }
+   int target(0);
+   fits_get_hdu_num(infptr, &target);
+
+// cfitsio does not compress a table without rows, so a table with one
+// blank row is compressed, and the row is then removed.
+   fitsfile * packed(0);
+   if (nrows == 0) {
+      fitsfile * blank(createMemFile(status));
+      fits_copy_header(infptr, blank, &status);
+      fits_insert_rows(blank, 0, 1, &status);
+      packed = createMemFile(status);
+      fits_compress_table(blank, packed, &status);
+      fits_movabs_hdu(packed, 2, 0, &status);
+      closeFile(blank);
+      if (status == 0 && !ztable(packed, status)) {
+         closeFile(packed);
+         closeFile(infptr);
+         throw std::runtime_error("dataSubselector::CompressedTable::"
+                                  "compress: cfitsio did not compress "
+                                  + fitsFile);
+      }
+      fits_modify_key_lng(packed, "NAXIS2", 0, 0, &status);
+      fits_modify_key_lng(packed, "PCOUNT", 0, 0, &status);
+      fits_modify_key_lng(packed, "ZNAXIS2", 0, 0, &status);
+      deleteKey(packed, "THEAP", status);
+      fits_set_hdustruc(packed, &status);
+   }
+
+// Write the compressed file alongside, so that the original is only
+// replaced once the copy is complete.
+   std::string tmpFile(fitsFile + ".tmp");
+   std::remove(tmpFile.c_str());
+   fitsfile * outfptr(0);
+   fits_create_file(&outfptr, tmpFile.c_str(), &status);
+   int nhdus(0);
+   fits_get_num_hdus(infptr, &nhdus, &status);
+   for (int hdu(1); hdu <= nhdus && status == 0; hdu++) {
+      fits_movabs_hdu(infptr, hdu, 0, &status);
+      if (hdu != target) {
+         fits_copy_hdu(infptr, outfptr, 0, &status);
+      } else if (packed) {
+         fits_copy_hdu(packed, outfptr, 0, &status);
+      } else {
+         fits_compress_table(infptr, outfptr, &status);
+      }
+   }
+   int close_status(0);
+   closeFile(packed);
+   if (outfptr) {
+      fits_close_file(outfptr, &close_status);
+   }
+   fits_close_file(infptr, &close_status);
+   if (status != 0 || close_status != 0) {
+      std::remove(tmpFile.c_str());
+   }
+   CfitsioUtil::checkStatus(status, "CompressedTable::compress");
+   CfitsioUtil::checkStatus(close_status, "CompressedTable::compress");
+   if (std::rename(tmpFile.c_str(), fitsFile.c_str()) != 0) {
+      std::remove(tmpFile.c_str());
+      throw std::runtime_error("dataSubselector::CompressedTable::compress: "
+                               "cannot replace " + fitsFile);
+   }
+}
+
+void CompressedTable::checkStatus(int status,
+                                  const std::string & routine) const {
+   CfitsioUtil::checkStatus(status, "CompressedTable::"
+                            + routine + ": " + m_fileName + "["
+                            + m_extension + "]");
+}
+
+/// The output table and, if it is compressed, the rows of the tile
+/// being filled and an empty uncompressed table with the layout of
+/// the rows, in which each tile is compressed.
+struct CompressedTable::Writer::Output {
+   std::string name;
+   fitsfile * fptr;
+   bool compressed;
+   long rowSize;
+   LONGLONG nrows;
+   LONGLONG ntiles;
+   LONGLONG tileRows;
+   bool packHeap;
+   std::vector<unsigned char> pending;
+   fitsfile * layout;
+
+   ~Output() {
+      closeFile(layout);
+      closeFile(fptr);
+   }
+
+   LONGLONG numPending() const {
+      return pending.size()/rowSize;
+   }
+
+   void checkStatus(int status) const {
+      CfitsioUtil::checkStatus(status, "CompressedTable::Writer: " + name);
+   }
+
+   /// Compress the pending rows as a tile of their own, and append it
+   /// to the output table.
+   void writeTile() {
+      LONGLONG npending(numPending());
+      if (npending == 0) {
+         return;
+      }
+      int status(0);
+      fits_insert_rows(layout, 0, npending, &status);
+      fits_write_tblbytes(layout, 1, 1, pending.size(), &pending[0], &status);
+      fitsfile * packed(createMemFile(status));
+      long tileDim(tileRows);
+      fits_set_tile_dim(packed, 1, &tileDim, &status);
+      fits_compress_table(layout, packed, &status);
+      fits_movabs_hdu(packed, 2, 0, &status);
+      fits_delete_rows(layout, 1, npending, &status);
+      LONGLONG ntilesPacked(0);
+      fits_get_num_rowsll(packed, &ntilesPacked, &status);
+      if (status == 0 && (!ztable(packed, status) || ntilesPacked != 1
+                          || !sameCompression(packed, status))) {
+         closeFile(packed);
+         throw std::runtime_error("dataSubselector::CompressedTable::"
+                                  "Writer: cfitsio did not compress the "
+                                  "rows for " + name + " as one tile "
+                                  "of the same kind.");
+      }
+      fits_insert_rows(fptr, ntiles, 1, &status);
+      try {
+         copyTile(packed, 1, fptr, ntiles + 1, status);
+      } catch (...) {
+         closeFile(packed);
+         throw;
+      }
+      closeFile(packed);
+      fits_modify_key_lng(fptr, "ZNAXIS2", nrows + npending, 0, &status);
+      checkStatus(status);
+      ntiles++;
+      nrows += npending;
+      pending.clear();
+   }
+
+   /// True if the columns of a compressed tile use the algorithms of
+   /// the output table, as given by their ZCTYPn keywords.
+   bool sameCompression(fitsfile * packed, int & status) const {
+      int ncols(0);
+      fits_get_num_cols(fptr, &ncols, &status);
+      for (int col(1); col <= ncols && status == 0; col++) {
+         char keyword[FLEN_KEYWORD];
+         fits_make_keyn("ZCTYP", col, keyword, &status);
+         char outType[FLEN_VALUE];
+         char tileType[FLEN_VALUE];
+         fits_read_key(fptr, TSTRING, keyword, outType, 0, &status);
+         fits_read_key(packed, TSTRING, keyword, tileType, 0, &status);
+         if (status == 0 && std::string(outType) != tileType) {
+            return false;
+         }
+      }
+      return status == 0;
+   }
+};
+
+CompressedTable::Writer::Writer(const std::string & outFile,
+                                const std::string & extension,
+                                tip::Index_t tileRows) : m_output(0) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, outFile.c_str(), READWRITE, &status);
+   CfitsioUtil::checkStatus(status, "CompressedTable::Writer: " + outFile);
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   m_output = new Output();
+   m_output->name = outFile + "[" + extension + "]";
+   m_output->fptr = fptr;
+   m_output->compressed = ztable(fptr, status);
+   m_output->packHeap = false;
+   m_output->layout = 0;
+   fits_get_num_rowsll(fptr, &m_output->ntiles, &status);
+   if (!m_output->compressed) {
+      fits_read_key(fptr, TLONG, "NAXIS1", &m_output->rowSize, 0, &status);
+      m_output->nrows = m_output->ntiles;
+      m_output->tileRows = 1;
+   } else {
+      fits_read_key(fptr, TLONG, "ZNAXIS1", &m_output->rowSize, 0, &status);
+      fits_read_key(fptr, TLONGLONG, "ZNAXIS2", &m_output->nrows, 0, &status);
+      if (m_output->nrows == 0) {
+         m_output->tileRows = std::max(tileRows, tip::Index_t(1));
+         fits_update_key(fptr, TLONGLONG, "ZTILELEN", &m_output->tileRows,
+                         0, &status);
+      } else {
+         m_output->tileRows = readKey(fptr, "ZTILELEN", m_output->nrows,
+                                      status);
+      }
+   }
+   if (status != 0) {
+      delete m_output;
+      m_output = 0;
+      CfitsioUtil::checkStatus(status, "CompressedTable::Writer: "
+                               + outFile);
+   }
+   if (!m_output->compressed) {
+      return;
+   }
+
+// The rows of a partial last tile are read back and the tile removed,
+// so that it can be completed.  Its compressed bytes remain in the
+// heap until close().
+   Output & output(*m_output);
+   LONGLONG partial(output.nrows % output.tileRows);
+   LONGLONG tile0(partial > 0 ? output.ntiles - 1 : 0);
+   LONGLONG tile1(partial > 0 ? output.ntiles : 0);
+   output.layout = createMemFile(status);
+   try {
+      uncompressTiles(fptr, tile0, tile1, output.tileRows, output.nrows,
+                      output.layout, status);
+   } catch (...) {
+      delete m_output;
+      m_output = 0;
+      throw;
+   }
+   fits_movabs_hdu(output.layout, 2, 0, &status);
+   if (partial > 0) {
+      output.pending.resize(partial*output.rowSize);
+      fits_read_tblbytes(output.layout, 1, 1, output.pending.size(),
+                         &output.pending[0], &status);
+      fits_delete_rows(output.layout, 1, partial, &status);
+      fits_delete_rows(fptr, output.ntiles, 1, &status);
+      output.ntiles--;
+      output.nrows -= partial;
+      output.packHeap = true;
+   }
+   if (status != 0) {
+      delete m_output;
+      m_output = 0;
+      CfitsioUtil::checkStatus(status, "CompressedTable::Writer: "
+                               + outFile);
+   }
+}
+
+CompressedTable::Writer::~Writer() {
+   try {
+      close();
+   } catch (std::exception &) {
+   }
+   delete m_output;
+}
+
+long CompressedTable::Writer::rowSize() const {
+   return m_output->rowSize;
+}
+
+tip::Index_t CompressedTable::Writer::numRecords() const {
+   return m_output->nrows + m_output->numPending();
+}
+
+void CompressedTable::Writer::append(const unsigned char * bytes,
+                                     tip::Index_t nrows) {
+   Output & output(*m_output);
+   if (output.fptr == 0) {
+      throw std::runtime_error("dataSubselector::CompressedTable::Writer: "
+                               + output.name + " is closed.");
+   }
+   if (nrows <= 0) {
+      return;
+   }
+   if (!output.compressed) {
+      int status(0);
+      fits_insert_rows(output.fptr, output.nrows, nrows, &status);
+      fits_write_tblbytes(output.fptr, output.nrows + 1, 1,
+                          static_cast<LONGLONG>(nrows)*output.rowSize,
+                          const_cast<unsigned char *>(bytes), &status);
+      output.checkStatus(status);
+      output.nrows += nrows;
+      return;
+   }
+   while (nrows > 0) {
+      tip::Index_t count(std::min(nrows, tip::Index_t(output.tileRows
+                                                      - output.numPending())));
+      output.pending.insert(output.pending.end(), bytes,
+                            bytes + count*output.rowSize);
+      if (output.numPending() == output.tileRows) {
+         output.writeTile();
+      }
+      bytes += count*output.rowSize;
+      nrows -= count;
+   }
+}
+
+void CompressedTable::Writer::close() {
+   Output & output(*m_output);
+   if (output.fptr == 0) {
+      return;
+   }
+   int status(0);
+   if (output.compressed) {
+      output.writeTile();
+      if (output.packHeap) {
+         fits_compress_heap(output.fptr, &status);
+      }
+   }
+   closeFile(output.layout);
+   fits_close_file(output.fptr, &status);
+   output.fptr = 0;
+   output.checkStatus(status);
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,187 @@
+/**
+ * @file ConeIndex.cxx
+ * @brief Pixelized sky index for fast acceptance tests against one or
+ * more SkyConeCuts.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cmath>
+
+#include <algorithm>
+#include <utility>
+
+#include "dataSubselector/ConeIndex.h"
+
+namespace {
+   /// Margin (degrees) for rounding in the pixel classification and
+   /// in SkyConeCut::accept.
+   const double epsilon(1e-6);
+
+   typedef std::pair<unsigned int, std::pair<bool, unsigned int> > Hit_t;
+
+   /// Order by pixel, with the cones containing the whole pixel first.
+   bool hitLess(const Hit_t & a, const Hit_t & b) {
+      if (a.first != b.first) {
+         return a.first < b.first;
+      }
+      if (a.second.first != b.second.first) {
+         return a.second.first;
+      }
+      return a.second.second < b.second.second;
+   }
+}
+
+namespace dataSubselector {
+
+ConeIndex::ConeIndex(const std::vector<SkyConeCut> & cones, double pixelSize)
+   : m_cones(cones),
+     m_grid(pixelSize > 0 ? pixelSize : defaultPixelSize(cones)),
+     m_firstBand(0), m_lastBand(-1), m_pixelOffset(0) {
+   if (m_cones.empty()) {
+      m_entryStart.push_back(0);
+      return;
+   }
+
+// Find the declination bands that overlap the cones.
+   std::vector<std::pair<int, int> > coneBands;
+   for (size_t k(0); k < m_cones.size(); k++) {
+      double radius(m_cones[k].radius() + epsilon);
+      int lo(m_grid.band(std::max(-90., m_cones[k].dec() - radius)));
+      int hi(m_grid.band(std::min(90., m_cones[k].dec() + radius)));
+      coneBands.push_back(std::make_pair(lo, hi));
+      if (k == 0 || lo < m_firstBand) {
+         m_firstBand = lo;
+      }
+      if (k == 0 || hi > m_lastBand) {
+         m_lastBand = hi;
+      }
+   }
+   m_pixelOffset = m_grid.bandStart(m_firstBand);
+   unsigned int npix(m_grid.bandStart(m_lastBand)
+                     + m_grid.numRaPixels(m_lastBand) - m_pixelOffset);
+
+// Classify the pixels within the RA extent of each cone.  A cone
+// contains the whole pixel if the separation of the pixel center plus
+// the pixel radius is within the cone radius.
+   std::vector<Hit_t> hits;
+   for (unsigned int k(0); k < m_cones.size(); k++) {
+      const SkyConeCut & cone(m_cones[k]);
+      double radius(cone.radius());
+      double halfWidth(180.);
+      if (std::fabs(cone.dec()) + radius + epsilon < 90.) {
+         halfWidth = std::asin(std::sin((radius + epsilon)*M_PI/180.)
+                               /std::cos(cone.dec()*M_PI/180.))*180./M_PI;
+      }
+      for (int b(coneBands[k].first); b <= coneBands[k].second; b++) {
+         int nra(m_grid.numRaPixels(b));
+         double width(360./nra);
+         int jmin(0);
+         int jmax(nra - 1);
+         if (halfWidth < 180.) {
+            jmin = static_cast<int>(std::floor((cone.ra() - halfWidth)
+                                               /width)) - 1;
+            jmax = static_cast<int>(std::floor((cone.ra() + halfWidth)
+                                               /width)) + 1;
+            if (jmax - jmin + 1 >= nra) {
+               jmin = 0;
+               jmax = nra - 1;
+            }
+         }
+         for (int jj(jmin); jj <= jmax; jj++) {
+            unsigned int pix(m_grid.bandStart(b) + ((jj % nra) + nra) % nra);
+            double ra, dec, pixelRadius;
+            m_grid.pixelCircle(pix, ra, dec, pixelRadius);
+            double separation(SkyGrid::separation(cone.ra(), cone.dec(),
+                                                  ra, dec));
+            if (separation - pixelRadius > radius + epsilon) {
+               continue;
+            }
+            bool inside(separation + pixelRadius + epsilon <= radius);
+            hits.push_back(Hit_t(pix - m_pixelOffset,
+                                 std::make_pair(inside, k)));
+         }
+      }
+   }
+   std::sort(hits.begin(), hits.end(), hitLess);
+
+   m_status.assign(npix, OUTSIDE);
+   m_entryStart.assign(npix + 1, 0);
+   m_entries.reserve(hits.size());
+   for (size_t i(0); i < hits.size(); i++) {
+      unsigned int pix(hits[i].first);
+      Entry entry;
+      entry.inside = hits[i].second.first;
+      entry.cone = hits[i].second.second;
+      m_entries.push_back(entry);
+      m_entryStart[pix + 1]++;
+      if (entry.inside) {
+         m_status[pix] = INSIDE;
+      } else if (m_status[pix] == OUTSIDE) {
+         m_status[pix] = BOUNDARY;
+      }
+   }
+   for (unsigned int pix(0); pix < npix; pix++) {
+      m_entryStart[pix + 1] += m_entryStart[pix];
+   }
+}
+
+double ConeIndex::defaultPixelSize(const std::vector<SkyConeCut> & cones) {
+// A few pixels across the smallest cone, within limits that keep the
+// number of pixels per band modest.
+   double pixelSize(5.);
+   for (size_t k(0); k < cones.size(); k++) {
+      pixelSize = std::min(pixelSize, cones[k].radius()/4.);
+   }
+   return std::max(pixelSize, 0.25);
+}
+
+bool ConeIndex::accept(double ra, double dec) const {
+   long pix(pixel(ra, dec));
+   if (pix < 0 || m_status[pix] == OUTSIDE) {
+      return false;
+   }
+   if (m_status[pix] == INSIDE) {
+      return true;
+   }
+   for (unsigned int i(m_entryStart[pix]); i < m_entryStart[pix + 1]; i++) {
+      if (m_cones[m_entries[i].cone].accept(ra, dec)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void ConeIndex::findCones(double ra, double dec,
+                          std::vector<unsigned int> & cones) const {
+   cones.clear();
+   long pix(pixel(ra, dec));
+   if (pix < 0) {
+      return;
+   }
+   for (unsigned int i(m_entryStart[pix]); i < m_entryStart[pix + 1]; i++) {
+      const Entry & entry(m_entries[i]);
+      if (entry.inside || m_cones[entry.cone].accept(ra, dec)) {
+         cones.push_back(entry.cone);
+      }
+   }
+}
+
+ConeIndex::Status ConeIndex::status(double ra, double dec) const {
+   long pix(pixel(ra, dec));
+   if (pix < 0) {
+      return OUTSIDE;
+   }
+   return static_cast<Status>(m_status[pix]);
+}
+
+long ConeIndex::pixel(double ra, double dec) const {
+   int b(m_grid.band(dec));
+   if (b < m_firstBand || b > m_lastBand) {
+      return -1;
+   }
+   return static_cast<long>(m_grid.pixel(ra, dec)) - m_pixelOffset;
+}
+
+} // namespace dataSubselector
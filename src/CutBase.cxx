@@ -7,15 +7,48 @@
  */
 
 #include <sstream>
+#include <stdexcept>
 
 #include "tip/Header.h"
 
 #include "dataSubselector/CutBase.h"
 
+namespace {
+// Function-local so that cuts constructed during static
+// initialization elsewhere can use it.
+   const std::string * typeNames() {
+      static const std::string names[] = 
+         {"none", "range", "GTI", "SkyCone", "bit_mask", "version",
+          "range_set"};
+      return names;
+   }
+   const size_t nkinds(7);
+// The longest string value that fits on one 80-character card.
+   const size_t maxValueLength(68);
+}
+
 namespace dataSubselector {
 
+CutBase::Kind CutBase::kindOf(const std::string & type) {
+   const std::string * names(typeNames());
+   for (size_t i(1); i < nkinds; i++) {
+      if (type == names[i]) {
+         return static_cast<Kind>(i);
+      }
+   }
+   return NONE;
+}
+
+const std::string & CutBase::typeName(Kind kind) {
+   return typeNames()[kind];
+}
+
 bool CutBase::operator==(const CutBase & rhs) const {
-   return m_type == rhs.m_type && this->equals(rhs);
+// Cuts of unknown kind are distinguished by their type strings.
+   if (m_kind != rhs.m_kind || (m_kind == NONE && m_type != rhs.m_type)) {
+      return false;
+   }
+   return this->equals(rhs);
 }
 
 void CutBase::writeCut(std::ostream & stream, unsigned int keynum) const {
@@ -43,6 +76,15 @@ void CutBase::writeDssKeywords(tip::Header & header,
                                const std::string & unit,
                                const std::string & value,
                                const std::string & ref) const {
+// tip reads only the first card of a string keyword, so a value
+// continued with CONTINUE cards would be truncated.
+   if (value.size() > maxValueLength) {
+      std::ostringstream message;
+      message << "CutBase::writeDssKeywords: the value of DSVAL" << keynum
+              << ", " << value << ", is longer than the "
+              << maxValueLength << " characters of a FITS keyword.";
+      throw std::runtime_error(message.str());
+   }
    std::ostringstream key1, key2, key3;
    key1 << "DSTYP" << keynum;
    header[key1.str()].set(type);
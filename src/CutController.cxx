@@ -4,6 +4,7 @@
  * $Header: /nfs/slac/g/glast/ground/cvs/ScienceTools-scons/dataSubselector/src/dataSubselector/CutController.cxx,v 1.33 2015/06/29 19:34:44 jchiang Exp $
  */
 
+#include <algorithm>
 #include <sstream>
 #include <stdexcept>
 
@@ -17,8 +18,19 @@
 #include "astro/SkyDir.h"
 
 #include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/CompressedTable.h"
 #include "dataSubselector/CutController.h"
 #include "dataSubselector/Gti.h"
+#include "dataSubselector/RangeSetCut.h"
+
+namespace {
+   const char * realPars[] = {"ra", "dec", "rad", "tmin", "tmax", 
+                              "emin", "emax", "zmin", "zmax",
+                              "phasemin", "phasemax"};
+   const size_t nrealPars(sizeof(realPars)/sizeof(realPars[0]));
+   const char * intPars[] = {"convtype", "evclass", "evtype"};
+   const size_t nintPars(sizeof(intPars)/sizeof(intPars[0]));
+}
 
 namespace dataSubselector {
 
@@ -42,19 +54,83 @@ void CutController::delete_instance() {
 CutController::CutController(st_app::AppParGroup & pars, 
                              const std::vector<std::string> & eventFiles,
                              const std::string & evtable) 
-   : m_pars(pars), m_cuts(eventFiles, evtable, true, true), 
-     m_passVer(""), m_evclsFilter("") {
+   : m_cuts(eventFiles, evtable, true, true), 
+     m_passVer(""), m_evclsFilter(""), m_compressed(false) {
    checkPassVersion(eventFiles);
-   double ra = pars["ra"];
-   double dec = pars["dec"];
-   double radius = pars["rad"];
+   setCuts(parMap(pars));
+   std::string phases = pars["phases"];
+   addRangeSetCut("PULSE_PHASE", "dimensionless", phases);
+   std::string energies = pars["energies"];
+   addRangeSetCut("ENERGY", "MeV", energies);
+}
+
+CutController::CutController(const ParMap & pars,
+                             const std::vector<std::string> & eventFiles,
+                             const std::string & evtable) 
+   : m_cuts(eventFiles, evtable, true, true), 
+     m_passVer(""), m_evclsFilter(""), m_compressed(false) {
+   checkPassVersion(eventFiles);
+   setCuts(pars);
+}
+
+CutController::ParMap CutController::parMap(st_app::AppParGroup & pars) {
+   ParMap my_pars;
+   for (size_t i(0); i < nrealPars; i++) {
+      try {
+         double value = pars[realPars[i]];
+         my_pars[realPars[i]] = value;
+      } catch (const hoops::Hexception &) {
+         // Assume INDEF is given as the parameter value, so leave it
+         // out of the map and apply the default (i.e., no cut).
+      }
+   }
+   for (size_t i(0); i < nintPars; i++) {
+      try {
+         int value = pars[intPars[i]];
+         my_pars[intPars[i]] = value;
+      } catch (const hoops::Hexception &) {
+         // INDEF, as above.
+      }
+   }
+   return my_pars;
+}
+
+bool CutController::isParName(const std::string & name) {
+   for (size_t i(0); i < nrealPars; i++) {
+      if (name == realPars[i]) {
+         return true;
+      }
+   }
+   for (size_t i(0); i < nintPars; i++) {
+      if (name == intPars[i]) {
+         return true;
+      }
+   }
+   return false;
+}
+
+double CutController::parValue(const ParMap & pars, const std::string & name,
+                               double defaultValue) {
+   ParMap::const_iterator it(pars.find(name));
+   if (it == pars.end()) {
+      return defaultValue;
+   }
+   return it->second;
+}
+
+void CutController::setCuts(const ParMap & pars) {
+   double ra = parValue(pars, "ra", 0);
+   double dec = parValue(pars, "dec", 0);
+   double radius = parValue(pars, "rad", 180.);
    double max_rad = 180.;
    if (radius < max_rad) {
       m_cuts.addSkyConeCut(ra, dec, radius);
    }
-   addRangeCut("TIME", "s", pars["tmin"], pars["tmax"]);
-   addRangeCut("ENERGY", "MeV", pars["emin"], pars["emax"]);
-   int convtype = pars["convtype"];
+   addRangeCut("TIME", "s", parValue(pars, "tmin", 0), 
+               parValue(pars, "tmax", 0));
+   addRangeCut("ENERGY", "MeV", parValue(pars, "emin", 0),
+               parValue(pars, "emax", 0));
+   int convtype = static_cast<int>(parValue(pars, "convtype", -1));
    if (convtype >= 0) {
       addRangeCut("CONVERSION_TYPE", "dimensionless", convtype, convtype, 
                   0, true);
@@ -63,21 +139,19 @@ CutController::CutController(st_app::AppParGroup & pars,
       // Do nothing.  This is only to support DC1A data in the ST unit tests.
       
    } else {
-      try {
-         int evclass = pars["evclass"];
+      if (pars.count("evclass")) {
+         int evclass = static_cast<int>(parValue(pars, "evclass", 0));
          if (!BitMaskCut::post_P7(m_passVer)) {
             // Pass 7 and earlier expects evclass to be the bit
             // position, so do the bit shift.
             evclass = 1 << evclass;
          }
          m_cuts.addBitMaskCut("EVENT_CLASS", evclass, m_passVer);
-      } catch (const hoops::Hexception &) {
-         // Assume INDEF is given as the parameter value for evclass,
-         // so use default of applying no EVENT_CLASS cut.
       }
-      try {
+      // An absent evclass (INDEF) means no EVENT_CLASS cut is applied.
+      if (pars.count("evtype")) {
          /// Handle any EVENT_TYPE cut supplied by the user.
-         int evtype = pars["evtype"];
+         int evtype = static_cast<int>(parValue(pars, "evtype", 0));
          if (BitMaskCut::post_P7(m_passVer)) {
             m_cuts.addBitMaskCut("EVENT_TYPE", evtype, m_passVer);
          } else {
@@ -93,18 +167,16 @@ CutController::CutController(st_app::AppParGroup & pars,
                            convtype, 0, true);
             }
          }
-      } catch (const hoops::Hexception &) {
-         // Assume INDEF is given as the parameter value for evtype,
-         // so use default of applying no EVENT_TYPE cut.
       }
+      // An absent evtype (INDEF) means no EVENT_TYPE cut is applied.
    }
-   double zmin = pars["zmin"];
-   double zmax = pars["zmax"];
+   double zmin = parValue(pars, "zmin", 0);
+   double zmax = parValue(pars, "zmax", 180.);
    if (zmin > 0 || zmax < 180.) {
       addRangeCut("ZENITH_ANGLE", "deg", zmin, zmax);
    }
-   double phasemin = pars["phasemin"];
-   double phasemax = pars["phasemax"];
+   double phasemin = parValue(pars, "phasemin", 0);
+   double phasemax = parValue(pars, "phasemax", 1);
    if (phasemin !=0 || phasemax !=1) {
       addRangeCut("PULSE_PHASE", "dimensionless", phasemin, phasemax);
    }
@@ -117,6 +189,7 @@ checkPassVersion(const std::vector<std::string> & evfiles) {
       const tip::Table * table = 
          tip::IFileSvc::instance().readTable(evfiles.at(i), "EVENTS");
       const tip::Header & header(table->getHeader());
+      m_compressed = m_compressed || CompressedTable::isCompressed(header);
       std::string passVer("NONE");
       try {
          header["PASS_VER"].get(passVer);
@@ -163,24 +236,52 @@ void CutController::addRangeCut(const std::string & colname,
    m_cuts.addRangeCut(tokens.at(0), unit, minVal, maxVal, type, indx);
 }
 
+void CutController::addRangeSetCut(const std::string & colname,
+                                   const std::string & unit,
+                                   const std::string & windows) {
+   if (windows == "" || windows == "none" || windows == "NONE") {
+      return;
+   }
+   m_cuts.addCut(RangeSetCut(colname, unit, windows, 0));
+}
+
 void CutController::updateGti(const std::string & eventFile) const {
    Gti gti(eventFile);
+   applyTimeRangeCuts(gti);
+   gti.writeExtension(eventFile);
+}
+
+void CutController::applyTimeRangeCuts(Gti & gti) const {
+   const std::vector<RangeCut *> & time_cuts(m_cuts.rangeCuts("TIME"));
+   for (size_t i = 0; i < time_cuts.size(); i++) {
+      const RangeCut & my_cut = *time_cuts[i];
+      if (my_cut.intervalType() == RangeCut::CLOSED) {
+         gti = gti.applyTimeRangeCut(my_cut.minVal(), my_cut.maxVal());
+      } else if (my_cut.intervalType() == RangeCut::MINONLY) {
+         gti = gti.applyTimeRangeCut(my_cut.minVal(), gti.maxValue());
+      } else if (my_cut.intervalType() == RangeCut::MAXONLY) {
+         gti = gti.applyTimeRangeCut(gti.minValue(), my_cut.maxVal());
+      }
+   }
+// Intersect the GTIs with the intervals of any RangeSetCut on TIME.
    for (unsigned int i = 0; i < m_cuts.size(); i++) {
-      if (m_cuts[i].type() == "range") {
-         const RangeCut & my_cut = 
-            dynamic_cast<RangeCut &>(const_cast<CutBase &>(m_cuts[i]));
-         if (my_cut.colname() == "TIME") {
-            if (my_cut.intervalType() == RangeCut::CLOSED) {
-               gti = gti.applyTimeRangeCut(my_cut.minVal(), my_cut.maxVal());
-            } else if (my_cut.intervalType() == RangeCut::MINONLY) {
-               gti = gti.applyTimeRangeCut(my_cut.minVal(), gti.maxValue());
-            } else if (my_cut.intervalType() == RangeCut::MAXONLY) {
-               gti = gti.applyTimeRangeCut(gti.minValue(), my_cut.maxVal());
-            }
+      if (m_cuts[i].kind() != CutBase::RANGE_SET ||
+          static_cast<const RangeSetCut &>(m_cuts[i]).colname() != "TIME" ||
+          gti.getNumIntervals() == 0) {
+         continue;
+      }
+      const std::vector<RangeSetCut::Interval_t> & intervals
+         = static_cast<const RangeSetCut &>(m_cuts[i]).intervals();
+      Gti allowed;
+      for (size_t j = 0; j < intervals.size(); j++) {
+         double start(std::max(intervals[j].first, gti.minValue()));
+         double stop(std::min(intervals[j].second, gti.maxValue()));
+         if (start < stop) {
+            allowed.insertInterval(start, stop);
          }
       }
+      gti = gti & allowed;
    }
-   gti.writeExtension(eventFile);
 }
 
 std::string CutController::filterString() const {
@@ -17,13 +17,12 @@
 #include <memory>
 #include <sstream>
 #include <stdexcept>
+#include <utility>
 
 #include "facilities/Util.h"
-#include "facilities/commonUtilities.h"
 
 #include "st_stream/StreamFormatter.h"
 
-#include "st_facilities/Environment.h"
 #include "st_facilities/Util.h"
 
 #include "tip/IFileSvc.h"
@@ -34,9 +33,15 @@
 #include "irfUtil/Util.h"
 
 #include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/CompressedTable.h"
 #include "dataSubselector/Cuts.h"
 #include "dataSubselector/GtiCut.h"
+#include "dataSubselector/IrfIndex.h"
 #include "dataSubselector/RangeCut.h"
+#include "dataSubselector/RangeSetCut.h"
+#include "dataSubselector/RowSelection.h"
+#include "dataSubselector/SchemaCuts.h"
+#include "dataSubselector/SelectionStore.h"
 #include "dataSubselector/SkyConeCut.h"
 #include "dataSubselector/VersionCut.h"
 
@@ -90,23 +95,27 @@ mergeRangeCuts(const std::vector<dataSubselector::RangeCut*>& cuts) {
                                        cuts.at(0)->index());
 }
 
-void joinPaths(const std::string& components, std::string& final_path) {
-  std::vector<std::string> tokens;
-  facilities::Util::stringTokenize(components, " ", tokens);
-  if (tokens.size() == 0) {
-    throw std::runtime_error("dataSubselector::Cuts: joinPaths: "
-                             "empty string input");
-  }
-  if (tokens.size() == 1) {
-    final_path = tokens[0];
-    return;
+/// A cut applied to the rows of a table.  RangeCuts are bound to
+/// their columns, so that the column is resolved once per table
+/// rather than by name for every row.
+class RowTest {
+ public:
+  RowTest(const dataSubselector::CutBase& cut, const tip::Table& table)
+      : m_cut(&cut) {
+    if (cut.kind() == dataSubselector::CutBase::RANGE) {
+      m_bound.reset(new dataSubselector::RangeCut::Bound(
+          static_cast<const dataSubselector::RangeCut&>(cut).bind(table)));
+    }
   }
-  final_path = facilities::commonUtilities::joinPath(tokens[0], tokens[1]);
-  for (size_t i(2); i < tokens.size(); i++) {
-    final_path = facilities::commonUtilities::joinPath(final_path, tokens[i]);
+
+  bool accept(tip::Index_t record, tip::ConstTableRecord& row) const {
+    return m_bound ? m_bound->accept(record) : m_cut->accept(row);
   }
-  return;
-}
+
+ private:
+  const dataSubselector::CutBase*                          m_cut;
+  std::shared_ptr<const dataSubselector::RangeCut::Bound> m_bound;
+};
 
 } // anonymous namespace
 
@@ -116,15 +125,18 @@ Cuts::Cuts(const std::vector<std::string>& eventFiles,
            const std::string&              extname,
            bool                            check_columns,
            bool                            skipTimeRangeCuts,
-           bool                            skipEventClassCuts)
-    : m_irfName("NONE"), m_post_P7(false) {
+           bool                            skipEventClassCuts,
+           const BitMaskCut::ValidityMasksPtr& validityMasks)
+    : m_irfName("NONE"), m_post_P7(false), m_validityMasks(validityMasks) {
   std::vector<Cuts> my_cuts;
+  my_cuts.reserve(eventFiles.size());
   for (size_t i = 0; i < eventFiles.size(); i++) {
     my_cuts.push_back(Cuts(eventFiles.at(i),
                            extname,
                            check_columns,
                            skipTimeRangeCuts,
-                           skipEventClassCuts));
+                           skipEventClassCuts,
+                           validityMasks));
     if (i > 0) {
       if (!my_cuts.front().compareWithoutGtis(my_cuts.back())) {
         std::ostringstream message;
@@ -143,7 +155,9 @@ Cuts Cuts::mergeGtis(std::vector<Cuts>& cuts_vector) {
   dataSubselector::Cuts        my_cuts;
   const dataSubselector::Cuts& firstCuts(cuts_vector.front());
   for (size_t i = 0; i < firstCuts.size(); i++) {
-    if (firstCuts[i].type() != "GTI") { my_cuts.addCut(firstCuts[i]); }
+    if (firstCuts[i].kind() != CutBase::GTI) {
+      my_cuts.addCut(firstCuts[i]);
+    }
   }
 
   // Merge all of the GTIs into one, taking the union of the intervals.
@@ -165,10 +179,48 @@ Cuts Cuts::mergeGtis(std::vector<Cuts>& cuts_vector) {
 }
 
 void Cuts::getGtiCuts(std::vector<const GtiCut*>& gtiCuts) {
-  gtiCuts.clear();
+  gtiCuts.assign(m_gtiCuts.begin(), m_gtiCuts.end());
+}
+
+const std::vector<RangeCut*>&
+Cuts::rangeCuts(const std::string& colname) const {
+  static const std::vector<RangeCut*> none;
+  RangeCutIndex_t::const_iterator it(m_rangeCuts.find(colname));
+  if (it == m_rangeCuts.end()) { return none; }
+  return it->second;
+}
+
+void Cuts::reindex() {
+  m_gtiCuts.clear();
+  m_rangeCuts.clear();
+  m_bitMaskCuts.clear();
+  m_versionCuts.clear();
   for (size_t i = 0; i < m_cuts.size(); i++) {
-    if (m_cuts.at(i)->type() == "GTI") {
-      gtiCuts.push_back(dynamic_cast<GtiCut*>(m_cuts.at(i)));
+    CutBase* cut(m_cuts[i].get());
+    switch (cut->kind()) {
+    case CutBase::GTI:
+      m_gtiCuts.push_back(static_cast<GtiCut*>(cut));
+      break;
+    case CutBase::RANGE: {
+      RangeCut* range_cut(static_cast<RangeCut*>(cut));
+      m_rangeCuts[range_cut->colname()].push_back(range_cut);
+      break;
+    }
+    case CutBase::BIT_MASK: {
+      // Keep the first cut on a given column.
+      BitMaskCut* bit_mask_cut(static_cast<BitMaskCut*>(cut));
+      m_bitMaskCuts.insert(std::make_pair(bit_mask_cut->colname(),
+                                          bit_mask_cut));
+      break;
+    }
+    case CutBase::VERSION: {
+      VersionCut* version_cut(static_cast<VersionCut*>(cut));
+      m_versionCuts.insert(std::make_pair(version_cut->colname(),
+                                          version_cut));
+      break;
+    }
+    default:
+      break;
     }
   }
 }
@@ -177,22 +229,13 @@ Cuts::Cuts(const std::string& eventFile,
            const std::string& extname,
            bool               check_columns,
            bool               skipTimeRangeCuts,
-           bool               skipEventClassCuts)
-    : m_irfName("NONE") {
+           bool               skipEventClassCuts,
+           const BitMaskCut::ValidityMasksPtr& validityMasks)
+    : m_irfName("NONE"), m_post_P7(false), m_validityMasks(validityMasks) {
   /// Read in validity masks for Pass 8 event type and event class
-  /// selections.
-  if (BitMaskCut::evclassValidityMasks() == 0
-      || BitMaskCut::evtypeValidityMasks() == 0) {
-    std::string evclassPath;
-    ::joinPaths("data glast lat bcf valid_evclass_selections.txt", evclassPath);
-    std::string evtypePath;
-    ::joinPaths("data glast lat bcf valid_evtype_selections.txt", evtypePath);
-    evclassPath = facilities::commonUtilities::joinPath(
-        st_facilities::Environment::getEnv("CALDB"), evclassPath);
-    evtypePath = facilities::commonUtilities::joinPath(
-        st_facilities::Environment::getEnv("CALDB"), evtypePath);
-    BitMaskCut::setValidityMasks(evclassPath, evtypePath);
-  }
+  /// selections, unless they are given.  This is done once per
+  /// process and is thread-safe.
+  if (!m_validityMasks) { BitMaskCut::initValidityMasks(); }
 
   const tip::Extension* ext(0);
   try {
@@ -239,9 +282,9 @@ Cuts::Cuts(const std::string& eventFile,
     std::string  colname;
     unsigned int indx = parseColname(type, colname);
     if (value.find("CIRCLE") == 0) {
-      m_cuts.push_back(new SkyConeCut(type, unit, value));
+      m_cuts.push_back(CutPtr(new SkyConeCut(type, unit, value)));
     } else if (type == "TIME" && value == "TABLE") {
-      m_cuts.push_back(new GtiCut(eventFile));
+      m_cuts.push_back(CutPtr(new GtiCut(eventFile)));
     } else if (type.substr(0, 8) == "BIT_MASK") {
       std::vector<std::string> tokens;
       facilities::Util::stringTokenize(type, "(),", tokens);
@@ -253,23 +296,30 @@ Cuts::Cuts(const std::string& eventFile,
           // position so do the bit shift to generate the mask.
           mask = 1 << mask;
         }
-        m_cuts.push_back(new BitMaskCut(tokens[1], mask, tokens[3]));
+        m_cuts.push_back(CutPtr(
+            new BitMaskCut(tokens[1], mask, tokens[3], m_validityMasks)));
       } else {
         // This is also (only) pre-Pass 8 and probably cannot
         // occur anymore.
         mask = 1 << mask;
-        m_cuts.push_back(new BitMaskCut(tokens[1], mask));
+        m_cuts.push_back(
+            CutPtr(new BitMaskCut(tokens[1], mask, "", m_validityMasks)));
       }
     } else if (type.length() >= 7
                && type.substr(type.length() - 7, 7) == "VERSION") {
-      m_cuts.push_back(new VersionCut(colname, value));
+      m_cuts.push_back(CutPtr(new VersionCut(colname, value)));
     } else if ((!check_columns
                 || std::find(colnames.begin(), colnames.end(), colname)
                        != colnames.end())
                && value != "TABLE") {
       if ((type != "TIME" || !skipTimeRangeCuts)
           && (type != "EVENT_CLASS" || !skipEventClassCuts)) {
-        m_cuts.push_back(new RangeCut(colname, unit, value, indx));
+        if (value.find(",") != std::string::npos) {
+          m_cuts.push_back(
+              CutPtr(new RangeSetCut(colname, unit, value, indx)));
+        } else {
+          m_cuts.push_back(CutPtr(new RangeCut(colname, unit, value, indx)));
+        }
       }
     } else {
       std::ostringstream message;
@@ -283,6 +333,7 @@ Cuts::Cuts(const std::string& eventFile,
     }
   }
   delete ext;
+  reindex();
   set_irfName(eventFile, extname);
   read_pass_ver(eventFile, extname);
 }
@@ -314,29 +365,59 @@ bool Cuts::hasCut(const CutBase* newCut) const {
 }
 
 Cuts::Cuts(const Cuts& rhs)
-    : m_irfName(rhs.m_irfName), m_pass_ver(rhs.m_pass_ver) {
+    : m_irfName(rhs.m_irfName),
+      m_pass_ver(rhs.m_pass_ver),
+      m_post_P7(rhs.m_post_P7),
+      m_validityMasks(rhs.m_validityMasks) {
   m_cuts.reserve(rhs.size());
   for (unsigned int i = 0; i < rhs.size(); i++) {
-    m_cuts.push_back(rhs.m_cuts[i]->clone());
+    m_cuts.push_back(CutPtr(rhs.m_cuts[i]->clone()));
   }
+  reindex();
 }
 
-Cuts::~Cuts() {
-  for (unsigned int i = 0; i < m_cuts.size(); i++) { delete m_cuts[i]; }
+Cuts::Cuts(Cuts&& rhs) noexcept
+    : m_irfName(std::move(rhs.m_irfName)),
+      m_pass_ver(std::move(rhs.m_pass_ver)),
+      m_post_P7(rhs.m_post_P7),
+      m_validityMasks(std::move(rhs.m_validityMasks)) {
+  swapCuts(rhs);
 }
 
+Cuts::~Cuts() {}
+
 Cuts& Cuts::operator=(const Cuts& rhs) {
   if (*this != rhs) {
-    std::vector<CutBase*>::reverse_iterator cut = m_cuts.rbegin();
-    for (; cut != m_cuts.rend(); cut++) { delete *cut; }
     m_cuts.clear();
+    m_cuts.reserve(rhs.size());
     for (unsigned int i = 0; i < rhs.size(); i++) {
-      m_cuts.push_back(rhs.m_cuts.at(i)->clone());
+      m_cuts.push_back(CutPtr(rhs.m_cuts.at(i)->clone()));
     }
+    reindex();
+  }
+  return *this;
+}
+
+Cuts& Cuts::operator=(Cuts&& rhs) noexcept {
+  if (this != &rhs) {
+    Cuts empty;
+    swapCuts(rhs);
+    // Release the cuts previously held here.
+    rhs.swapCuts(empty);
   }
   return *this;
 }
 
+void Cuts::swapCuts(Cuts& rhs) {
+  // The indices hold pointers to the cut objects themselves, so they
+  // remain valid when exchanged along with the owning vectors.
+  m_cuts.swap(rhs.m_cuts);
+  m_gtiCuts.swap(rhs.m_gtiCuts);
+  m_rangeCuts.swap(rhs.m_rangeCuts);
+  m_bitMaskCuts.swap(rhs.m_bitMaskCuts);
+  m_versionCuts.swap(rhs.m_versionCuts);
+}
+
 bool Cuts::accept(tip::ConstTableRecord& row) const {
   bool ok(true);
   for (unsigned int i = 0; i < m_cuts.size(); i++) {
@@ -353,6 +434,115 @@ bool Cuts::accept(const std::map<std::string, double>& params) const {
   return ok;
 }
 
+RowSelection Cuts::select(const tip::Table& events) const {
+  std::vector<RowTest> tests;
+  for (unsigned int i = 0; i < m_cuts.size(); i++) {
+    tests.push_back(RowTest(*m_cuts[i], events));
+  }
+  RowSelection selection(events);
+  tip::Index_t row(0);
+  tip::Table::ConstIterator it(events.begin());
+  for (; it != events.end(); ++it, ++row) {
+    bool ok(true);
+    for (size_t j = 0; j < tests.size() && ok; j++) {
+      ok = tests[j].accept(row, *it);
+    }
+    if (ok) { selection.addRow(row); }
+  }
+  return selection;
+}
+
+RowSelection Cuts::select(const CompressedTable& events) const {
+  SchemaCuts schemaCuts(*this, events.schema(*this));
+  RowSelection selection(events);
+  const tip::Index_t blockSize(10000);
+  std::vector<char> accepted;
+  for (tip::Index_t first(0); first < events.getNumRecords();
+       first += blockSize) {
+    tip::Index_t nrows(std::min(blockSize, events.getNumRecords() - first));
+    events.accept(schemaCuts, first, nrows, accepted);
+    for (tip::Index_t row(0); row < nrows; row++) {
+      if (accepted[row]) { selection.addRow(first + row); }
+    }
+  }
+  return selection;
+}
+
+void Cuts::planSelection(const tip::Table&          events,
+                         const SelectionStore&      store,
+                         std::vector<unsigned int>& cached,
+                         std::vector<unsigned int>& uncached) const {
+  cached.clear();
+  uncached.clear();
+  for (unsigned int i = 0; i < m_cuts.size(); i++) {
+    if (store.contains(*m_cuts[i], events)) {
+      cached.push_back(i);
+    } else {
+      uncached.push_back(i);
+    }
+  }
+}
+
+RowSelection Cuts::select(const tip::Table&     events,
+                          const SelectionStore& store,
+                          bool                  storeNew) const {
+  // Start with all of the rows, and intersect the stored selections.
+  RowSelection selection(events);
+  selection.addRange(RowSelection::RowRange_t(0, events.getNumRecords()));
+  std::vector<const CutBase*> uncached;
+  for (unsigned int i = 0; i < m_cuts.size(); i++) {
+    RowSelection cutSelection;
+    if (store.find(*m_cuts[i], events, cutSelection)) {
+      selection &= cutSelection;
+    } else {
+      uncached.push_back(m_cuts[i].get());
+    }
+  }
+  if (uncached.empty()) { return selection; }
+
+  std::vector<RowTest> tests;
+  for (size_t j = 0; j < uncached.size(); j++) {
+    tests.push_back(RowTest(*uncached[j], events));
+  }
+
+  if (storeNew) {
+    // Each uncached cut is applied to every row, in a single pass
+    // over the table.
+    std::vector<RowSelection> cutSelections(uncached.size(),
+                                            RowSelection(events));
+    tip::Index_t row(0);
+    tip::Table::ConstIterator it(events.begin());
+    for (; it != events.end(); ++it, ++row) {
+      for (size_t j = 0; j < tests.size(); j++) {
+        if (tests[j].accept(row, *it)) { cutSelections[j].addRow(row); }
+      }
+    }
+    for (size_t j = 0; j < uncached.size(); j++) {
+      store.store(*uncached[j], events, cutSelections[j]);
+      selection &= cutSelections[j];
+    }
+    return selection;
+  }
+
+  // Apply the remaining cuts to the rows that pass the stored
+  // selections.
+  const std::vector<RowSelection::RowRange_t>& ranges(selection.ranges());
+  RowSelection result(events);
+  size_t k(0);
+  tip::Index_t row(0);
+  tip::Table::ConstIterator it(events.begin());
+  for (; it != events.end() && k < ranges.size(); ++it, ++row) {
+    while (k < ranges.size() && ranges[k].second <= row) { k++; }
+    if (k == ranges.size() || row < ranges[k].first) { continue; }
+    bool ok(true);
+    for (size_t j = 0; j < tests.size() && ok; j++) {
+      ok = tests[j].accept(row, *it);
+    }
+    if (ok) { result.addRow(row); }
+  }
+  return result;
+}
+
 unsigned int Cuts::addRangeCut(const std::string&     colname,
                                const std::string&     unit,
                                double                 minVal,
@@ -362,6 +552,14 @@ unsigned int Cuts::addRangeCut(const std::string&     colname,
   return addCut(new RangeCut(colname, unit, minVal, maxVal, type, indx));
 }
 
+unsigned int Cuts::addRangeSetCut(
+    const std::string&                             colname,
+    const std::string&                             unit,
+    const std::vector<std::pair<double, double>>& intervals,
+    unsigned int                                   indx) {
+  return addCut(new RangeSetCut(colname, unit, intervals, indx));
+}
+
 unsigned int Cuts::addGtiCut(const tip::Table& table) {
   return addCut(new GtiCut(table));
 }
@@ -375,7 +573,7 @@ unsigned int Cuts::addSkyConeCut(double ra, double dec, double radius) {
 unsigned int Cuts::addBitMaskCut(const std::string& colname,
                                  unsigned int       mask,
                                  const std::string& pass_ver) {
-  return addCut(new BitMaskCut(colname, mask, pass_ver));
+  return addCut(new BitMaskCut(colname, mask, pass_ver, m_validityMasks));
 }
 
 unsigned int
@@ -389,8 +587,8 @@ unsigned int Cuts::addCut(CutBase* newCut) {
   } else {
     for (unsigned int j = 0; j != size(); j++) {
       if (newCut->supercedes(*(m_cuts[j]))) {
-        delete m_cuts[j];
-        m_cuts[j] = newCut;
+        m_cuts[j].reset(newCut);
+        reindex();
         return size();
       }
       if (m_cuts[j]->supercedes(*newCut)) {
@@ -398,69 +596,61 @@ unsigned int Cuts::addCut(CutBase* newCut) {
         return size();
       }
     }
-    m_cuts.push_back(newCut);
+    m_cuts.push_back(CutPtr(newCut));
+    reindex();
   }
   return size();
 }
 
 unsigned int Cuts::mergeRangeCuts() {
-  std::vector<RangeCut*> rangeCuts;
-  for (size_t j = 0; j < m_cuts.size(); j++) {
-    if (m_cuts.at(j)->type() == "range") {
-      RangeCut* rangeCut(dynamic_cast<RangeCut*>(m_cuts.at(j)));
-      rangeCuts.push_back(rangeCut);
-    }
-  }
-
-  std::map<std::string, int> colnames;
-  for (size_t j = 0; j < rangeCuts.size(); j++) {
-    colnames[rangeCuts.at(j)->colname()] = 1;
+  std::vector<std::string> colnames;
+  for (RangeCutIndex_t::const_iterator it(m_rangeCuts.begin());
+       it != m_rangeCuts.end();
+       ++it) {
+    colnames.push_back(it->first);
   }
 
-  for (std::map<std::string, int>::const_iterator colname(colnames.begin());
-       colname != colnames.end();
-       ++colname) {
-    removeRangeCuts(colname->first, rangeCuts);
-    m_cuts.push_back(::mergeRangeCuts(rangeCuts));
+  std::vector<RangeCut*> rangeCuts;
+  for (size_t j = 0; j < colnames.size(); j++) {
+    removeRangeCuts(colnames[j], rangeCuts);
+    m_cuts.push_back(CutPtr(::mergeRangeCuts(rangeCuts)));
     for (size_t i = 0; i < rangeCuts.size(); i++) { delete rangeCuts.at(i); }
   }
+  reindex();
 
   return m_cuts.size();
 }
 
 unsigned int Cuts::removeVersionCut(const std::string& colname) {
-  std::vector<CutBase*> held_cuts;
+  std::vector<CutPtr> held_cuts;
   for (size_t i(0); i < m_cuts.size(); i++) {
-    if (m_cuts.at(i)->type() == "version") {
-      VersionCut* versionCut(dynamic_cast<VersionCut*>(m_cuts.at(i)));
-      if (versionCut->colname() == colname) {
-        delete m_cuts.at(i);
-        continue;
-      }
+    if (m_cuts.at(i)->kind() == CutBase::VERSION) {
+      VersionCut* versionCut(static_cast<VersionCut*>(m_cuts.at(i).get()));
+      if (versionCut->colname() == colname) { continue; }
     }
-    held_cuts.push_back(m_cuts.at(i));
+    held_cuts.push_back(std::move(m_cuts.at(i)));
   }
-  m_cuts = held_cuts;
+  m_cuts.swap(held_cuts);
+  reindex();
   return m_cuts.size();
 }
 
 unsigned int Cuts::removeRangeCuts(const std::string&      colname,
                                    std::vector<RangeCut*>& removedCuts) {
-  removedCuts.clear();
+  removedCuts = rangeCuts(colname);
+  if (removedCuts.empty()) { return m_cuts.size(); }
+  // Ownership of the removed cuts passes to the caller.
+  std::vector<CutPtr> held_cuts;
   for (size_t j = 0; j < m_cuts.size(); j++) {
-    if (m_cuts.at(j)->type() == "range") {
-      RangeCut* rangeCut(dynamic_cast<RangeCut*>(m_cuts.at(j)));
-      if (rangeCut->colname() == colname) {
-        removedCuts.push_back(rangeCut);
-        m_cuts.at(j) = 0;
-      }
+    if (std::find(removedCuts.begin(), removedCuts.end(), m_cuts.at(j).get())
+        == removedCuts.end()) {
+      held_cuts.push_back(std::move(m_cuts.at(j)));
+    } else {
+      m_cuts.at(j).release();
     }
   }
-  std::vector<CutBase*> held_cuts;
-  for (size_t j = 0; j < m_cuts.size(); j++) {
-    if (m_cuts.at(j)) { held_cuts.push_back(m_cuts.at(j)); }
-  }
-  m_cuts = held_cuts;
+  m_cuts.swap(held_cuts);
+  reindex();
   return m_cuts.size();
 }
 
@@ -468,7 +658,7 @@ void Cuts::writeDssKeywords(tip::Header& header) const {
   removeDssKeywords(header);
   int ndskeys(0);
   for (size_t i = 0; i < m_cuts.size(); i++) {
-    if (!isTimeCut(*m_cuts.at(i)) || m_cuts.at(i)->type() == "GTI") {
+    if (!isTimeCut(*m_cuts.at(i)) || m_cuts.at(i)->kind() == CutBase::GTI) {
       ndskeys++;
       m_cuts[i]->writeDssKeywords(header, ndskeys);
     }
@@ -479,9 +669,11 @@ void Cuts::writeDssKeywords(tip::Header& header) const {
 void Cuts::writeDssTimeKeywords(tip::Header& header) const {
   removeDssKeywords(header);
 
-  std::vector<CutBase*> my_time_cuts;
+  std::vector<const CutBase*> my_time_cuts;
   for (size_t i = 0; i < m_cuts.size(); i++) {
-    if (isTimeCut(*m_cuts.at(i))) { my_time_cuts.push_back(m_cuts.at(i)); }
+    if (isTimeCut(*m_cuts.at(i))) {
+      my_time_cuts.push_back(m_cuts.at(i).get());
+    }
   }
 
   int ndskeys = my_time_cuts.size();
@@ -492,10 +684,11 @@ void Cuts::writeDssTimeKeywords(tip::Header& header) const {
 }
 
 bool Cuts::isTimeCut(const CutBase& cut) {
-  if (cut.type() == "GTI"
-      || (cut.type() == "range"
-          && dynamic_cast<RangeCut&>(const_cast<CutBase&>(cut)).colname()
-                 == "TIME")) {
+  if (cut.kind() == CutBase::GTI
+      || (cut.kind() == CutBase::RANGE
+          && static_cast<const RangeCut&>(cut).colname() == "TIME")
+      || (cut.kind() == CutBase::RANGE_SET
+          && static_cast<const RangeSetCut&>(cut).colname() == "TIME")) {
     return true;
   }
   return false;
@@ -542,20 +735,15 @@ void Cuts::removeDssKeywords(tip::Header& header) const {
 }
 
 void Cuts::writeGtiExtension(const std::string& filename) const {
-  const dataSubselector::Gti* gti(0);
-  for (unsigned int i = 0; i < size(); i++) {
-    if (m_cuts[i]->type() == "GTI") {
-      gti = &(dynamic_cast<GtiCut*>(m_cuts[i])->gti());
-      break; // assume there is at most one GTI
-    }
-  }
-  if (gti) { gti->writeExtension(filename); }
+  // Assume there is at most one GTI.
+  const GtiCut* gti_cut(gtiCut());
+  if (gti_cut) { gti_cut->gti().writeExtension(filename); }
 }
 
 bool Cuts::operator==(const Cuts& rhs) const {
   if (size() != rhs.size()) { return false; }
   for (unsigned int i = 0; i < size(); i++) {
-    unsigned int place = find(rhs.m_cuts.at(i));
+    unsigned int place = find(rhs.m_cuts.at(i).get());
     if (place == size()) { return false; }
   }
   return true;
@@ -564,8 +752,8 @@ bool Cuts::operator==(const Cuts& rhs) const {
 bool Cuts::compareWithoutGtis(const Cuts& rhs) const {
   if (size() != rhs.size()) { return false; }
   for (unsigned int i = 0; i < size(); i++) {
-    if (rhs.m_cuts.at(i)->type() != "GTI") {
-      unsigned int place = find(rhs.m_cuts.at(i));
+    if (rhs.m_cuts.at(i)->kind() != CutBase::GTI) {
+      unsigned int place = find(rhs.m_cuts.at(i).get());
       if (place == size()) { return false; }
     }
   }
@@ -574,7 +762,7 @@ bool Cuts::compareWithoutGtis(const Cuts& rhs) const {
 
 void Cuts::writeCuts(std::ostream& stream, bool suppressGtis) const {
   for (unsigned int i = 0; i < m_cuts.size(); i++) {
-    if (!suppressGtis || m_cuts.at(i)->type() != "GTI") {
+    if (!suppressGtis || m_cuts.at(i)->kind() != CutBase::GTI) {
       m_cuts.at(i)->writeCut(stream, i + 1);
     } else {
       stream << "DSTYP" << i + 1 << ": TIME\n"
@@ -601,8 +789,7 @@ std::string Cuts::filterString() const {
 const std::string& Cuts::irfName() const { return m_irfName; }
 
 std::string Cuts::CALDB_implied_irfs() const {
-  std::map<std::string, unsigned int> irfs;
-  read_bitmask_mapping(irfs);
+  IrfIndex::IrfIndexPtr irf_index(IrfIndex::instance());
   // Test against names in the EVENT_CLASS column of the
   // BITMASK_MAPPING extension of irf_index.fits.
   //
@@ -612,82 +799,59 @@ std::string Cuts::CALDB_implied_irfs() const {
   if ((pos = test_irfName.find(" (")) != std::string::npos) {
     test_irfName = test_irfName.substr(0, pos);
   }
-  if (test_irfName != "NONE" && irfs.find(test_irfName) == irfs.end()) {
+  unsigned int test_mask;
+  if (test_irfName != "NONE" && !irf_index->mask(test_irfName, test_mask)) {
     throw std::runtime_error("Invalid IRF name: " + test_irfName);
   }
-  const BitMaskCut* my_bitmask_cut(bitMaskCut("EVENT_CLASS"));
+  const BitMaskCut* my_bitmask_cut(findBitMaskCut("EVENT_CLASS"));
   if (my_bitmask_cut == 0) {
-    delete my_bitmask_cut;
     throw std::runtime_error("No EVENT_CLASS bitmask cut in input file, so "
                              "cannot infer most recent IRFs from CALDB.");
   }
   unsigned int mask(my_bitmask_cut->mask());
-  delete my_bitmask_cut;
-  /* std::map<std::string, unsigned int>::const_iterator it(irfs.begin()); */
 
+  // The IRFs with this bit mask and PASS_VER, newest first.
+  const IrfIndex::IrfVersions_t& candidates(
+      irf_index->versions(m_pass_ver, mask));
 
   bool        caldb_flag = test_irfName == "NONE";
   std::string irfs_name("");
 
-
   if (caldb_flag) {
-    unsigned int irf_ver_num(0);
-    for (auto const& irf : irfs) {
-      if (irf.second != mask) { continue; }
-      std::string pass_ver;
-      std::string irf_ver;
-      extract_irf_versions(irf.first, pass_ver, irf_ver);
-      unsigned int candidate_irf_ver_num(std::atoi(irf_ver.substr(1).c_str()));
-      if (pass_ver == m_pass_ver
-          && (irfs_name == "" || candidate_irf_ver_num > irf_ver_num)) {
-        irfs_name   = irf.first;
-        irf_ver_num = candidate_irf_ver_num;
-      }
-    }
+    if (!candidates.empty()) { irfs_name = candidates.front().second; }
   } else {
-
     std::string pass_ver;
     std::string irf_ver;
     extract_irf_versions(test_irfName, pass_ver, irf_ver);
     unsigned int const irf_ver_num(std::atoi(irf_ver.substr(1).c_str()));
 
-    bool        better_irfs_option = false;
-    std::string better_irfs_name   = "";
-
-    for (auto const& irf : irfs) {
-      if (irf.second != mask) { continue; }
-      extract_irf_versions(irf.first, pass_ver, irf_ver);
-      unsigned int candidate_irf_ver_num(std::atoi(irf_ver.substr(1).c_str()));
-      if (pass_ver == m_pass_ver && irfs_name == ""
-          && candidate_irf_ver_num == irf_ver_num) {
-        irfs_name = irf.first;
-      }
-      if (pass_ver == m_pass_ver && candidate_irf_ver_num > irf_ver_num) {
-        better_irfs_option = true;
-        better_irfs_name   = irf.first;
+    for (auto const& irf : candidates) {
+      if (irf.first == irf_ver_num) {
+        irfs_name = irf.second;
+        break;
       }
+      if (irf.first < irf_ver_num) { break; }
     }
 
-    if (better_irfs_option) {
+    if (!candidates.empty() && candidates.front().first > irf_ver_num) {
       st_stream::StreamFormatter formatter(
           "dataSubselector::Cuts", "CALDB_implied_irfs", 2);
       formatter.warn() << "\n******************************************\n"
                        << "    WARNING:\n"
                        << "    Newer IRF version available. "
-                       << better_irfs_name
+                       << candidates.front().second
                        << "\n******************************************\n"
                        << std::endl;
     }
   }
 
-
   append_event_type_partition(irfs_name);
   return irfs_name;
 }
 
 void Cuts::append_event_type_partition(std::string& irfs_name) const {
   /// Infer event_type partition.
-  const BitMaskCut* event_type_cut(bitMaskCut("EVENT_TYPE"));
+  const BitMaskCut* event_type_cut(findBitMaskCut("EVENT_TYPE"));
   if (event_type_cut) {
     typedef std::map<std::string, std::pair<unsigned int, std::string>>
                               EventTypeMapping_t;
@@ -708,23 +872,9 @@ void Cuts::append_event_type_partition(std::string& irfs_name) const {
 }
 
 void Cuts::read_bitmask_mapping(std::map<std::string, unsigned int>& irfs) {
+  const IrfIndex::MaskMap_t& masks(IrfIndex::instance()->masks());
   irfs.clear();
-  std::string sub_path;
-  ::joinPaths("data glast lat bcf irf_index.fits", sub_path);
-  std::string irf_index = facilities::commonUtilities::joinPath(
-      st_facilities::Environment::getEnv("CALDB"), sub_path);
-  const tip::Table* irf_map
-      = tip::IFileSvc::instance().readTable(irf_index, "BITMASK_MAPPING");
-  tip::Table::ConstIterator it(irf_map->begin());
-  tip::ConstTableRecord&    row = *it;
-  for (; it != irf_map->end(); ++it) {
-    std::string event_class;
-    int         bitpos;
-    row["event_class"].get(event_class);
-    row["bitposition"].get(bitpos);
-    irfs[event_class] = 1 << bitpos;
-  }
-  delete irf_map;
+  irfs.insert(masks.begin(), masks.end());
 }
 
 void Cuts::read_pass_ver(const std::string& infile, const std::string& ext) {
@@ -741,8 +891,8 @@ void Cuts::read_pass_ver(const std::string& infile, const std::string& ext) {
   } catch (tip::TipException& eObj) {
     if (st_facilities::Util::expectedException(eObj, "Cannot read keyword")) {
       // Look for pass_ver from BIT_MASK cut.
-      if (bitMaskCut()) {
-        m_pass_ver = bitMaskCut()->pass_ver();
+      if (findBitMaskCut()) {
+        m_pass_ver = findBitMaskCut()->pass_ver();
         return;
       }
     }
@@ -751,30 +901,26 @@ void Cuts::read_pass_ver(const std::string& infile, const std::string& ext) {
 }
 
 void Cuts::set_irfName(const std::string& infile, const std::string& ext) {
-  for (size_t i(0); i < m_cuts.size(); i++) {
-    VersionCut* version_cut
-        = dynamic_cast<VersionCut*>(const_cast<CutBase*>(m_cuts[i]));
-    if (version_cut && version_cut->colname() == "IRF_VERSION") {
-      m_irfName = version_cut->version();
-      //         continue;
-      break;
-    }
-    /// @todo Need to determine if there is any context where adding the
-    /// FRONT/BACK qualifier is needed, since CONVTYPE cuts are included
-    /// in DSS keywords already and read in by tools like gtexpmap.
-    //
-    //       RangeCut * convtype_cut
-    //          = dynamic_cast<RangeCut *>(const_cast<CutBase *>(m_cuts[i]));
-    //       if (convtype_cut && convtype_cut->colname() == "CONVERSION_TYPE") {
-    //          if (convtype_cut->minVal() == 0 &&
-    //              convtype_cut->maxVal() == 0) {
-    //             m_irfName += "::FRONT";
-    //          } else if (convtype_cut->minVal() == 1 &&
-    //                     convtype_cut->maxVal() == 1) {
-    //             m_irfName += "::BACK";
-    //          }
-    //       }
+  std::map<std::string, VersionCut*>::const_iterator version_cut(
+      m_versionCuts.find("IRF_VERSION"));
+  if (version_cut != m_versionCuts.end()) {
+    m_irfName = version_cut->second->version();
   }
+  /// @todo Need to determine if there is any context where adding the
+  /// FRONT/BACK qualifier is needed, since CONVTYPE cuts are included
+  /// in DSS keywords already and read in by tools like gtexpmap.
+  //
+  //       RangeCut * convtype_cut
+  //          = dynamic_cast<RangeCut *>(const_cast<CutBase *>(m_cuts[i]));
+  //       if (convtype_cut && convtype_cut->colname() == "CONVERSION_TYPE") {
+  //          if (convtype_cut->minVal() == 0 &&
+  //              convtype_cut->maxVal() == 0) {
+  //             m_irfName += "::FRONT";
+  //          } else if (convtype_cut->minVal() == 1 &&
+  //                     convtype_cut->maxVal() == 1) {
+  //             m_irfName += "::BACK";
+  //          }
+  //       }
 }
 
 void Cuts::extract_irf_versions(const std::string& irf_name,
@@ -801,7 +947,7 @@ void Cuts::extract_irf_versions(const std::string& irf_name,
 }
 
 void Cuts::setIrfs(const std::string& irfName) {
-  if (bitMaskCut()) {
+  if (findBitMaskCut()) {
     throw std::runtime_error("dataSubselector::Cuts::setIrfs: "
                              "Bit mask cut already set");
   }
@@ -812,20 +958,19 @@ void Cuts::setIrfs(const std::string& irfName) {
     // selection.
     std::string section(
         irfName.substr(delim_pos - 1, irfName.length() - delim_pos + 1));
-    RangeCut* convtype_cut(0);
-    for (size_t i(0); i < m_cuts.size(); i++) {
-      convtype_cut = dynamic_cast<RangeCut*>(const_cast<CutBase*>(m_cuts[i]));
-      if (convtype_cut && convtype_cut->colname() == "CONVERSION_TYPE") {
-        if ((convtype_cut->minVal() == 0 && convtype_cut->maxVal() == 0
-             && section != "::FRONT")
-            || (convtype_cut->minVal() == 1 && convtype_cut->maxVal() == 1
-                && section != "::BACK")) {
-          throw std::runtime_error("dataSubselector::Cuts::setIrfs: "
-                                   "Inconsistent FRONT/BACK selection");
-        }
+    const std::vector<RangeCut*>& convtype_cuts(
+        rangeCuts("CONVERSION_TYPE"));
+    for (size_t i(0); i < convtype_cuts.size(); i++) {
+      const RangeCut* convtype_cut(convtype_cuts[i]);
+      if ((convtype_cut->minVal() == 0 && convtype_cut->maxVal() == 0
+           && section != "::FRONT")
+          || (convtype_cut->minVal() == 1 && convtype_cut->maxVal() == 1
+              && section != "::BACK")) {
+        throw std::runtime_error("dataSubselector::Cuts::setIrfs: "
+                                 "Inconsistent FRONT/BACK selection");
       }
     }
-    if (!convtype_cut) {
+    if (convtype_cuts.empty()) {
       // Add a CONVERSION_TYPE selection based in irfName.
       if (section == "::FRONT") {
         addRangeCut("CONVERSION_TYPE", "dimensionless", 0, 0);
@@ -842,13 +987,9 @@ void Cuts::setIrfs(const std::string& irfName) {
   extract_irf_versions(event_class, m_pass_ver, irf_ver);
   m_post_P7 = BitMaskCut::post_P7(m_pass_ver);
 
-  std::map<std::string, unsigned int> irfs;
   try {
-    read_bitmask_mapping(irfs);
-    std::map<std::string, unsigned int>::const_iterator it
-        = irfs.find(event_class);
-    if (it != irfs.end()) {
-      unsigned int mask(it->second);
+    unsigned int mask;
+    if (IrfIndex::instance()->mask(event_class, mask)) {
       addBitMaskCut("EVENT_CLASS", mask, m_pass_ver);
     }
   } catch (std::runtime_error& eObj) {
@@ -860,35 +1001,43 @@ void Cuts::setIrfs(const std::string& irfName) {
 }
 
 BitMaskCut* Cuts::bitMaskCut(const std::string& colname) const {
-  for (size_t i(0); i < m_cuts.size(); i++) {
-    const BitMaskCut* bit_mask_cut = dynamic_cast<const BitMaskCut*>(m_cuts[i]);
-    if (bit_mask_cut && bit_mask_cut->colname() == colname) {
-      return new BitMaskCut(*bit_mask_cut);
-    }
-  }
-  return 0;
+  const BitMaskCut* bit_mask_cut(findBitMaskCut(colname));
+  if (!bit_mask_cut) { return 0; }
+  return new BitMaskCut(*bit_mask_cut);
 }
 
 std::vector<BitMaskCut*> Cuts::bitMaskCuts() const {
   std::vector<BitMaskCut*> my_bitMaskCuts;
   for (size_t i(0); i < m_cuts.size(); i++) {
-    const BitMaskCut* bit_mask_cut = dynamic_cast<const BitMaskCut*>(m_cuts[i]);
-    if (bit_mask_cut) {
-      my_bitMaskCuts.push_back(new BitMaskCut(*bit_mask_cut));
+    if (m_cuts[i]->kind() == CutBase::BIT_MASK) {
+      my_bitMaskCuts.push_back(
+          new BitMaskCut(static_cast<const BitMaskCut&>(*m_cuts[i])));
     }
   }
   return my_bitMaskCuts;
 }
 
-RangeCut* Cuts::conversionTypeCut() const {
+const BitMaskCut* Cuts::findBitMaskCut(const std::string& colname) const {
+  std::map<std::string, BitMaskCut*>::const_iterator it(
+      m_bitMaskCuts.find(colname));
+  if (it == m_bitMaskCuts.end()) { return 0; }
+  return it->second;
+}
+
+std::vector<const BitMaskCut*> Cuts::findBitMaskCuts() const {
+  std::vector<const BitMaskCut*> my_bitMaskCuts;
   for (size_t i(0); i < m_cuts.size(); i++) {
-    RangeCut* range_cut
-        = dynamic_cast<RangeCut*>(const_cast<CutBase*>(m_cuts[i]));
-    if (range_cut && range_cut->colname() == "CONVERSION_TYPE") {
-      return range_cut;
+    if (m_cuts[i]->kind() == CutBase::BIT_MASK) {
+      my_bitMaskCuts.push_back(static_cast<const BitMaskCut*>(m_cuts[i].get()));
     }
   }
-  return 0;
+  return my_bitMaskCuts;
+}
+
+RangeCut* Cuts::conversionTypeCut() const {
+  const std::vector<RangeCut*>& convtype_cuts(rangeCuts("CONVERSION_TYPE"));
+  if (convtype_cuts.empty()) { return 0; }
+  return convtype_cuts.front();
 }
 
 void Cuts::setBitMaskCut(BitMaskCut* candidateCut) {
@@ -897,18 +1046,18 @@ void Cuts::setBitMaskCut(BitMaskCut* candidateCut) {
     return;
   }
   // Delete any existing BitMaskCuts operating on the same column.
-  std::vector<CutBase*> my_cuts;
+  std::vector<CutPtr> my_cuts;
   for (size_t i(0); i < m_cuts.size(); i++) {
-    BitMaskCut* currentCut(dynamic_cast<BitMaskCut*>(m_cuts[i]));
-    if (currentCut && (currentCut->colname() == candidateCut->colname())) {
-      delete m_cuts[i];
-    } else {
-      my_cuts.push_back(m_cuts[i]);
+    if (m_cuts[i]->kind() != CutBase::BIT_MASK
+        || (static_cast<BitMaskCut*>(m_cuts[i].get())->colname()
+            != candidateCut->colname())) {
+      my_cuts.push_back(std::move(m_cuts[i]));
     }
   }
   // Add the candidate cut.
-  my_cuts.push_back(candidateCut);
-  m_cuts = my_cuts;
+  my_cuts.push_back(CutPtr(candidateCut));
+  m_cuts.swap(my_cuts);
+  reindex();
 }
 
 } // namespace dataSubselector
@@ -0,0 +1,400 @@
+/**
+ * @file EventIndex.cxx
+ * @brief Block summaries of an event table, stored in a sidecar file,
+ * for skipping blocks of rows that cannot pass a set of Cuts.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdio>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "fitsio.h"
+
+#include "tip/Header.h"
+#include "tip/Table.h"
+#include "tip/TipException.h"
+
+#include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/EventIndex.h"
+#include "dataSubselector/GtiCut.h"
+#include "dataSubselector/RangeCut.h"
+#include "dataSubselector/RangeSetCut.h"
+#include "dataSubselector/SkyConeCut.h"
+
+#include "CfitsioUtil.h"
+
+namespace {
+   bool hasField(const tip::Table & table, const std::string & colname) {
+      try {
+         table.getFieldIndex(colname);
+         return true;
+      } catch (tip::TipException &) {
+         return false;
+      }
+   }
+
+   bool endsWith(const std::string & name, const std::string & suffix) {
+      return (name.size() > suffix.size() &&
+              name.compare(name.size() - suffix.size(), suffix.size(),
+                           suffix) == 0);
+   }
+
+   /// True if the closed intervals [lo1, hi1] and [lo2, hi2] intersect.
+   bool overlaps(double lo1, double hi1, double lo2, double hi2) {
+      return lo1 <= hi2 && lo2 <= hi1;
+   }
+
+   /// Margin (degrees) for rounding in SkyConeCut::accept.
+   const double epsilon(1e-6);
+}
+
+namespace dataSubselector {
+
+EventIndex::EventIndex(const tip::Table & events, tip::Index_t blockSize,
+                       double pixelSize)
+   : m_hasSky(false), m_grid(pixelSize), m_nrows(events.getNumRecords()),
+     m_datasum(CfitsioUtil::datasum(events)) {
+   if (blockSize < 1) {
+      throw std::runtime_error("EventIndex: block size must be positive.");
+   }
+   const char * rangeColumns[] = {"TIME", "ENERGY", "ZENITH_ANGLE"};
+   for (size_t j(0); j < 3; j++) {
+      if (hasField(events, rangeColumns[j])) {
+         m_rangeColumns.push_back(rangeColumns[j]);
+      }
+   }
+   const char * maskColumns[] = {"EVENT_CLASS", "EVENT_TYPE"};
+   for (size_t j(0); j < 2; j++) {
+      if (hasField(events, maskColumns[j])) {
+         m_maskColumns.push_back(maskColumns[j]);
+      }
+   }
+   m_hasSky = hasField(events, "RA") && hasField(events, "DEC");
+
+   const double inf(std::numeric_limits<double>::infinity());
+   Block empty;
+   empty.nrows = 0;
+   empty.minValues.resize(m_rangeColumns.size(), inf);
+   empty.maxValues.resize(m_rangeColumns.size(), -inf);
+   empty.masks.resize(m_maskColumns.size(), 0);
+   if (m_hasSky) {
+      empty.pixels.resize((m_grid.numPixels() + 7)/8, 0);
+   }
+
+   tip::Index_t record(0);
+   tip::Table::ConstIterator it(events.begin());
+   tip::ConstTableRecord & row(*it);
+   for ( ; it != events.end(); ++it, ++record) {
+      if (record % blockSize == 0) {
+         m_blocks.push_back(empty);
+         m_blocks.back().first = record;
+      }
+      Block & block(m_blocks.back());
+      block.nrows++;
+      for (size_t j(0); j < m_rangeColumns.size(); j++) {
+         double value;
+         row[m_rangeColumns[j]].get(value);
+         block.minValues[j] = std::min(block.minValues[j], value);
+         block.maxValues[j] = std::max(block.maxValues[j], value);
+      }
+      for (size_t j(0); j < m_maskColumns.size(); j++) {
+         unsigned int value;
+         row[m_maskColumns[j]].get(value);
+         block.masks[j] |= value;
+      }
+      if (m_hasSky) {
+         double ra, dec;
+         row["RA"].get(ra);
+         row["DEC"].get(dec);
+         unsigned int pixel(m_grid.pixel(ra, dec));
+         block.pixels[pixel/8] |= (1 << (pixel % 8));
+      }
+   }
+}
+
+EventIndex::EventIndex(const std::string & indexFile)
+   : m_hasSky(false), m_grid(2.), m_nrows(0) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, indexFile.c_str(), READONLY, &status);
+   CfitsioUtil::checkStatus(status, "EventIndex");
+   char extname[] = "BLOCKS";
+   fits_movnam_hdu(fptr, BINARY_TBL, extname, 0, &status);
+   double pixelSize;
+   fits_read_key(fptr, TDOUBLE, "PIXSIZE", &pixelSize, 0, &status);
+   LONGLONG nrows;
+   fits_read_key(fptr, TLONGLONG, "SRCROWS", &nrows, 0, &status);
+   char datasum[81];
+   fits_read_key(fptr, TSTRING, "SRCSUM", datasum, 0, &status);
+   long nblocks;
+   fits_get_num_rows(fptr, &nblocks, &status);
+   int ncols;
+   fits_get_num_cols(fptr, &ncols, &status);
+   CfitsioUtil::checkStatus(status, "EventIndex", fptr);
+   m_grid = SkyGrid(pixelSize);
+   m_nrows = nrows;
+   m_datasum = datasum;
+
+// The indexed columns are found from the column names.
+   std::vector<int> minCols, maxCols, maskCols;
+   int skyCol(0);
+   for (int col(1); col <= ncols; col++) {
+      char keyname[20];
+      std::sprintf(keyname, "TTYPE%d", col);
+      char ttype[81];
+      fits_read_key(fptr, TSTRING, keyname, ttype, 0, &status);
+      CfitsioUtil::checkStatus(status, "EventIndex", fptr);
+      std::string name(ttype);
+      if (endsWith(name, "_MIN")) {
+         m_rangeColumns.push_back(name.substr(0, name.size() - 4));
+         minCols.push_back(col);
+         maxCols.push_back(col + 1);
+      } else if (endsWith(name, "_OR")) {
+         m_maskColumns.push_back(name.substr(0, name.size() - 3));
+         maskCols.push_back(col);
+      } else if (name == "SKY_PIXELS") {
+         m_hasSky = true;
+         skyCol = col;
+      }
+   }
+
+   m_blocks.resize(nblocks);
+   std::vector<LONGLONG> llvalues(nblocks);
+   std::vector<double> values(nblocks);
+   int anynul(0);
+   if (nblocks > 0) {
+      fits_read_col(fptr, TLONGLONG, 1, 1, 1, nblocks, 0, &llvalues[0],
+                    &anynul, &status);
+      for (long i(0); i < nblocks; i++) {
+         m_blocks[i].first = llvalues[i];
+      }
+      fits_read_col(fptr, TLONGLONG, 2, 1, 1, nblocks, 0, &llvalues[0],
+                    &anynul, &status);
+      for (long i(0); i < nblocks; i++) {
+         m_blocks[i].nrows = llvalues[i];
+      }
+   }
+   for (size_t j(0); j < minCols.size() && nblocks > 0; j++) {
+      fits_read_col(fptr, TDOUBLE, minCols[j], 1, 1, nblocks, 0, &values[0],
+                    &anynul, &status);
+      for (long i(0); i < nblocks; i++) {
+         m_blocks[i].minValues.push_back(values[i]);
+      }
+      fits_read_col(fptr, TDOUBLE, maxCols[j], 1, 1, nblocks, 0, &values[0],
+                    &anynul, &status);
+      for (long i(0); i < nblocks; i++) {
+         m_blocks[i].maxValues.push_back(values[i]);
+      }
+   }
+   for (size_t j(0); j < maskCols.size() && nblocks > 0; j++) {
+      fits_read_col(fptr, TLONGLONG, maskCols[j], 1, 1, nblocks, 0,
+                    &llvalues[0], &anynul, &status);
+      for (long i(0); i < nblocks; i++) {
+         m_blocks[i].masks.push_back(static_cast<unsigned int>(llvalues[i]));
+      }
+   }
+   if (m_hasSky) {
+      size_t nbytes((m_grid.numPixels() + 7)/8);
+      for (long i(0); i < nblocks; i++) {
+         m_blocks[i].pixels.resize(nbytes);
+         fits_read_col(fptr, TBYTE, skyCol, i + 1, 1, nbytes, 0,
+                       &m_blocks[i].pixels[0], &anynul, &status);
+      }
+   }
+   CfitsioUtil::checkStatus(status, "EventIndex", fptr);
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "EventIndex");
+}
+
+void EventIndex::write(const std::string & indexFile) const {
+   std::vector<std::string> ttype;
+   std::vector<std::string> tform;
+   ttype.push_back("FIRST_ROW");
+   tform.push_back("1K");
+   ttype.push_back("NROWS");
+   tform.push_back("1K");
+   for (size_t j(0); j < m_rangeColumns.size(); j++) {
+      ttype.push_back(m_rangeColumns[j] + "_MIN");
+      tform.push_back("1D");
+      ttype.push_back(m_rangeColumns[j] + "_MAX");
+      tform.push_back("1D");
+   }
+   for (size_t j(0); j < m_maskColumns.size(); j++) {
+      ttype.push_back(m_maskColumns[j] + "_OR");
+      tform.push_back("1K");
+   }
+   size_t nbytes((m_grid.numPixels() + 7)/8);
+   if (m_hasSky) {
+      char form[20];
+      std::sprintf(form, "%luB", static_cast<unsigned long>(nbytes));
+      ttype.push_back("SKY_PIXELS");
+      tform.push_back(form);
+   }
+   std::vector<char *> ttype_ptrs;
+   std::vector<char *> tform_ptrs;
+   for (size_t j(0); j < ttype.size(); j++) {
+      ttype_ptrs.push_back(const_cast<char *>(ttype[j].c_str()));
+      tform_ptrs.push_back(const_cast<char *>(tform[j].c_str()));
+   }
+
+   std::remove(indexFile.c_str());
+   int status(0);
+   fitsfile * fptr(0);
+   fits_create_file(&fptr, indexFile.c_str(), &status);
+   CfitsioUtil::checkStatus(status, "EventIndex::write");
+   char extname[] = "BLOCKS";
+   fits_create_tbl(fptr, BINARY_TBL, 0, ttype.size(), &ttype_ptrs[0],
+                   &tform_ptrs[0], 0, extname, &status);
+   double pixelSize(m_grid.bandHeight());
+   fits_update_key(fptr, TDOUBLE, "PIXSIZE", &pixelSize,
+                   "SkyGrid pixel size (deg)", &status);
+   LONGLONG nrows(m_nrows);
+   fits_update_key(fptr, TLONGLONG, "SRCROWS", &nrows,
+                   "Number of rows in the event table", &status);
+   fits_update_key(fptr, TSTRING, "SRCSUM",
+                   const_cast<char *>(m_datasum.c_str()),
+                   "DATASUM of the event table", &status);
+
+   for (size_t i(0); i < m_blocks.size(); i++) {
+      const Block & block(m_blocks[i]);
+      LONGLONG row(i + 1);
+      int col(1);
+      LONGLONG value(block.first);
+      fits_write_col(fptr, TLONGLONG, col++, row, 1, 1, &value, &status);
+      value = block.nrows;
+      fits_write_col(fptr, TLONGLONG, col++, row, 1, 1, &value, &status);
+      for (size_t j(0); j < m_rangeColumns.size(); j++) {
+         double minValue(block.minValues[j]);
+         double maxValue(block.maxValues[j]);
+         fits_write_col(fptr, TDOUBLE, col++, row, 1, 1, &minValue, &status);
+         fits_write_col(fptr, TDOUBLE, col++, row, 1, 1, &maxValue, &status);
+      }
+      for (size_t j(0); j < m_maskColumns.size(); j++) {
+         value = block.masks[j];
+         fits_write_col(fptr, TLONGLONG, col++, row, 1, 1, &value, &status);
+      }
+      if (m_hasSky) {
+         fits_write_col(fptr, TBYTE, col++, row, 1, nbytes,
+                        const_cast<unsigned char *>(&block.pixels[0]),
+                        &status);
+      }
+   }
+   CfitsioUtil::checkStatus(status, "EventIndex::write", fptr);
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "EventIndex::write");
+}
+
+bool EventIndex::matches(const tip::Table & events) const {
+   return CfitsioUtil::matches(events, m_nrows, m_datasum);
+}
+
+void EventIndex::rowRanges(const Cuts & cuts,
+                           std::vector<RowRange_t> & ranges) const {
+   ranges.clear();
+   const double inf(std::numeric_limits<double>::infinity());
+
+// Find the SkyGrid pixels that overlap each SkyConeCut.
+   std::map<unsigned int, std::vector<unsigned int> > conePixels;
+   for (unsigned int i(0); i < cuts.size() && m_hasSky; i++) {
+      if (cuts[i].kind() != CutBase::SKYCONE) {
+         continue;
+      }
+      const SkyConeCut & cone(static_cast<const SkyConeCut &>(cuts[i]));
+      std::vector<unsigned int> & pixels(conePixels[i]);
+      for (unsigned int pixel(0); pixel < m_grid.numPixels(); pixel++) {
+         double ra, dec, radius;
+         m_grid.pixelCircle(pixel, ra, dec, radius);
+         if (SkyGrid::separation(cone.ra(), cone.dec(), ra, dec) - radius
+             <= cone.radius() + epsilon) {
+            pixels.push_back(pixel);
+         }
+      }
+   }
+
+   for (size_t ib(0); ib < m_blocks.size(); ib++) {
+      const Block & block(m_blocks[ib]);
+      bool pass(true);
+      for (unsigned int i(0); i < cuts.size() && pass; i++) {
+         const CutBase & cut(cuts[i]);
+         std::string colname;
+         switch (cut.kind()) {
+         case CutBase::RANGE:
+            colname = static_cast<const RangeCut &>(cut).colname();
+            break;
+         case CutBase::RANGE_SET:
+            colname = static_cast<const RangeSetCut &>(cut).colname();
+            break;
+         case CutBase::GTI:
+            colname = "TIME";
+            break;
+         case CutBase::BIT_MASK:
+            colname = static_cast<const BitMaskCut &>(cut).colname();
+            break;
+         default:
+            break;
+         }
+         size_t j(std::find(m_rangeColumns.begin(), m_rangeColumns.end(),
+                            colname) - m_rangeColumns.begin());
+         bool hasRange(j < m_rangeColumns.size());
+         double minValue(hasRange ? block.minValues[j] : 0);
+         double maxValue(hasRange ? block.maxValues[j] : 0);
+         if (cut.kind() == CutBase::RANGE && hasRange) {
+            const RangeCut & rangeCut(static_cast<const RangeCut &>(cut));
+            double lo(rangeCut.minVal());
+            double hi(rangeCut.maxVal());
+            if (rangeCut.intervalType() == RangeCut::MINONLY) {
+               hi = inf;
+            } else if (rangeCut.intervalType() == RangeCut::MAXONLY) {
+               lo = -inf;
+            }
+            pass = overlaps(minValue, maxValue, lo, hi);
+         } else if (cut.kind() == CutBase::RANGE_SET && hasRange) {
+            const std::vector<RangeSetCut::Interval_t> & intervals
+               = static_cast<const RangeSetCut &>(cut).intervals();
+            pass = false;
+            for (size_t k(0); k < intervals.size() && !pass; k++) {
+               pass = overlaps(minValue, maxValue, intervals[k].first,
+                               intervals[k].second);
+            }
+         } else if (cut.kind() == CutBase::GTI && hasRange) {
+            const Gti & gti(static_cast<const GtiCut &>(cut).gti());
+            pass = false;
+            for (evtbin::Gti::ConstIterator it(gti.begin());
+                 it != gti.end() && !pass; ++it) {
+               pass = overlaps(minValue, maxValue, it->first, it->second);
+            }
+         } else if (cut.kind() == CutBase::BIT_MASK) {
+            size_t k(std::find(m_maskColumns.begin(), m_maskColumns.end(),
+                               colname) - m_maskColumns.begin());
+            if (k < m_maskColumns.size()) {
+               pass = static_cast<const BitMaskCut &>(cut)
+                  .accept(block.masks[k]);
+            }
+         } else if (cut.kind() == CutBase::SKYCONE && m_hasSky) {
+            const std::vector<unsigned int> & pixels(conePixels[i]);
+            pass = false;
+            for (size_t k(0); k < pixels.size() && !pass; k++) {
+               pass = block.occupied(pixels[k]);
+            }
+         }
+      }
+      if (!pass) {
+         continue;
+      }
+      tip::Index_t last(block.first + block.nrows);
+      if (!ranges.empty() && ranges.back().second == block.first) {
+         ranges.back().second = last;
+      } else {
+         ranges.push_back(RowRange_t(block.first, last));
+      }
+   }
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,509 @@
+/**
+ * @file FilterPipeline.cxx
+ * @brief Copy the rows of an event table that pass a set of cuts,
+ * overlapping the reading, filtering, and writing of the rows.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "fitsio.h"
+
+#include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/BoundedQueue.h"
+#include "dataSubselector/ChunkScheduler.h"
+#include "dataSubselector/ColumnProjection.h"
+#include "dataSubselector/FilterPipeline.h"
+#include "dataSubselector/Gti.h"
+#include "dataSubselector/RangeCut.h"
+#include "dataSubselector/RangeSetCut.h"
+#include "dataSubselector/RowLayout.h"
+#include "dataSubselector/SchemaCuts.h"
+
+#include "CfitsioUtil.h"
+
+namespace {
+   /// Open the input and output tables and get the number of rows
+   /// already in the output table.
+   void openTables(const std::string & infile, const std::string & outfile,
+                   const std::string & extension, fitsfile *& infptr,
+                   fitsfile *& outfptr, LONGLONG & nout) {
+      int status(0);
+      fits_open_file(&infptr, infile.c_str(), READONLY, &status);
+      fits_movnam_hdu(infptr, BINARY_TBL,
+                      const_cast<char *>(extension.c_str()), 0, &status);
+      fits_open_file(&outfptr, outfile.c_str(), READWRITE, &status);
+      fits_movnam_hdu(outfptr, BINARY_TBL,
+                      const_cast<char *>(extension.c_str()), 0, &status);
+      fits_get_num_rowsll(outfptr, &nout, &status);
+      dataSubselector::CfitsioUtil::checkStatus(status,
+                                                "FilterPipeline::openTables");
+   }
+
+   /// Read nbytes as a big-endian unsigned integer.
+   unsigned long long bigEndian(const unsigned char * bytes, int nbytes) {
+      unsigned long long value(0);
+      for (int i(0); i < nbytes; i++) {
+         value = (value << 8) | bytes[i];
+      }
+      return value;
+   }
+}
+
+namespace dataSubselector {
+
+/// The rows of a chunk and the decoded cut columns.  Accepted rows
+/// are moved to the front of the byte buffer by the worker threads.
+struct FilterPipeline::Chunk {
+   size_t sequence;
+   tip::Index_t first;
+   long nrows;
+   long naccepted;
+   std::vector<unsigned char> bytes;
+   std::vector<std::vector<double> > columns;
+   std::vector<const double *> columnPointers;
+   std::vector<char> accepted;
+};
+
+FilterPipeline::FilterPipeline(const std::string & infile,
+                               const std::string & extension,
+                               const Cuts & cuts, unsigned int nworkers,
+                               tip::Index_t chunkSize)
+   : m_infile(infile), m_extension(extension), m_cuts(cuts),
+     m_nworkers(std::max(nworkers, 1u)), m_chunkSize(chunkSize),
+     m_rowSize(0), m_supported(true), m_projection(0) {
+   if (chunkSize <= 0) {
+      throw std::runtime_error("FilterPipeline: chunk size must be "
+                               "positive.");
+   }
+   m_cuts.addGtiCut(Gti(infile));
+   findColumns();
+}
+
+void FilterPipeline::findColumns() {
+// Find the columns used by the cuts.  Cuts on elements of vector
+// columns, or of unknown types, are not handled.
+   std::vector<std::string> colnames;
+   for (unsigned int i(0); i < m_cuts.size(); i++) {
+      const CutBase & cut(m_cuts[i]);
+      switch (cut.kind()) {
+      case CutBase::RANGE:
+         if (static_cast<const RangeCut &>(cut).index() != 0) {
+            m_supported = false;
+         }
+         colnames.push_back(static_cast<const RangeCut &>(cut).colname());
+         break;
+      case CutBase::RANGE_SET:
+         if (static_cast<const RangeSetCut &>(cut).index() != 0) {
+            m_supported = false;
+         }
+         colnames.push_back(static_cast<const RangeSetCut &>(cut).colname());
+         break;
+      case CutBase::BIT_MASK:
+         colnames.push_back(static_cast<const BitMaskCut &>(cut).colname());
+         break;
+      case CutBase::GTI:
+         colnames.push_back("TIME");
+         break;
+      case CutBase::SKYCONE:
+         colnames.push_back("RA");
+         colnames.push_back("DEC");
+         break;
+      case CutBase::VERSION:
+         break;
+      default:
+         m_supported = false;
+      }
+   }
+
+// Locate those columns within a row.  Cuts on columns that are absent
+// from the table pass all events, as with Cuts::accept.
+   RowLayout layout(m_infile, m_extension);
+   m_rowSize = layout.rowSize();
+   if (layout.hasVariableLength()) {
+// The rows are copied as raw bytes, which would not copy the heap.
+      m_supported = false;
+   }
+   for (size_t i(0); i < colnames.size(); i++) {
+      const RowLayout::Field * field(layout.field(colnames[i]));
+      unsigned int slot;
+      if (field == 0 || m_schema.slot(colnames[i], slot)) {
+         continue;
+      }
+      Column column;
+      column.slot = m_schema.addColumn(colnames[i]);
+      column.offset = field->offset;
+      column.type = field->type;
+      column.repeat = field->repeat;
+      column.scale = field->scale;
+      column.zero = field->zero;
+      if (column.type == 'X') {
+         m_supported = m_supported && column.repeat <= 32;
+      } else {
+         m_supported = (m_supported && column.repeat == 1 &&
+                        std::strchr("BIJKED", column.type) != 0);
+      }
+      m_columns.push_back(column);
+   }
+}
+
+void FilterPipeline::decode(Chunk & chunk) const {
+   for (size_t i(0); i < m_columns.size(); i++) {
+      const Column & column(m_columns[i]);
+      std::vector<double> & values(chunk.columns[column.slot]);
+      values.resize(chunk.nrows);
+      const unsigned char * bytes(&chunk.bytes[0] + column.offset);
+      for (long row(0); row < chunk.nrows; row++, bytes += m_rowSize) {
+         double value(0);
+         switch (column.type) {
+         case 'B':
+            value = bytes[0];
+            break;
+         case 'I':
+            value = static_cast<short>(bigEndian(bytes, 2));
+            break;
+         case 'J':
+            value = static_cast<int>(bigEndian(bytes, 4));
+            break;
+         case 'K':
+            value = static_cast<long long>(bigEndian(bytes, 8));
+            break;
+         case 'E': {
+            unsigned int word(bigEndian(bytes, 4));
+            float x;
+            std::memcpy(&x, &word, sizeof(x));
+            value = x;
+            break;
+         }
+         case 'D': {
+            unsigned long long word(bigEndian(bytes, 8));
+            double x;
+            std::memcpy(&x, &word, sizeof(x));
+            value = x;
+            break;
+         }
+         case 'X': {
+// The first bit is the most significant, as for ffgcxuk.
+            int nbytes((column.repeat + 7)/8);
+            value = bigEndian(bytes, nbytes) >> (8*nbytes - column.repeat);
+            break;
+         }
+         }
+         values[row] = column.scale*value + column.zero;
+      }
+   }
+}
+
+void FilterPipeline::filter(const SchemaCuts & schemaCuts,
+                            Chunk & chunk) const {
+   chunk.columns.resize(m_schema.size());
+   chunk.columnPointers.resize(m_schema.size());
+   decode(chunk);
+   for (size_t j(0); j < chunk.columns.size(); j++) {
+      chunk.columnPointers[j] = &chunk.columns[j][0];
+   }
+   schemaCuts.accept(chunk.columnPointers.empty() ? 0 :
+                     &chunk.columnPointers[0], chunk.nrows, chunk.accepted);
+// Move the accepted rows, or their projections, to the front of the
+// buffer so that they are written in one call.
+   long outRowSize(outputRowSize());
+   long naccepted(0);
+   for (long row(0); row < chunk.nrows; row++) {
+      if (!chunk.accepted[row]) {
+         continue;
+      }
+      if (m_projection) {
+         m_projection->project(&chunk.bytes[row*m_rowSize], 1,
+                               &chunk.bytes[naccepted*outRowSize]);
+      } else if (naccepted != row) {
+         std::memmove(&chunk.bytes[naccepted*m_rowSize],
+                      &chunk.bytes[row*m_rowSize], m_rowSize);
+      }
+      naccepted++;
+   }
+   chunk.naccepted = naccepted;
+}
+
+long FilterPipeline::outputRowSize() const {
+   return m_projection ? m_projection->outputRowSize() : m_rowSize;
+}
+
+tip::Index_t FilterPipeline::run(const std::vector<RowRange_t> & ranges,
+                                 const std::string & outfile) const {
+   if (!m_supported) {
+      throw std::runtime_error("FilterPipeline::run: the cuts on "
+                               + m_infile + " are not supported.");
+   }
+   SchemaCuts schemaCuts(m_cuts, m_schema);
+
+   fitsfile * infptr(0);
+   fitsfile * outfptr(0);
+   LONGLONG nout(0);
+   openTables(m_infile, outfile, m_extension, infptr, outfptr, nout);
+   LONGLONG nstart(nout);
+
+// Unless cfitsio was built to be thread-safe, the reader and writer
+// take turns calling it.
+   std::mutex fitsMutex;
+   bool serialize(!fits_is_reentrant());
+
+// Enough chunk buffers to keep every stage busy.  A chunk returns to
+// the free pool once it has been written.
+   size_t nchunks(2*m_nworkers + 2);
+   std::vector<Chunk> chunks(nchunks);
+   BoundedQueue<Chunk *> freeChunks(nchunks);
+   BoundedQueue<Chunk *> toFilter(nchunks);
+   BoundedQueue<Chunk *> toWrite(nchunks);
+   for (size_t i(0); i < nchunks; i++) {
+      freeChunks.push(&chunks[i]);
+   }
+
+// The first exception thrown by any stage stops the pipeline and is
+// rethrown once all of the threads have finished.
+   std::atomic<bool> failed(false);
+   std::exception_ptr error;
+   std::mutex errorMutex;
+   auto fail = [&]() {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error) {
+         error = std::current_exception();
+      }
+      failed = true;
+      freeChunks.close();
+      toFilter.close();
+      toWrite.close();
+   };
+
+   auto reader = [&]() {
+      try {
+         size_t sequence(0);
+         for (size_t i(0); i < ranges.size() && !failed; i++) {
+            for (tip::Index_t first(ranges[i].first);
+                 first < ranges[i].second && !failed; first += m_chunkSize) {
+               Chunk * chunk(0);
+               if (!freeChunks.pop(chunk)) {
+                  return;
+               }
+               chunk->sequence = sequence++;
+               chunk->first = first;
+               chunk->nrows = std::min(m_chunkSize, ranges[i].second - first);
+               chunk->bytes.resize(static_cast<size_t>(chunk->nrows)
+                                   *m_rowSize);
+               int readStatus(0);
+               {
+                  std::unique_lock<std::mutex> lock(fitsMutex,
+                                                    std::defer_lock);
+                  if (serialize) {
+                     lock.lock();
+                  }
+                  fits_read_tblbytes(infptr, first + 1, 1, chunk->bytes.size(),
+                                     &chunk->bytes[0], &readStatus);
+               }
+               CfitsioUtil::checkStatus(readStatus, "FilterPipeline::run");
+               if (!toFilter.push(chunk)) {
+                  return;
+               }
+            }
+         }
+         toFilter.close();
+      } catch (...) {
+         fail();
+      }
+   };
+
+   std::atomic<unsigned int> activeWorkers(m_nworkers);
+   auto worker = [&]() {
+      try {
+         Chunk * chunk(0);
+         while (!failed && toFilter.pop(chunk)) {
+            filter(schemaCuts, *chunk);
+            if (!toWrite.push(chunk)) {
+               break;
+            }
+         }
+      } catch (...) {
+         fail();
+      }
+      if (--activeWorkers == 0) {
+         toWrite.close();
+      }
+   };
+
+// The workers may finish chunks out of order, so chunks are held
+// until their predecessors have been written.
+   auto writer = [&]() {
+      try {
+         std::map<size_t, Chunk *> pending;
+         size_t next(0);
+         Chunk * chunk(0);
+         while (!failed && toWrite.pop(chunk)) {
+            pending[chunk->sequence] = chunk;
+            std::map<size_t, Chunk *>::iterator it;
+            while (!failed && (it = pending.find(next)) != pending.end()) {
+               chunk = it->second;
+               pending.erase(it);
+               next++;
+               if (chunk->naccepted > 0) {
+                  int writeStatus(0);
+                  std::unique_lock<std::mutex> lock(fitsMutex,
+                                                    std::defer_lock);
+                  if (serialize) {
+                     lock.lock();
+                  }
+                  fits_insert_rows(outfptr, nout, chunk->naccepted,
+                                   &writeStatus);
+                  fits_write_tblbytes(outfptr, nout + 1, 1,
+                                      static_cast<LONGLONG>(chunk->naccepted)
+                                      *outputRowSize(), &chunk->bytes[0],
+                                      &writeStatus);
+                  if (lock.owns_lock()) {
+                     lock.unlock();
+                  }
+                  CfitsioUtil::checkStatus(writeStatus, "FilterPipeline::run");
+                  nout += chunk->naccepted;
+               }
+               freeChunks.push(chunk);
+            }
+         }
+      } catch (...) {
+         fail();
+      }
+   };
+
+   std::vector<std::thread> threads;
+   threads.push_back(std::thread(reader));
+   for (unsigned int i(0); i < m_nworkers; i++) {
+      threads.push_back(std::thread(worker));
+   }
+   threads.push_back(std::thread(writer));
+   for (size_t i(0); i < threads.size(); i++) {
+      threads[i].join();
+   }
+
+   int closeStatus(0);
+   fits_close_file(outfptr, &closeStatus);
+   fits_close_file(infptr, &closeStatus);
+   if (error) {
+      std::rethrow_exception(error);
+   }
+   CfitsioUtil::checkStatus(closeStatus, "FilterPipeline::run");
+   return nout - nstart;
+}
+
+tip::Index_t FilterPipeline::runChunked(const std::vector<RowRange_t> & ranges,
+                                        const std::string & outfile) const {
+   if (!m_supported) {
+      throw std::runtime_error("FilterPipeline::runChunked: the cuts on "
+                               + m_infile + " are not supported.");
+   }
+   SchemaCuts schemaCuts(m_cuts, m_schema);
+
+// Split the row ranges into chunks.
+   std::vector<RowRange_t> chunkRows;
+   for (size_t i(0); i < ranges.size(); i++) {
+      for (tip::Index_t first(ranges[i].first); first < ranges[i].second;
+           first += m_chunkSize) {
+         chunkRows.push_back(RowRange_t(first, std::min(first + m_chunkSize,
+                                                        ranges[i].second)));
+      }
+   }
+
+   fitsfile * infptr(0);
+   fitsfile * outfptr(0);
+   LONGLONG nout(0);
+   openTables(m_infile, outfile, m_extension, infptr, outfptr, nout);
+   LONGLONG nstart(nout);
+
+// The file handles are shared by the threads, so the calls to cfitsio
+// are serialized.
+   std::mutex fitsMutex;
+
+// Filter a batch of chunks at a time, so that at most one batch of
+// rows is held in memory.  Once a batch is filtered, the prefix sums
+// of the accepted counts give each chunk's offset in the output
+// table, and the chunks are written there in whatever order the
+// threads reach them.
+   ChunkScheduler scheduler(m_nworkers);
+   size_t batchSize(4*m_nworkers);
+   std::vector<Chunk> batch(batchSize);
+   std::vector<size_t> counts;
+   std::vector<size_t> offsets;
+   try {
+      for (size_t start(0); start < chunkRows.size(); start += batchSize) {
+         size_t nchunks(std::min(batchSize, chunkRows.size() - start));
+         scheduler.run(nchunks, [&](size_t k, unsigned int) {
+               Chunk & chunk(batch[k]);
+               chunk.sequence = start + k;
+               chunk.first = chunkRows[start + k].first;
+               chunk.nrows = chunkRows[start + k].second - chunk.first;
+               chunk.bytes.resize(static_cast<size_t>(chunk.nrows)*m_rowSize);
+               int readStatus(0);
+               {
+                  std::lock_guard<std::mutex> lock(fitsMutex);
+                  fits_read_tblbytes(infptr, chunk.first + 1, 1,
+                                     chunk.bytes.size(), &chunk.bytes[0],
+                                     &readStatus);
+               }
+               CfitsioUtil::checkStatus(readStatus,
+                                        "FilterPipeline::runChunked");
+               filter(schemaCuts, chunk);
+            });
+
+         counts.resize(nchunks);
+         for (size_t k(0); k < nchunks; k++) {
+            counts[k] = batch[k].naccepted;
+         }
+         ChunkScheduler::prefixSums(counts, offsets);
+         if (offsets.back() == 0) {
+            continue;
+         }
+         int status(0);
+         fits_insert_rows(outfptr, nout, offsets.back(), &status);
+         CfitsioUtil::checkStatus(status, "FilterPipeline::runChunked");
+
+         scheduler.run(nchunks, [&](size_t k, unsigned int) {
+               const Chunk & chunk(batch[k]);
+               if (chunk.naccepted == 0) {
+                  return;
+               }
+               int writeStatus(0);
+               {
+                  std::lock_guard<std::mutex> lock(fitsMutex);
+                  fits_write_tblbytes(outfptr, nout + offsets[k] + 1, 1,
+                                      static_cast<LONGLONG>(chunk.naccepted)
+                                      *outputRowSize(),
+                                      const_cast<unsigned char *>
+                                      (&chunk.bytes[0]), &writeStatus);
+               }
+               CfitsioUtil::checkStatus(writeStatus,
+                                        "FilterPipeline::runChunked");
+            });
+         nout += offsets.back();
+      }
+   } catch (...) {
+      int closeStatus(0);
+      fits_close_file(outfptr, &closeStatus);
+      fits_close_file(infptr, &closeStatus);
+      throw;
+   }
+
+   int closeStatus(0);
+   fits_close_file(outfptr, &closeStatus);
+   fits_close_file(infptr, &closeStatus);
+   CfitsioUtil::checkStatus(closeStatus, "FilterPipeline::runChunked");
+   return nout - nstart;
+}
+
+} // namespace dataSubselector
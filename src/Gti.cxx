@@ -9,25 +9,18 @@
 
 #include <algorithm>
 #include <map>
-#include <memory>
+#include <vector>
 
 #include "fitsio.h"
 
-#include "st_facilities/Util.h"
-
-#include "tip/IFileSvc.h"
+#include "tip/IColumn.h"
 #include "tip/Table.h"
 
 #include "dataSubselector/Gti.h"
 
+#include "CfitsioUtil.h"
+
 namespace {
-   void fitsReportError(int status) {
-      fits_report_error(stderr, status);
-      if (status != 0) {
-         throw std::string("dataSubselector::Gti::writeExtension: " +
-                           std::string("cfitsio error."));
-      }
-   }
    bool gti_comp(const std::pair<double, double> & a, 
                  const std::pair<double, double> & b) {
       return a.first < b.first;
@@ -38,14 +31,19 @@ namespace dataSubselector {
 
 Gti::Gti(const tip::Table & gtiTable) 
    : evtbin::Gti() {
-   tip::Table::ConstIterator it = gtiTable.begin();
-   tip::ConstTableRecord & interval = *it;
-   for ( ; it != gtiTable.end(); ++it) {
-      double start, stop;
-      interval["START"].get(start);
-      interval["STOP"].get(stop);
-      insertInterval(start, stop);
+// Read the START and STOP columns in their entirety, resolving the
+// column indices only once.
+   const tip::IColumn * startCol 
+      = gtiTable.getColumn(gtiTable.getFieldIndex("START"));
+   const tip::IColumn * stopCol
+      = gtiTable.getColumn(gtiTable.getFieldIndex("STOP"));
+   tip::Index_t nrows(gtiTable.getNumRecords());
+   std::vector<std::pair<double, double> > intervals(nrows);
+   for (tip::Index_t i(0); i < nrows; i++) {
+      startCol->get(i, intervals[i].first);
+      stopCol->get(i, intervals[i].second);
    }
+   insertIntervals(intervals);
 }
 
 Gti::Gti(const evtbin::Gti & gti)  
@@ -70,57 +68,90 @@ bool Gti::accept2(double time) const {
 }
 
 void Gti::writeExtension(const std::string & filename) const {
-   try {
+   int status(0);
+   fitsfile * fptr;
+   fits_open_file(&fptr, filename.c_str(), READWRITE, &status);
+   CfitsioUtil::checkStatus(status, "Gti::writeExtension");
+
 // Check if the extension exists already. If not, add it.
-      std::unique_ptr<const tip::Table> 
-         gtiTable(tip::IFileSvc::instance().editTable(filename, "GTI"));
-   } catch (tip::TipException & eObj) {
-      if (!st_facilities::Util::
-          expectedException(eObj, "Could not open FITS extension")) {
-         throw;
-      }
-      int status(0);
-      fitsfile * fptr;
-      fits_open_file(&fptr, filename.c_str(), READWRITE, &status);
-      ::fitsReportError(status);
-      
+   char extname[] = "GTI";
+   fits_movnam_hdu(fptr, BINARY_TBL, extname, 0, &status);
+   if (status == BAD_HDU_NUM) {
+      status = 0;
       char * ttype[] = {const_cast<char *>("START"),
                         const_cast<char *>("STOP")};
       char * tform[] = {const_cast<char *>("D"), const_cast<char *>("D")};
       char * tunit[] = {const_cast<char *>("s"), const_cast<char *>("s")};
       fits_create_tbl(fptr, BINARY_TBL, 0, 2, ttype, tform, tunit,
-                      "GTI", &status);
-      ::fitsReportError(status);
-         
-      fits_close_file(fptr, &status);
-      ::fitsReportError(status);
+                      extname, &status);
+   }
+   CfitsioUtil::checkStatus(status, "Gti::writeExtension", fptr);
+
+// Erase any existing intervals.
+   long nrows(0);
+   fits_get_num_rows(fptr, &nrows, &status);
+   if (nrows > 0) {
+      fits_delete_rows(fptr, 1, nrows, &status);
    }
-   std::unique_ptr<tip::Table> 
-      gtiTable(tip::IFileSvc::instance().editTable(filename, "GTI"));
-
-// Assume that setting the number of records to zero erases the existing
-// data.
-   gtiTable->setNumRecords(0);
-
-   gtiTable->setNumRecords(getNumIntervals());
-   tip::Table::Iterator it = gtiTable->begin();
-   tip::Table::Record & row = *it;
-   Gti::ConstIterator interval = begin();
-   double tstart, tstop;
-   tstart = interval->first;
-   tstop = interval->second;
-   for ( ; it != gtiTable->end(); ++it, ++interval) {
-      row["START"].set(interval->first);
-      row["STOP"].set(interval->second);
-      if (interval->first < tstart) {
-         tstart = interval->first;
+   CfitsioUtil::checkStatus(status, "Gti::writeExtension", fptr);
+
+// Write the START and STOP columns each as a single block.
+   long nintervals(getNumIntervals());
+   if (nintervals > 0) {
+      std::vector<double> start;
+      std::vector<double> stop;
+      start.reserve(nintervals);
+      stop.reserve(nintervals);
+      for (ConstIterator interval = begin(); interval != end(); ++interval) {
+         start.push_back(interval->first);
+         stop.push_back(interval->second);
       }
-      if (interval->second > tstop) {
-         tstop = interval->second;
+      int startcol, stopcol;
+      fits_get_colnum(fptr, CASEINSEN, const_cast<char *>("START"),
+                      &startcol, &status);
+      fits_get_colnum(fptr, CASEINSEN, const_cast<char *>("STOP"),
+                      &stopcol, &status);
+      fits_write_col(fptr, TDOUBLE, startcol, 1, 1, nintervals, 
+                     &start[0], &status);
+      fits_write_col(fptr, TDOUBLE, stopcol, 1, 1, nintervals, 
+                     &stop[0], &status);
+      CfitsioUtil::checkStatus(status, "Gti::writeExtension", fptr);
+   }
+
+   double ontime(computeOntime());
+   fits_update_key(fptr, TDOUBLE, "ONTIME", &ontime, 0, &status);
+   CfitsioUtil::checkStatus(status, "Gti::writeExtension", fptr);
+
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "Gti::writeExtension");
+}
+
+void Gti::insertIntervals(std::vector<std::pair<double, double> > & intervals) {
+// GTI extensions are almost always written in time order with
+// disjoint intervals, in which case they can be appended directly.
+   bool ordered(true);
+   for (size_t i(1); i < intervals.size() && ordered; i++) {
+      ordered = !(intervals[i].first < intervals[i-1].second);
+   }
+   if (!ordered) {
+// Sort on start times and merge any overlapping intervals.
+      std::stable_sort(intervals.begin(), intervals.end(), ::gti_comp);
+      size_t nmerged(0);
+      for (size_t i(1); i < intervals.size(); i++) {
+         std::pair<double, double> & current(intervals[nmerged]);
+         if (intervals[i].first < current.second) {
+            current.second = std::max(current.second, intervals[i].second);
+         } else {
+            intervals[++nmerged] = intervals[i];
+         }
       }
+      intervals.resize(nmerged + 1);
+   }
+// Each interval now lies after all of those already inserted, so
+// evtbin::Gti never has to resolve overlaps.
+   for (size_t i(0); i < intervals.size(); i++) {
+      insertInterval(intervals[i].first, intervals[i].second);
    }
-   tip::Header & header = gtiTable->getHeader();
-   header["ONTIME"].set(computeOntime());
 }
 
 Gti Gti::applyTimeRangeCut(double start, double stop) const {
@@ -43,11 +43,6 @@ void GtiCut::getKeyValues(std::string & type, std::string & unit,
    ref = ":GTI";
 }
 
-bool GtiCut::accept(double time) const {
-//   return m_gti.accept(time);
-   return m_gti.accept2(time);
-}
-
 void GtiCut::writeCut(std::ostream & stream, unsigned int keynum) const {
    CutBase::writeCut(stream, keynum);
    evtbin::Gti::ConstIterator dt;
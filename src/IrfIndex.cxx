@@ -0,0 +1,173 @@
+/**
+ * @file IrfIndex.cxx
+ * @brief Cached contents of the BITMASK_MAPPING extension of the
+ * CALDB irf_index.fits file.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "facilities/commonUtilities.h"
+
+#include "st_facilities/Environment.h"
+
+#include "tip/IFileSvc.h"
+#include "tip/Table.h"
+
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/IrfIndex.h"
+
+namespace {
+   std::string irfIndexPath(const std::string & caldb) {
+      const char * subdirs[] = {"data", "glast", "lat", "bcf"};
+      std::string path(caldb);
+      for (size_t i(0); i < 4; i++) {
+         path = facilities::commonUtilities::joinPath(path, subdirs[i]);
+      }
+      return facilities::commonUtilities::joinPath(path, "irf_index.fits");
+   }
+
+   bool newest_first(const dataSubselector::IrfIndex::IrfVersion_t & a,
+                     const dataSubselector::IrfIndex::IrfVersion_t & b) {
+      return a.first > b.first || (a.first == b.first && a.second < b.second);
+   }
+
+   std::time_t modificationTime(const std::string & filename) {
+      struct stat info;
+      if (stat(filename.c_str(), &info) != 0) {
+         return 0;
+      }
+      return info.st_mtime;
+   }
+}
+
+namespace dataSubselector {
+
+IrfIndex::IrfIndex(const std::string & irf_index_file) 
+   : m_filename(irf_index_file) {
+   std::unique_ptr<const tip::Table> 
+      irf_map(tip::IFileSvc::instance().readTable(irf_index_file,
+                                                  "BITMASK_MAPPING"));
+   m_masks.reserve(irf_map->getNumRecords());
+   tip::Table::ConstIterator it(irf_map->begin());
+   tip::ConstTableRecord & row = *it;
+   for ( ; it != irf_map->end(); ++it) {
+      std::string event_class;
+      int bitpos;
+      row["event_class"].get(event_class);
+      row["bitposition"].get(bitpos);
+      m_masks[event_class] = 1 << bitpos;
+   }
+   for (MaskMap_t::const_iterator entry(m_masks.begin());
+        entry != m_masks.end(); ++entry) {
+      m_irfs[entry->second].push_back(entry->first);
+   }
+// Keep the candidates for each mask in name order so that searches
+// over them are deterministic.
+   std::unordered_map<unsigned int, std::vector<std::string> >::iterator
+      candidates;
+   for (candidates = m_irfs.begin(); candidates != m_irfs.end(); ++candidates) {
+      std::sort(candidates->second.begin(), candidates->second.end());
+   }
+// Index the IRF versions by bit mask and PASS_VER.
+   for (MaskMap_t::const_iterator entry(m_masks.begin());
+        entry != m_masks.end(); ++entry) {
+      std::string pass_ver;
+      std::string irf_ver;
+      Cuts::extract_irf_versions(entry->first, pass_ver, irf_ver);
+      unsigned int irf_ver_num(std::atoi(irf_ver.substr(1).c_str()));
+      m_versions[entry->second][pass_ver]
+         .push_back(std::make_pair(irf_ver_num, entry->first));
+   }
+   std::unordered_map<unsigned int, 
+                      std::unordered_map<std::string, IrfVersions_t> >
+      ::iterator mask_versions;
+   for (mask_versions = m_versions.begin(); mask_versions != m_versions.end();
+        ++mask_versions) {
+      std::unordered_map<std::string, IrfVersions_t>::iterator pass_versions;
+      for (pass_versions = mask_versions->second.begin();
+           pass_versions != mask_versions->second.end(); ++pass_versions) {
+         std::sort(pass_versions->second.begin(), pass_versions->second.end(),
+                   ::newest_first);
+      }
+   }
+}
+
+IrfIndex::IrfIndexPtr IrfIndex::instance() {
+   return instance(st_facilities::Environment::getEnv("CALDB"));
+}
+
+IrfIndex::IrfIndexPtr IrfIndex::instance(const std::string & caldb) {
+   typedef std::pair<std::time_t, IrfIndexPtr> Entry_t;
+   static std::mutex cache_mutex;
+   static std::map<std::string, Entry_t> cache;
+
+   std::string filename(::irfIndexPath(caldb));
+   std::time_t mtime(::modificationTime(filename));
+
+   std::lock_guard<std::mutex> lock(cache_mutex);
+   std::map<std::string, Entry_t>::const_iterator it(cache.find(caldb));
+   if (it != cache.end() && it->second.first == mtime) {
+      return it->second.second;
+   }
+   IrfIndexPtr index(new IrfIndex(filename));
+   cache[caldb] = std::make_pair(mtime, index);
+   return index;
+}
+
+bool IrfIndex::mask(const std::string & event_class,
+                    unsigned int & mask) const {
+   MaskMap_t::const_iterator it(m_masks.find(event_class));
+   if (it == m_masks.end()) {
+      return false;
+   }
+   mask = it->second;
+   return true;
+}
+
+const std::vector<std::string> & IrfIndex::irfs(unsigned int mask) const {
+   static const std::vector<std::string> none;
+   std::unordered_map<unsigned int, std::vector<std::string> >::const_iterator
+      it(m_irfs.find(mask));
+   if (it == m_irfs.end()) {
+      return none;
+   }
+   return it->second;
+}
+
+const IrfIndex::IrfVersions_t & 
+IrfIndex::versions(const std::string & pass_ver, unsigned int mask) const {
+   static const IrfVersions_t none;
+   std::unordered_map<unsigned int, 
+                      std::unordered_map<std::string, IrfVersions_t> >
+      ::const_iterator mask_versions(m_versions.find(mask));
+   if (mask_versions == m_versions.end()) {
+      return none;
+   }
+   std::unordered_map<std::string, IrfVersions_t>::const_iterator
+      pass_versions(mask_versions->second.find(pass_ver));
+   if (pass_versions == mask_versions->second.end()) {
+      return none;
+   }
+   return pass_versions->second;
+}
+
+std::string IrfIndex::latest(const std::string & pass_ver,
+                             unsigned int mask) const {
+   const IrfVersions_t & irfs(versions(pass_ver, mask));
+   if (irfs.empty()) {
+      return "";
+   }
+   return irfs.front().second;
+}
+
+} // namespace dataSubselector
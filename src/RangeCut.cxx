@@ -13,6 +13,7 @@
 
 #include "facilities/Util.h"
 
+#include "tip/IColumn.h"
 #include "tip/Table.h"
 
 #include "dataSubselector/RangeCut.h"
@@ -22,7 +23,7 @@ namespace dataSubselector {
 RangeCut::RangeCut(const std::string & colname, const std::string & unit,
                    double minVal, double maxVal, IntervalType type,
                    unsigned int indx)
-   : CutBase("range"), m_colname(colname), m_unit(unit),
+   : CutBase(RANGE), m_colname(colname), m_unit(unit),
      m_min(minVal), m_max(maxVal), m_intervalType(type), m_index(indx),
      m_fullName(colname) {
    setFullName();
@@ -32,7 +33,7 @@ RangeCut::RangeCut(const std::string & type,
                    const std::string & unit, 
                    const std::string & value,
                    unsigned int indx) 
-   : CutBase("range"), m_colname(type), m_unit(unit), m_index(indx),
+   : CutBase(RANGE), m_colname(type), m_unit(unit), m_index(indx),
      m_fullName(type) {
    std::vector<std::string> tokens;
    facilities::Util::stringTokenize(value, ":", tokens);
@@ -86,10 +87,10 @@ bool RangeCut::equals(const CutBase & arg) const {
 }
 
 bool RangeCut::supercedes(const CutBase & cut) const {
-   if (cut.type() != "range") {
+   if (cut.kind() != RANGE) {
       return false;
    }
-   RangeCut & rangeCut = dynamic_cast<RangeCut &>(const_cast<CutBase &>(cut));
+   const RangeCut & rangeCut = static_cast<const RangeCut &>(cut);
 /// @todo Need to handle open ranges.
    if (rangeCut.colname() != colname() || 
        rangeCut.m_intervalType != m_intervalType) {
@@ -139,21 +140,11 @@ void RangeCut::getKeyValues(std::string & type, std::string & unit,
    value = val.str();
 }
 
-bool RangeCut::accept(double value) const {
-   if (m_intervalType == MINONLY) {
-      return m_min < value;
-   } else if (m_intervalType == MAXONLY) {
-      return value <= m_max;
-   } else if (m_min == m_max) {
-      // Fully closed interval to support selecting on a specific value.
-      return m_min <= value && value <= m_max;
-   }
-   return m_min < value && value <= m_max;
-}
-
 double RangeCut::extractValue(tip::ConstTableRecord & row) const {
    if (m_index) {
-      std::vector<double> tableVector;
+// Reuse the buffer from row to row rather than allocating a new
+// vector for each one.
+      static thread_local std::vector<double> tableVector;
       row[m_colname].get(tableVector);
       return tableVector.at(m_index-1);
    }
@@ -162,6 +153,20 @@ double RangeCut::extractValue(tip::ConstTableRecord & row) const {
    return value;
 }
 
+RangeCut::Bound::Bound(const RangeCut & cut, const tip::Table & table) 
+   : m_cut(&cut), 
+     m_column(table.getColumn(table.getFieldIndex(cut.m_colname))) {}
+
+double RangeCut::Bound::value(tip::Index_t record) const {
+   if (m_cut->m_index) {
+      m_column->get(record, m_buffer);
+      return m_buffer.at(m_cut->m_index - 1);
+   }
+   double value;
+   m_column->get(record, value);
+   return value;
+}
+
 void RangeCut::setFullName() {
    if (m_index) {
       std::ostringstream name;
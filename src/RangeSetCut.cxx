@@ -0,0 +1,244 @@
+/**
+ * @file RangeSetCut.cxx
+ * @brief Cut on a column value lying in any of a set of ranges.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdlib>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "facilities/Util.h"
+
+#include "tip/Table.h"
+
+#include "dataSubselector/RangeSetCut.h"
+
+namespace {
+   typedef dataSubselector::RangeSetCut::Interval_t Interval_t;
+
+   bool isPoint(const Interval_t & interval) {
+      return interval.first == interval.second;
+   }
+
+   /// True if every value accepted by inner is accepted by outer.
+   bool covers(const Interval_t & outer, const Interval_t & inner) {
+      if (isPoint(inner)) {
+         return dataSubselector::RangeSetCut::contains(outer, inner.first);
+      }
+      if (isPoint(outer)) {
+         return false;
+      }
+      return outer.first <= inner.first && inner.second <= outer.second;
+   }
+
+   bool upperBelow(const Interval_t & interval, double value) {
+      return interval.second < value;
+   }
+}
+
+namespace dataSubselector {
+
+RangeSetCut::RangeSetCut(const std::string & colname,
+                         const std::string & unit,
+                         const std::vector<Interval_t> & intervals,
+                         unsigned int indx)
+   : CutBase(RANGE_SET), m_colname(colname), m_unit(unit), m_index(indx),
+     m_fullName(colname) {
+   if (m_index) {
+      std::ostringstream name;
+      name << m_colname << "[" << m_index << "]";
+      m_fullName = name.str();
+   }
+   setIntervals(intervals);
+}
+
+RangeSetCut::RangeSetCut(const std::string & colname,
+                         const std::string & unit,
+                         const std::string & value,
+                         unsigned int indx)
+   : CutBase(RANGE_SET), m_colname(colname), m_unit(unit), m_index(indx),
+     m_fullName(colname) {
+   if (m_index) {
+      std::ostringstream name;
+      name << m_colname << "[" << m_index << "]";
+      m_fullName = name.str();
+   }
+   const double inf(std::numeric_limits<double>::infinity());
+   std::vector<std::string> ranges;
+   facilities::Util::stringTokenize(value, ",", ranges);
+   std::vector<Interval_t> intervals;
+   for (size_t i = 0; i < ranges.size(); i++) {
+      const std::string & range(ranges[i]);
+      std::string::size_type colon(range.find(":"));
+      if (colon == std::string::npos) {
+         throw std::runtime_error("RangeSetCut: invalid range, " + range);
+      }
+      std::string min_str(range.substr(0, colon));
+      std::string max_str(range.substr(colon + 1));
+      double minVal = (min_str == "" ? -inf : std::atof(min_str.c_str()));
+      double maxVal = (max_str == "" ? inf : std::atof(max_str.c_str()));
+      intervals.push_back(Interval_t(minVal, maxVal));
+   }
+   setIntervals(intervals);
+}
+
+void RangeSetCut::setIntervals(std::vector<Interval_t> intervals) {
+   if (intervals.empty()) {
+      throw std::runtime_error("RangeSetCut: no ranges given for "
+                               + m_fullName);
+   }
+   for (size_t i = 0; i < intervals.size(); i++) {
+      if (intervals[i].first > intervals[i].second) {
+         throw std::runtime_error("RangeSetCut: invalid range for "
+                                  + m_fullName);
+      }
+   }
+   std::sort(intervals.begin(), intervals.end());
+   m_intervals.clear();
+   m_intervals.push_back(intervals.front());
+   for (size_t i = 1; i < intervals.size(); i++) {
+      Interval_t & last(m_intervals.back());
+      const Interval_t & next(intervals[i]);
+// Merge overlapping or abutting ranges.  A single-value range only
+// abuts a following (min, max] range if it lies inside of it.
+      if (next.first < last.second ||
+          (next.first == last.second && (!isPoint(last) || isPoint(next)))) {
+         last.second = std::max(last.second, next.second);
+      } else {
+         m_intervals.push_back(next);
+      }
+   }
+}
+
+bool RangeSetCut::accept(tip::ConstTableRecord & row) const {
+   return accept(extractValue(row));
+}
+
+bool RangeSetCut::accept(const std::map<std::string, double> & params) const {
+   std::map<std::string, double>::const_iterator it;
+   if ( (it = params.find(m_fullName)) != params.end()) {
+      return accept(it->second);
+   }
+   return true;
+}
+
+bool RangeSetCut::accept(double value) const {
+// The upper bounds are increasing, so the only candidate is the
+// first range whose upper bound is not below the value.
+   std::vector<Interval_t>::const_iterator it
+      = std::lower_bound(m_intervals.begin(), m_intervals.end(), value,
+                         upperBelow);
+   return it != m_intervals.end() && contains(*it, value);
+}
+
+bool RangeSetCut::supercedes(const CutBase & cut) const {
+   if (cut.kind() != RANGE_SET) {
+      return false;
+   }
+   const RangeSetCut & other = static_cast<const RangeSetCut &>(cut);
+   if (other.colname() != colname()) {
+      return false;
+   }
+   for (size_t i = 0; i < m_intervals.size(); i++) {
+      bool covered(false);
+      for (size_t j = 0; j < other.m_intervals.size() && !covered; j++) {
+         covered = covers(other.m_intervals[j], m_intervals[i]);
+      }
+      if (!covered) {
+         return false;
+      }
+   }
+   return true;
+}
+
+bool RangeSetCut::equals(const CutBase & arg) const {
+   const RangeSetCut & rhs = static_cast<const RangeSetCut &>(arg);
+   return (m_fullName == rhs.m_fullName && m_unit == rhs.m_unit &&
+           m_intervals == rhs.m_intervals);
+}
+
+std::string RangeSetCut::filterString() const {
+   const double inf(std::numeric_limits<double>::infinity());
+   for (size_t i = 0; i < m_intervals.size(); i++) {
+      if (m_intervals[i].first == -inf && m_intervals[i].second == inf) {
+// Every value is accepted, and cfitsio cannot parse "inf".
+         return "";
+      }
+   }
+   std::ostringstream filter;
+   filter << std::setprecision(20);
+   bool multiple(m_intervals.size() > 1);
+   if (multiple) {
+      filter << "(";
+   }
+   for (size_t i = 0; i < m_intervals.size(); i++) {
+      const Interval_t & interval(m_intervals[i]);
+      if (i > 0) {
+         filter << " || ";
+      }
+      if (multiple) {
+         filter << "(";
+      }
+      if (isPoint(interval)) {
+         filter << interval.first << " <= " << m_fullName << " && "
+                << m_fullName << " <= " << interval.second;
+      } else if (interval.first == -std::numeric_limits<double>::infinity()) {
+         filter << m_fullName << " <= " << interval.second;
+      } else if (interval.second == std::numeric_limits<double>::infinity()) {
+         filter << interval.first << " < " << m_fullName;
+      } else {
+         filter << interval.first << " < " << m_fullName << " && "
+                << m_fullName << " <= " << interval.second;
+      }
+      if (multiple) {
+         filter << ")";
+      }
+   }
+   if (multiple) {
+      filter << ")";
+   }
+   return filter.str();
+}
+
+void RangeSetCut::getKeyValues(std::string & type, std::string & unit,
+                               std::string & value, std::string & ref) const {
+   (void)(ref);
+   const double inf(std::numeric_limits<double>::infinity());
+   std::ostringstream val;
+   val.precision(17);
+   for (size_t i = 0; i < m_intervals.size(); i++) {
+      if (i > 0) {
+         val << ",";
+      }
+      if (m_intervals[i].first != -inf) {
+         val << m_intervals[i].first;
+      }
+      val << ":";
+      if (m_intervals[i].second != inf) {
+         val << m_intervals[i].second;
+      }
+   }
+   type = m_fullName;
+   unit = m_unit;
+   value = val.str();
+}
+
+double RangeSetCut::extractValue(tip::ConstTableRecord & row) const {
+   if (m_index) {
+      static thread_local std::vector<double> tableVector;
+      row[m_colname].get(tableVector);
+      return tableVector.at(m_index-1);
+   }
+   double value;
+   row[m_colname].get(value);
+   return value;
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,146 @@
+/**
+ * @file RowLayout.cxx
+ * @brief The byte layout of the rows of a FITS binary table.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sstream>
+#include <stdexcept>
+
+#include "fitsio.h"
+
+#include "dataSubselector/RowLayout.h"
+
+#include "CfitsioUtil.h"
+
+namespace {
+   std::string toUpper(const std::string & name) {
+      std::string result(name);
+      for (size_t i(0); i < result.size(); i++) {
+         result[i] = std::toupper(result[i]);
+      }
+      return result;
+   }
+
+   /// @return The number of bytes occupied by a column with the
+   ///         given TFORM value, and set its type and repeat count.
+   long columnWidth(const std::string & tform, char & type, long & repeat) {
+      size_t pos(0);
+      while (pos < tform.size() && std::isdigit(tform[pos])) {
+         pos++;
+      }
+      repeat = pos > 0 ? std::atol(tform.substr(0, pos).c_str()) : 1;
+      if (pos == tform.size()) {
+         throw std::runtime_error("RowLayout: invalid TFORM value, " + tform);
+      }
+      type = std::toupper(tform[pos]);
+      switch (type) {
+      case 'L': case 'B': case 'A':
+         return repeat;
+      case 'X':
+         return (repeat + 7)/8;
+      case 'I':
+         return 2*repeat;
+      case 'J': case 'E':
+         return 4*repeat;
+      case 'K': case 'D': case 'C': case 'P':
+         return 8*repeat;
+      case 'M': case 'Q':
+         return 16*repeat;
+      default:
+         throw std::runtime_error("RowLayout: invalid TFORM value, " + tform);
+      }
+   }
+}
+
+namespace dataSubselector {
+
+RowLayout::RowLayout(const std::string & fitsFile,
+                     const std::string & extension) : m_rowSize(0) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, fitsFile.c_str(), READONLY, &status);
+   CfitsioUtil::checkStatus(status, "RowLayout");
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+// The original layout of a tile-compressed table is given by its
+// ZNAXIS1 and ZFORMn keywords.
+   int ztable(0);
+   fits_read_key(fptr, TLOGICAL, "ZTABLE", &ztable, 0, &status);
+   if (status == KEY_NO_EXIST) {
+      status = 0;
+      ztable = 0;
+   }
+   std::string prefix(ztable ? "Z" : "T");
+   int ncols(0);
+   fits_read_key(fptr, TLONG, ztable ? "ZNAXIS1" : "NAXIS1", &m_rowSize,
+                 0, &status);
+   fits_read_key(fptr, TINT, "TFIELDS", &ncols, 0, &status);
+   CfitsioUtil::checkStatus(status, "RowLayout", fptr);
+   long offset(0);
+   for (int col(1); col <= ncols; col++) {
+      std::ostringstream ttypeKey, tformKey, tscalKey, tzeroKey;
+      ttypeKey << "TTYPE" << col;
+      tformKey << prefix << "FORM" << col;
+      tscalKey << "TSCAL" << col;
+      tzeroKey << "TZERO" << col;
+      char ttype[FLEN_VALUE];
+      char tform[FLEN_VALUE];
+      fits_read_key(fptr, TSTRING, ttypeKey.str().c_str(), ttype, 0, &status);
+      fits_read_key(fptr, TSTRING, tformKey.str().c_str(), tform, 0, &status);
+      CfitsioUtil::checkStatus(status, "RowLayout", fptr);
+      Field field;
+      field.name = ttype;
+      field.offset = offset;
+      field.width = columnWidth(tform, field.type, field.repeat);
+      field.scale = 1;
+      field.zero = 0;
+      fits_read_key(fptr, TDOUBLE, tscalKey.str().c_str(), &field.scale,
+                    0, &status);
+      if (status == KEY_NO_EXIST) {
+         status = 0;
+      }
+      fits_read_key(fptr, TDOUBLE, tzeroKey.str().c_str(), &field.zero,
+                    0, &status);
+      if (status == KEY_NO_EXIST) {
+         status = 0;
+      }
+      CfitsioUtil::checkStatus(status, "RowLayout", fptr);
+      m_fields.push_back(field);
+      offset += field.width;
+   }
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "RowLayout");
+   if (offset != m_rowSize) {
+      throw std::runtime_error("RowLayout: the column widths of "
+                               + fitsFile + "[" + extension + "] do not "
+                               + "add up to the row size.");
+   }
+}
+
+const RowLayout::Field * RowLayout::field(const std::string & name) const {
+   std::string target(toUpper(name));
+   for (size_t i(0); i < m_fields.size(); i++) {
+      if (toUpper(m_fields[i].name) == target) {
+         return &m_fields[i];
+      }
+   }
+   return 0;
+}
+
+bool RowLayout::hasVariableLength() const {
+   for (size_t i(0); i < m_fields.size(); i++) {
+      if (m_fields[i].type == 'P' || m_fields[i].type == 'Q') {
+         return true;
+      }
+   }
+   return false;
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,239 @@
+/**
+ * @file RowSelection.cxx
+ * @brief The rows of an event table that pass a set of cuts, stored
+ * as ranges of row numbers rather than as a copy of the rows.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdio>
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#include "fitsio.h"
+
+#include "tip/Header.h"
+#include "tip/IFileSvc.h"
+#include "tip/Table.h"
+
+#include "dataSubselector/CompressedTable.h"
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/Gti.h"
+#include "dataSubselector/RowSelection.h"
+
+#include "CfitsioUtil.h"
+
+namespace {
+   bool rangeLess(const dataSubselector::RowSelection::RowRange_t & range,
+                  tip::Index_t row) {
+      return range.second <= row;
+   }
+}
+
+namespace dataSubselector {
+
+RowSelection::RowSelection(const tip::Table & events)
+   : m_nrows(events.getNumRecords()), m_datasum(CfitsioUtil::datasum(events)),
+     m_numSelected(0) {}
+
+RowSelection::RowSelection(const CompressedTable & events)
+   : m_nrows(events.getNumRecords()), m_datasum(events.datasum()),
+     m_numSelected(0) {}
+
+RowSelection::RowSelection(const std::string & selectionFile)
+   : m_nrows(0), m_numSelected(0) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, selectionFile.c_str(), READONLY, &status);
+   CfitsioUtil::checkStatus(status, "RowSelection");
+   char extname[] = "SELECTION";
+   fits_movnam_hdu(fptr, BINARY_TBL, extname, 0, &status);
+   LONGLONG nrows;
+   fits_read_key(fptr, TLONGLONG, "SRCROWS", &nrows, 0, &status);
+   char value[81];
+   fits_read_key(fptr, TSTRING, "SRCSUM", value, 0, &status);
+   m_datasum = value;
+   fits_read_key(fptr, TSTRING, "SRCFILE", value, 0, &status);
+   m_sourceFile = value;
+   fits_read_key(fptr, TSTRING, "SRCEXT", value, 0, &status);
+   m_sourceExtension = value;
+   long nranges;
+   fits_get_num_rows(fptr, &nranges, &status);
+   CfitsioUtil::checkStatus(status, "RowSelection", fptr);
+   m_nrows = nrows;
+
+   if (nranges > 0) {
+      std::vector<LONGLONG> gaps(nranges);
+      std::vector<LONGLONG> lengths(nranges);
+      int anynul(0);
+      fits_read_col(fptr, TLONGLONG, 1, 1, 1, nranges, 0, &gaps[0],
+                    &anynul, &status);
+      fits_read_col(fptr, TLONGLONG, 2, 1, 1, nranges, 0, &lengths[0],
+                    &anynul, &status);
+      CfitsioUtil::checkStatus(status, "RowSelection", fptr);
+      tip::Index_t first(0);
+      for (long i(0); i < nranges; i++) {
+         first += gaps[i];
+         addRange(RowRange_t(first, first + lengths[i]));
+         first += lengths[i];
+      }
+   }
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "RowSelection");
+}
+
+void RowSelection::addRange(const RowRange_t & range) {
+   if (range.first >= range.second) {
+      return;
+   }
+   if (!m_ranges.empty() && range.first < m_ranges.back().second) {
+      throw std::runtime_error("RowSelection::addRange: rows must be "
+                               "added in increasing order.");
+   }
+   if (!m_ranges.empty() && range.first == m_ranges.back().second) {
+      m_ranges.back().second = range.second;
+   } else {
+      m_ranges.push_back(range);
+   }
+   m_numSelected += range.second - range.first;
+}
+
+bool RowSelection::contains(tip::Index_t row) const {
+   std::vector<RowRange_t>::const_iterator it
+      = std::lower_bound(m_ranges.begin(), m_ranges.end(), row, rangeLess);
+   return it != m_ranges.end() && it->first <= row;
+}
+
+RowSelection & RowSelection::operator&=(const RowSelection & rhs) {
+   if (!sameSource(rhs)) {
+      throw std::runtime_error("RowSelection::operator&=: the selections "
+                               "are from different tables.");
+   }
+   if (&rhs == this) {
+      return *this;
+   }
+   std::vector<RowRange_t> ranges;
+   ranges.swap(m_ranges);
+   m_numSelected = 0;
+   size_t i(0);
+   size_t j(0);
+   while (i < ranges.size() && j < rhs.m_ranges.size()) {
+      tip::Index_t first(std::max(ranges[i].first, rhs.m_ranges[j].first));
+      tip::Index_t last(std::min(ranges[i].second, rhs.m_ranges[j].second));
+      if (first < last) {
+         addRange(RowRange_t(first, last));
+      }
+      if (ranges[i].second < rhs.m_ranges[j].second) {
+         i++;
+      } else {
+         j++;
+      }
+   }
+   return *this;
+}
+
+RowSelection & RowSelection::operator|=(const RowSelection & rhs) {
+   if (!sameSource(rhs)) {
+      throw std::runtime_error("RowSelection::operator|=: the selections "
+                               "are from different tables.");
+   }
+   if (&rhs == this) {
+      return *this;
+   }
+   std::vector<RowRange_t> ranges;
+   ranges.swap(m_ranges);
+   m_numSelected = 0;
+// Merge the two sorted lists of ranges, joining those that overlap
+// or abut.
+   size_t i(0);
+   size_t j(0);
+   while (i < ranges.size() || j < rhs.m_ranges.size()) {
+      RowRange_t next;
+      if (j == rhs.m_ranges.size() ||
+          (i < ranges.size() && ranges[i].first < rhs.m_ranges[j].first)) {
+         next = ranges[i++];
+      } else {
+         next = rhs.m_ranges[j++];
+      }
+      if (!m_ranges.empty() && next.first <= m_ranges.back().second) {
+         if (next.second > m_ranges.back().second) {
+            m_numSelected += next.second - m_ranges.back().second;
+            m_ranges.back().second = next.second;
+         }
+      } else {
+         addRange(next);
+      }
+   }
+   return *this;
+}
+
+bool RowSelection::matches(const tip::Table & events) const {
+   return CfitsioUtil::matches(events, m_nrows, m_datasum);
+}
+
+bool RowSelection::matches(const CompressedTable & events) const {
+   return (events.getNumRecords() == m_nrows && events.datasum() != ""
+           && events.datasum() == m_datasum);
+}
+
+void RowSelection::write(const std::string & selectionFile,
+                         const Cuts & cuts, const Gti & gti,
+                         const std::string & eventFile,
+                         const std::string & extension) const {
+   std::remove(selectionFile.c_str());
+   int status(0);
+   fitsfile * fptr(0);
+   fits_create_file(&fptr, selectionFile.c_str(), &status);
+   CfitsioUtil::checkStatus(status, "RowSelection::write");
+   char * ttype[] = {const_cast<char *>("ROW_GAP"),
+                     const_cast<char *>("NROWS")};
+   char * tform[] = {const_cast<char *>("1K"), const_cast<char *>("1K")};
+   char extname[] = "SELECTION";
+   fits_create_tbl(fptr, BINARY_TBL, 0, 2, ttype, tform, 0, extname,
+                   &status);
+   fits_update_key(fptr, TSTRING, "SRCFILE",
+                   const_cast<char *>(eventFile.c_str()),
+                   "Source event file", &status);
+   fits_update_key(fptr, TSTRING, "SRCEXT",
+                   const_cast<char *>(extension.c_str()),
+                   "Source event table", &status);
+   LONGLONG value(m_nrows);
+   fits_update_key(fptr, TLONGLONG, "SRCROWS", &value,
+                   "Number of rows in the event table", &status);
+   fits_update_key(fptr, TSTRING, "SRCSUM",
+                   const_cast<char *>(m_datasum.c_str()),
+                   "DATASUM of the event table", &status);
+   value = m_numSelected;
+   fits_update_key(fptr, TLONGLONG, "NSELECT", &value,
+                   "Number of selected rows", &status);
+
+   long nranges(m_ranges.size());
+   if (nranges > 0) {
+      std::vector<LONGLONG> gaps(nranges);
+      std::vector<LONGLONG> lengths(nranges);
+      tip::Index_t last(0);
+      for (long i(0); i < nranges; i++) {
+         gaps[i] = m_ranges[i].first - last;
+         lengths[i] = m_ranges[i].second - m_ranges[i].first;
+         last = m_ranges[i].second;
+      }
+      fits_write_col(fptr, TLONGLONG, 1, 1, 1, nranges, &gaps[0], &status);
+      fits_write_col(fptr, TLONGLONG, 2, 1, 1, nranges, &lengths[0],
+                     &status);
+   }
+   CfitsioUtil::checkStatus(status, "RowSelection::write", fptr);
+   fits_close_file(fptr, &status);
+   CfitsioUtil::checkStatus(status, "RowSelection::write");
+
+   std::unique_ptr<tip::Table>
+      table(tip::IFileSvc::instance().editTable(selectionFile, "SELECTION"));
+   cuts.writeDssKeywords(table->getHeader());
+   table.reset();
+
+   gti.writeExtension(selectionFile);
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,189 @@
+/**
+ * @file SchemaCuts.cxx
+ * @brief Apply Cuts to event values laid out according to a
+ * ColumnSchema.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/GtiCut.h"
+#include "dataSubselector/RangeCut.h"
+#include "dataSubselector/RangeSetCut.h"
+#include "dataSubselector/SchemaCuts.h"
+#include "dataSubselector/SkyConeCut.h"
+
+namespace {
+   /// Rough relative cost of each kind of cut, used to evaluate the
+   /// cheap ones first.
+   int cost(dataSubselector::CutBase::Kind kind) {
+      switch (kind) {
+      case dataSubselector::CutBase::RANGE:
+      case dataSubselector::CutBase::BIT_MASK:
+         return 0;
+      case dataSubselector::CutBase::GTI:
+      case dataSubselector::CutBase::RANGE_SET:
+         return 1;
+      default:
+         return 2;
+      }
+   }
+
+   template <typename Term_t>
+   bool cheaper(const Term_t & a, const Term_t & b) {
+      return cost(a.kind) < cost(b.kind);
+   }
+}
+
+namespace dataSubselector {
+
+SchemaCuts::SchemaCuts(const Cuts & cuts, const ColumnSchema & schema)
+   : m_cuts(new Cuts(cuts)), m_schema(schema) {
+   for (unsigned int i = 0; i < m_cuts->size(); i++) {
+      const CutBase & cut((*m_cuts)[i]);
+      Term term;
+      term.kind = cut.kind();
+      term.cut = &cut;
+      term.slot2 = 0;
+      term.index = 0;
+      bool have_columns(false);
+      switch (cut.kind()) {
+// Cuts on vector elements are found by their DSTYPn names, e.g.,
+// "CALIB_VERSION[1]", as in Cuts::accept(params).
+      case CutBase::RANGE:
+         have_columns = m_schema.slot(static_cast<const RangeCut &>(cut)
+                                      .colname(), term.slot);
+         break;
+      case CutBase::BIT_MASK:
+         have_columns = m_schema.slot(static_cast<const BitMaskCut &>(cut)
+                                      .colname(), term.slot);
+         break;
+      case CutBase::RANGE_SET:
+         have_columns = m_schema.slot(static_cast<const RangeSetCut &>(cut)
+                                      .colname(), term.slot);
+         break;
+      case CutBase::GTI:
+         have_columns = m_schema.slot("TIME", term.slot);
+         break;
+      case CutBase::SKYCONE:
+         have_columns = (m_schema.slot("RA", term.slot) &&
+                         m_schema.slot("DEC", term.slot2));
+         if (have_columns) {
+            std::vector<SkyConeCut> cones;
+            cones.push_back(static_cast<const SkyConeCut &>(cut));
+            m_coneIndices.push_back(std::shared_ptr<const ConeIndex>
+                                    (new ConeIndex(cones)));
+            term.index = m_coneIndices.back().get();
+         }
+         break;
+      case CutBase::VERSION:
+         // Not applied to event data.
+         break;
+      default:
+         throw std::runtime_error("SchemaCuts: unsupported cut type, "
+                                  + cut.type());
+      }
+      if (have_columns) {
+         m_terms.push_back(term);
+      }
+   }
+   std::stable_sort(m_terms.begin(), m_terms.end(), cheaper<Term>);
+}
+
+void SchemaCuts::columns(const Cuts & cuts,
+                         std::vector<std::string> & colnames) {
+   for (unsigned int i = 0; i < cuts.size(); i++) {
+      const CutBase & cut(cuts[i]);
+      std::vector<std::string> names;
+      switch (cut.kind()) {
+      case CutBase::RANGE:
+         names.push_back(static_cast<const RangeCut &>(cut).colname());
+         break;
+      case CutBase::BIT_MASK:
+         names.push_back(static_cast<const BitMaskCut &>(cut).colname());
+         break;
+      case CutBase::RANGE_SET:
+         names.push_back(static_cast<const RangeSetCut &>(cut).colname());
+         break;
+      case CutBase::GTI:
+         names.push_back("TIME");
+         break;
+      case CutBase::SKYCONE:
+         names.push_back("RA");
+         names.push_back("DEC");
+         break;
+      default:
+         break;
+      }
+      for (size_t j = 0; j < names.size(); j++) {
+         if (std::find(colnames.begin(), colnames.end(), names[j])
+             == colnames.end()) {
+            colnames.push_back(names[j]);
+         }
+      }
+   }
+}
+
+bool SchemaCuts::accept(const Term & term, double value, double value2) {
+   switch (term.kind) {
+   case CutBase::RANGE:
+      return static_cast<const RangeCut *>(term.cut)->accept(value);
+   case CutBase::BIT_MASK:
+      return static_cast<const BitMaskCut *>(term.cut)
+         ->accept(static_cast<unsigned int>(value));
+   case CutBase::GTI:
+      return static_cast<const GtiCut *>(term.cut)->accept(value);
+   case CutBase::RANGE_SET:
+      return static_cast<const RangeSetCut *>(term.cut)->accept(value);
+   case CutBase::SKYCONE:
+      return term.index->accept(value, value2);
+   default:
+      return true;
+   }
+}
+
+bool SchemaCuts::accept(const double * values) const {
+   for (size_t i = 0; i < m_terms.size(); i++) {
+      const Term & term(m_terms[i]);
+      if (!accept(term, values[term.slot], values[term.slot2])) {
+         return false;
+      }
+   }
+   return true;
+}
+
+void SchemaCuts::accept(const double * const * columns, size_t nevents,
+                        std::vector<char> & accepted) const {
+   accepted.assign(nevents, 1);
+// Apply one cut at a time to the whole block so that the dispatch
+// on the kind of cut happens once per block.
+   for (size_t j = 0; j < m_terms.size(); j++) {
+      const Term & term(m_terms[j]);
+      const double * values(columns[term.slot]);
+      if (term.kind == CutBase::RANGE) {
+         const RangeCut & cut(*static_cast<const RangeCut *>(term.cut));
+         for (size_t i = 0; i < nevents; i++) {
+            accepted[i] &= cut.accept(values[i]);
+         }
+      } else if (term.kind == CutBase::BIT_MASK) {
+         const BitMaskCut & cut(*static_cast<const BitMaskCut *>(term.cut));
+         for (size_t i = 0; i < nevents; i++) {
+            accepted[i] &= cut.accept(static_cast<unsigned int>(values[i]));
+         }
+      } else {
+         const double * values2(columns[term.slot2]);
+         for (size_t i = 0; i < nevents; i++) {
+            if (accepted[i]) {
+               accepted[i] = accept(term, values[i], values2[i]);
+            }
+         }
+      }
+   }
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,276 @@
+/**
+ * @file SelectionSplitter.cxx
+ * @brief Distribute the events of one pass over the input among
+ * several selections.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "tip/Table.h"
+
+#include "dataSubselector/ColumnProjection.h"
+#include "dataSubselector/SchemaCuts.h"
+#include "dataSubselector/SelectionSplitter.h"
+#include "dataSubselector/SkyConeCut.h"
+
+namespace {
+   bool hasCut(const dataSubselector::Cuts & cuts,
+               const dataSubselector::CutBase & cut) {
+      for (unsigned int i(0); i < cuts.size(); i++) {
+         if (cuts[i] == cut) {
+            return true;
+         }
+      }
+      return false;
+   }
+}
+
+namespace dataSubselector {
+
+SelectionSplitter::SelectionSplitter(const std::vector<Cuts> & selections,
+                                     tip::Index_t blockSize)
+   : m_blockSize(blockSize), m_residuals(selections.size()) {
+   if (selections.empty()) {
+      throw std::runtime_error("SelectionSplitter: no selections given.");
+   }
+   if (m_blockSize < 1) {
+      m_blockSize = 1;
+   }
+   size_t nsel(selections.size());
+   const Cuts & firstCuts(selections.front());
+   for (unsigned int i(0); i < firstCuts.size(); i++) {
+      bool shared(true);
+      for (size_t k(1); k < nsel && shared; k++) {
+         shared = hasCut(selections[k], firstCuts[i]);
+      }
+      if (shared) {
+         m_common.addCut(firstCuts[i]);
+      }
+   }
+   for (size_t k(0); k < nsel; k++) {
+      for (unsigned int i(0); i < selections[k].size(); i++) {
+         if (!hasCut(m_common, selections[k][i])) {
+            m_residuals[k].addCut(selections[k][i]);
+         }
+      }
+   }
+
+// Use a ConeIndex only if every selection has a single cone of its
+// own.
+   std::vector<SkyConeCut> cones;
+   std::vector<Cuts> otherCuts(nsel);
+   for (size_t k(0); k < nsel; k++) {
+      for (unsigned int i(0); i < m_residuals[k].size(); i++) {
+         if (m_residuals[k][i].kind() == CutBase::SKYCONE) {
+            cones.push_back(static_cast<const SkyConeCut &>
+                            (m_residuals[k][i]));
+         } else {
+            otherCuts[k].addCut(m_residuals[k][i]);
+         }
+      }
+      if (cones.size() != k + 1) {
+         return;
+      }
+   }
+   if (nsel > 1) {
+      m_coneIndex.reset(new ConeIndex(cones));
+      m_otherCuts.swap(otherCuts);
+   }
+}
+
+std::string SelectionSplitter::filterString() const {
+   std::string anyFilter("");
+   for (size_t k(0); k < m_residuals.size(); k++) {
+      std::string residualFilter(m_residuals[k].filterString());
+      if (residualFilter == "") {
+// This selection accepts every event passing the common cuts.
+         anyFilter = "";
+         break;
+      }
+      anyFilter += (anyFilter == "" ? "(" : " || (") + residualFilter + ")";
+   }
+   std::string filter(m_common.filterString());
+   if (anyFilter != "") {
+      filter += (filter == "" ? "(" : " && (") + anyFilter + ")";
+   }
+   return filter;
+}
+
+void SelectionSplitter::copyRows(const tip::Table & input,
+                                 const std::vector<tip::Table *> & outputs,
+                                 std::vector<tip::Index_t> & nrows) const {
+   size_t nsel(m_residuals.size());
+   if (outputs.size() != nsel || nrows.size() != nsel) {
+      throw std::runtime_error("SelectionSplitter::copyRows: the number "
+                               "of outputs does not match the number of "
+                               "selections.");
+   }
+   std::vector<tip::Index_t> capacity(nrows);
+   std::vector<tip::Table::Iterator> outputIts;
+   for (size_t k(0); k < nsel; k++) {
+      outputIts.push_back(outputs[k]->begin() + nrows[k]);
+   }
+   std::vector<unsigned int> matched;
+   std::vector<unsigned int> all(nsel);
+   for (size_t k(0); k < nsel; k++) {
+      all[k] = k;
+   }
+
+   tip::Table::ConstIterator inputIt = input.begin();
+   tip::ConstTableRecord & row = *inputIt;
+   for (; inputIt != input.end(); ++inputIt) {
+      const std::vector<Cuts> * cuts(&m_residuals);
+      const std::vector<unsigned int> * candidates(&all);
+      if (m_coneIndex.get()) {
+         double ra, dec;
+         row["RA"].get(ra);
+         row["DEC"].get(dec);
+         m_coneIndex->findCones(ra, dec, matched);
+         cuts = &m_otherCuts;
+         candidates = &matched;
+      }
+      for (size_t i(0); i < candidates->size(); i++) {
+         size_t k((*candidates)[i]);
+         if (!(*cuts)[k].accept(row)) {
+            continue;
+         }
+         if (nrows[k] == capacity[k]) {
+            capacity[k] += m_blockSize;
+            outputs[k]->setNumRecords(capacity[k]);
+            outputIts[k] = outputs[k]->begin() + nrows[k];
+         }
+         *outputIts[k] = row;
+         ++outputIts[k];
+         nrows[k]++;
+      }
+   }
+
+// Trim the unused rows of the last block.
+   for (size_t k(0); k < nsel; k++) {
+      if (capacity[k] != nrows[k]) {
+         outputs[k]->setNumRecords(nrows[k]);
+      }
+   }
+}
+
+void SelectionSplitter::
+appendRows(const CompressedTable & input, const std::string & filterString,
+           const std::vector<CompressedTable::Writer *> & outputs,
+           const ColumnProjection * projection) const {
+   size_t nsel(m_residuals.size());
+   if (outputs.size() != nsel) {
+      throw std::runtime_error("SelectionSplitter::appendRows: the number "
+                               "of outputs does not match the number of "
+                               "selections.");
+   }
+   bool project(projection && projection->active());
+   long inputRowSize(input.rowSize());
+   long outputRowSize(project ? projection->outputRowSize() : inputRowSize);
+   for (size_t k(0); k < nsel; k++) {
+      if (outputs[k]->rowSize() != outputRowSize) {
+         throw std::runtime_error("SelectionSplitter::appendRows: the rows "
+                                  "of an output do not match those of "
+                                  "the input.");
+      }
+   }
+
+// The residual cuts of all of the selections share one schema, so
+// that each column is read once per block.
+   const std::vector<Cuts> & cuts(m_coneIndex.get() ? m_otherCuts
+                                  : m_residuals);
+   std::vector<std::string> colnames;
+   if (m_coneIndex.get()) {
+      colnames.push_back("RA");
+      colnames.push_back("DEC");
+   }
+   for (size_t k(0); k < nsel; k++) {
+      SchemaCuts::columns(cuts[k], colnames);
+   }
+   ColumnSchema schema;
+   for (size_t i(0); i < colnames.size(); i++) {
+      if (input.hasColumn(colnames[i])) {
+         schema.addColumn(colnames[i]);
+      }
+   }
+   unsigned int raSlot(0);
+   unsigned int decSlot(0);
+   if (m_coneIndex.get() && !(schema.slot("RA", raSlot) &&
+                              schema.slot("DEC", decSlot))) {
+      throw std::runtime_error("SelectionSplitter::appendRows: the input "
+                               "has no RA and DEC columns.");
+   }
+   std::vector<SchemaCuts> schemaCuts;
+   for (size_t k(0); k < nsel; k++) {
+      schemaCuts.push_back(SchemaCuts(cuts[k], schema));
+   }
+
+   std::vector<char> passed;
+   std::vector<std::vector<char> > accepted(nsel);
+   std::vector<std::vector<double> > columns(schema.size());
+   std::vector<const double *> pointers(schema.size());
+   std::vector<double> values(schema.size());
+   std::vector<unsigned int> matched;
+   std::vector<unsigned char> rows;
+   std::vector<unsigned char> selected;
+   for (tip::Index_t first(0); first < input.getNumRecords();
+        first += m_blockSize) {
+      tip::Index_t nrows(std::min(m_blockSize,
+                                  input.getNumRecords() - first));
+      if (input.findRows(filterString, first, nrows, passed) == 0) {
+         continue;
+      }
+      for (unsigned int slot(0); slot < schema.size(); slot++) {
+         input.readColumn(schema.colname(slot), first, nrows, columns[slot]);
+         pointers[slot] = &columns[slot][0];
+      }
+      if (!m_coneIndex.get()) {
+         for (size_t k(0); k < nsel; k++) {
+            schemaCuts[k].accept(pointers.empty() ? 0 : &pointers[0], nrows,
+                                 accepted[k]);
+         }
+      } else {
+         for (size_t k(0); k < nsel; k++) {
+            accepted[k].assign(nrows, 0);
+         }
+         for (tip::Index_t row(0); row < nrows; row++) {
+            if (!passed[row]) {
+               continue;
+            }
+            for (unsigned int slot(0); slot < schema.size(); slot++) {
+               values[slot] = columns[slot][row];
+            }
+            m_coneIndex->findCones(values[raSlot], values[decSlot], matched);
+            for (size_t i(0); i < matched.size(); i++) {
+               accepted[matched[i]][row] = schemaCuts[matched[i]]
+                  .accept(&values[0]);
+            }
+         }
+      }
+      rows.resize(static_cast<size_t>(nrows)*inputRowSize);
+      input.readRows(first, nrows, &rows[0]);
+      for (size_t k(0); k < nsel; k++) {
+         selected.clear();
+         tip::Index_t nselected(0);
+         for (tip::Index_t row(0); row < nrows; row++) {
+            if (passed[row] && accepted[k][row]) {
+               selected.insert(selected.end(), &rows[row*inputRowSize],
+                               &rows[row*inputRowSize] + inputRowSize);
+               nselected++;
+            }
+         }
+         if (nselected == 0) {
+            continue;
+         }
+         if (project) {
+            projection->project(&selected[0], nselected, &selected[0]);
+         }
+         outputs[k]->append(&selected[0], nselected);
+      }
+   }
+}
+
+} // namespace dataSubselector
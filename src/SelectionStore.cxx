@@ -0,0 +1,129 @@
+/**
+ * @file SelectionStore.cxx
+ * @brief A directory of RowSelection files, one for each cut applied
+ * to an event table.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdio>
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "tip/Header.h"
+#include "tip/Table.h"
+#include "tip/TipException.h"
+
+#include "st_facilities/Util.h"
+
+#include "dataSubselector/CutBase.h"
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/Gti.h"
+#include "dataSubselector/GtiCut.h"
+#include "dataSubselector/RowSelection.h"
+#include "dataSubselector/SelectionStore.h"
+
+namespace {
+   /// 64-bit FNV-1a hash, as 16 hex digits.  Unlike std::hash, this
+   /// is the same for every build, so stored keys remain valid.
+   std::string fnv1a(const std::string & text) {
+      unsigned long long hash(14695981039346656037ULL);
+      for (size_t i(0); i < text.size(); i++) {
+         hash ^= static_cast<unsigned char>(text[i]);
+         hash *= 1099511628211ULL;
+      }
+      std::ostringstream key;
+      key << std::hex << std::setw(16) << std::setfill('0') << hash;
+      return key.str();
+   }
+}
+
+namespace dataSubselector {
+
+SelectionStore::SelectionStore(const std::string & directory)
+   : m_directory(directory) {
+   if (m_directory.empty()) {
+      m_directory = ".";
+   }
+}
+
+bool SelectionStore::contains(const CutBase & cut,
+                              const tip::Table & events) const {
+   std::string file(fileName(cut, events));
+   return file != "" && st_facilities::Util::fileExists(file);
+}
+
+bool SelectionStore::find(const CutBase & cut, const tip::Table & events,
+                          RowSelection & selection) const {
+   if (!contains(cut, events)) {
+      return false;
+   }
+   RowSelection stored(fileName(cut, events));
+   if (!stored.matches(events)) {
+      return false;
+   }
+   selection = stored;
+   return true;
+}
+
+void SelectionStore::store(const CutBase & cut, const tip::Table & events,
+                           const RowSelection & selection) const {
+   std::string file(fileName(cut, events));
+   if (file == "") {
+      return;
+   }
+   if (!selection.matches(events)) {
+      throw std::runtime_error("SelectionStore::store: the selection is "
+                               "not from this event table.");
+   }
+   Cuts cuts;
+   cuts.addCut(cut);
+   Gti gti;
+   if (cut.kind() == CutBase::GTI) {
+      gti = static_cast<const GtiCut &>(cut).gti();
+   }
+   std::string tmpFile(file + ".tmp");
+   selection.write(tmpFile, cuts, gti);
+   if (std::rename(tmpFile.c_str(), file.c_str()) != 0) {
+      std::remove(tmpFile.c_str());
+      throw std::runtime_error("SelectionStore::store: cannot write "
+                               + file);
+   }
+}
+
+std::string SelectionStore::fileName(const CutBase & cut,
+                                     const tip::Table & events) const {
+   std::string datasum("");
+   try {
+      events.getHeader()["DATASUM"].get(datasum);
+   } catch (tip::TipException &) {
+   }
+   if (datasum == "") {
+      return "";
+   }
+   std::ostringstream identity;
+   identity << events.getNumRecords() << ":" << datasum;
+   return (m_directory + "/sel_" + cutKey(cut) + "_" + fnv1a(identity.str())
+           + ".fits");
+}
+
+std::string SelectionStore::cutKey(const CutBase & cut) {
+   std::ostringstream description;
+   cut.writeCut(description, 1);
+// GtiCut::writeCut rounds the interval bounds to 12 digits, so GTIs
+// differing by less than that would share a key.  Seventeen digits
+// identify a double exactly.
+   if (cut.kind() == CutBase::GTI) {
+      const Gti & gti(static_cast<const GtiCut &>(cut).gti());
+      description << std::setprecision(17);
+      for (evtbin::Gti::ConstIterator it(gti.begin()); it != gti.end(); ++it) {
+         description << it->first << " " << it->second << "\n";
+      }
+   }
+   return fnv1a(description.str());
+}
+
+} // namespace dataSubselector
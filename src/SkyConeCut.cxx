@@ -22,7 +22,7 @@ namespace dataSubselector {
 
 SkyConeCut::SkyConeCut(const std::string & type,
                        const std::string & unit, 
-                       const std::string & value) : CutBase("SkyCone") {
+                       const std::string & value) : CutBase(SKYCONE) {
    if (unit.find("deg") != 0) {
       throw std::runtime_error("dataSubselector::SkyConeCut:\n" +
                                std::string("Unsupported unit: ") + unit);
@@ -84,11 +84,10 @@ bool SkyConeCut::equals(const CutBase & arg) const {
 }
 
 bool SkyConeCut::supercedes(const CutBase & cut) const {
-   if (cut.type() != "SkyCone") {
+   if (cut.kind() != SKYCONE) {
       return false;
    }
-   SkyConeCut & coneCut = 
-      dynamic_cast<SkyConeCut &>(const_cast<CutBase &>(cut));
+   const SkyConeCut & coneCut = static_cast<const SkyConeCut &>(cut);
    double separation = m_coneCenter.difference(coneCut.m_coneCenter)*180./M_PI;
    if (m_radius <= coneCut.m_radius - separation) {
       return true;
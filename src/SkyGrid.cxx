@@ -0,0 +1,101 @@
+/**
+ * @file SkyGrid.cxx
+ * @brief Division of the sky into declination bands and RA pixels of
+ * roughly equal area.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cmath>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "dataSubselector/SkyGrid.h"
+
+namespace {
+   const double deg(M_PI/180.);
+
+   struct Vector {
+      Vector(double ra, double dec)
+         : x(std::cos(dec*deg)*std::cos(ra*deg)),
+           y(std::cos(dec*deg)*std::sin(ra*deg)),
+           z(std::sin(dec*deg)) {}
+      double x, y, z;
+   };
+
+   double angle(const Vector & a, const Vector & b) {
+      double cx(a.y*b.z - a.z*b.y);
+      double cy(a.z*b.x - a.x*b.z);
+      double cz(a.x*b.y - a.y*b.x);
+      double cross(std::sqrt(cx*cx + cy*cy + cz*cz));
+      return std::atan2(cross, a.x*b.x + a.y*b.y + a.z*b.z)/deg;
+   }
+}
+
+namespace dataSubselector {
+
+SkyGrid::SkyGrid(double pixelSize) {
+   if (pixelSize <= 0) {
+      throw std::runtime_error("SkyGrid: pixel size must be positive.");
+   }
+   int nbands(static_cast<int>(std::ceil(180./pixelSize)));
+   m_bandHeight = 180./nbands;
+   m_bandStart.push_back(0);
+   for (int b(0); b < nbands; b++) {
+      double dec0(-90. + b*m_bandHeight);
+      double dec1(dec0 + m_bandHeight);
+      double cosdec(1.);
+      if (dec1 < 0) {
+         cosdec = std::cos(dec1*deg);
+      } else if (dec0 > 0) {
+         cosdec = std::cos(dec0*deg);
+      }
+// At least four pixels per band, so that each spans less than 180
+// degrees of RA and the pixel corners remain the farthest points from
+// the pixel center.
+      unsigned int nra(static_cast<unsigned int>(std::ceil(360.*cosdec
+                                                           /m_bandHeight)));
+      m_nra.push_back(std::max(nra, 4u));
+      m_bandStart.push_back(m_bandStart.back() + m_nra.back());
+   }
+}
+
+int SkyGrid::band(double dec) const {
+   int b(static_cast<int>(std::floor((dec + 90.)/m_bandHeight)));
+   return std::min(std::max(b, 0), numBands() - 1);
+}
+
+unsigned int SkyGrid::pixel(double ra, double dec) const {
+   int b(band(dec));
+   double phi(std::fmod(ra, 360.));
+   if (phi < 0) {
+      phi += 360.;
+   }
+   unsigned int j(static_cast<unsigned int>(phi*m_nra[b]/360.));
+   return m_bandStart[b] + std::min(j, m_nra[b] - 1);
+}
+
+void SkyGrid::pixelCircle(unsigned int pixel, double & ra, double & dec,
+                          double & radius) const {
+   int b(static_cast<int>(std::upper_bound(m_bandStart.begin(),
+                                           m_bandStart.end(), pixel)
+                          - m_bandStart.begin()) - 1);
+   double width(360./m_nra[b]);
+   double ra0((pixel - m_bandStart[b])*width);
+   double dec0(-90. + b*m_bandHeight);
+   ra = ra0 + width/2.;
+   dec = dec0 + m_bandHeight/2.;
+// Within a pixel, the distance from the center is largest at the
+// corners.
+   Vector center(ra, dec);
+   radius = std::max(angle(center, Vector(ra0, dec0)),
+                     angle(center, Vector(ra0, dec0 + m_bandHeight)));
+}
+
+double SkyGrid::separation(double ra1, double dec1, double ra2, double dec2) {
+   return angle(Vector(ra1, dec1), Vector(ra2, dec2));
+}
+
+} // namespace dataSubselector
@@ -0,0 +1,154 @@
+/**
+ * @file TimePlanner.cxx
+ * @brief Find the row ranges of a TIME-sorted table that can pass the
+ * time cuts in a set of Cuts.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "tip/IColumn.h"
+#include "tip/Table.h"
+
+#include "dataSubselector/Cuts.h"
+#include "dataSubselector/Gti.h"
+#include "dataSubselector/GtiCut.h"
+#include "dataSubselector/RangeCut.h"
+#include "dataSubselector/TimePlanner.h"
+
+namespace {
+   typedef dataSubselector::TimePlanner::Interval_t Interval_t;
+
+   std::vector<Interval_t> gtiIntervals(const dataSubselector::Gti & gti) {
+      std::vector<Interval_t> intervals;
+      for (evtbin::Gti::ConstIterator it(gti.begin()); it != gti.end(); ++it) {
+         intervals.push_back(Interval_t(it->first, it->second));
+      }
+      return intervals;
+   }
+
+   /// The first row at or after row lo with time greater than (or, if
+   /// inclusive, not less than) the given value.
+   tip::Index_t search(const tip::IColumn & column, tip::Index_t lo,
+                       tip::Index_t hi, double value, bool inclusive) {
+      while (lo < hi) {
+         tip::Index_t mid(lo + (hi - lo)/2);
+         double time;
+         column.get(mid, time);
+         if (time < value || (!inclusive && time == value)) {
+            lo = mid + 1;
+         } else {
+            hi = mid;
+         }
+      }
+      return lo;
+   }
+}
+
+namespace dataSubselector {
+
+TimePlanner::TimePlanner(const Cuts & cuts) : m_restricted(false) {
+   const double inf(std::numeric_limits<double>::infinity());
+   m_intervals.push_back(Interval_t(-inf, inf));
+   for (unsigned int i(0); i < cuts.size(); i++) {
+      if (cuts[i].kind() == CutBase::GTI) {
+         addGti(static_cast<const GtiCut &>(cuts[i]).gti());
+      }
+   }
+   const std::vector<RangeCut *> & timeCuts(cuts.rangeCuts("TIME"));
+   for (size_t i(0); i < timeCuts.size(); i++) {
+      const RangeCut & cut(*timeCuts[i]);
+      Interval_t interval(cut.minVal(), cut.maxVal());
+      if (cut.intervalType() == RangeCut::MINONLY) {
+         interval.second = inf;
+      } else if (cut.intervalType() == RangeCut::MAXONLY) {
+         interval.first = -inf;
+      }
+      intersect(std::vector<Interval_t>(1, interval));
+   }
+}
+
+void TimePlanner::addGti(const Gti & gti) {
+   intersect(gtiIntervals(gti));
+}
+
+void TimePlanner::intersect(std::vector<Interval_t> intervals) {
+   m_restricted = true;
+   std::sort(intervals.begin(), intervals.end());
+   std::vector<Interval_t> result;
+   size_t i(0);
+   size_t j(0);
+   while (i < m_intervals.size() && j < intervals.size()) {
+      double start(std::max(m_intervals[i].first, intervals[j].first));
+      double stop(std::min(m_intervals[i].second, intervals[j].second));
+      if (start <= stop) {
+         if (!result.empty() && start <= result.back().second) {
+            result.back().second = std::max(result.back().second, stop);
+         } else {
+            result.push_back(Interval_t(start, stop));
+         }
+      }
+      if (m_intervals[i].second < intervals[j].second) {
+         i++;
+      } else {
+         j++;
+      }
+   }
+   m_intervals = result;
+}
+
+void TimePlanner::rowRanges(const tip::Table & table,
+                            std::vector<RowRange_t> & ranges,
+                            const std::string & timeColumn) const {
+   ranges.clear();
+   tip::Index_t nrows(table.getNumRecords());
+   if (!m_restricted) {
+      ranges.push_back(RowRange_t(0, nrows));
+      return;
+   }
+   const tip::IColumn & column(*table.getColumn(table
+                                                .getFieldIndex(timeColumn)));
+   tip::Index_t lo(0);
+   for (size_t i(0); i < m_intervals.size() && lo < nrows; i++) {
+      tip::Index_t first(search(column, lo, nrows,
+                                m_intervals[i].first, true));
+      tip::Index_t last(search(column, first, nrows,
+                               m_intervals[i].second, false));
+      if (first < last) {
+         if (!ranges.empty() && ranges.back().second == first) {
+            ranges.back().second = last;
+         } else {
+            ranges.push_back(RowRange_t(first, last));
+         }
+      }
+      lo = last;
+   }
+}
+
+bool TimePlanner::isSorted(const tip::Table & table,
+                           const std::string & timeColumn,
+                           tip::Index_t nsamples) {
+   tip::Index_t nrows(table.getNumRecords());
+   if (nrows < 2) {
+      return true;
+   }
+   const tip::IColumn & column(*table.getColumn(table
+                                                .getFieldIndex(timeColumn)));
+   nsamples = std::min(std::max(nsamples, tip::Index_t(2)), nrows);
+   double previous(0);
+   for (tip::Index_t i(0); i < nsamples; i++) {
+      tip::Index_t row((nrows - 1)*i/(nsamples - 1));
+      double time;
+      column.get(row, time);
+      if (i > 0 && time < previous) {
+         return false;
+      }
+      previous = time;
+   }
+   return true;
+}
+
+} // namespace dataSubselector
@@ -20,14 +20,13 @@ namespace dataSubselector {
 VersionCut::VersionCut(const std::string & colname,
                        const std::string & version) 
                        
-   : CutBase("version"), m_colname(colname), m_version(version) {}
+   : CutBase(VERSION), m_colname(colname), m_version(version) {}
 
 bool VersionCut::supercedes(const CutBase & cut) const {
-   if (cut.type() != "version") {
+   if (cut.kind() != VERSION) {
       return false;
    }
-   VersionCut & versionCut = 
-      dynamic_cast<VersionCut &>(const_cast<CutBase &>(cut));
+   const VersionCut & versionCut = static_cast<const VersionCut &>(cut);
    if (versionCut.colname() == colname()) {
       return true;
    }
@@ -6,7 +6,12 @@
  *  $Header: /nfs/slac/g/glast/ground/cvs/ScienceTools-scons/dataSubselector/src/dataSubselector/dataSubselector.cxx,v 1.45 2014/06/27 21:20:27 jchiang Exp $
  */
 
+#include <cstdio>
+#include <cstdlib>
+
 #include <algorithm>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
 
 #include "facilities/Util.h"
@@ -25,11 +30,55 @@
 #include "st_facilities/FitsUtil.h"
 #include "st_facilities/Util.h"
 
+#include "dataSubselector/ColumnProjection.h"
+#include "dataSubselector/CompressedTable.h"
+#include "dataSubselector/CutController.h"
+#include "dataSubselector/EventIndex.h"
+#include "dataSubselector/FilterPipeline.h"
 #include "dataSubselector/Gti.h"
-#include "CutController.h"
+#include "dataSubselector/RowLayout.h"
+#include "dataSubselector/RowSelection.h"
+#include "dataSubselector/SelectionSplitter.h"
+#include "dataSubselector/TimePlanner.h"
 
+using dataSubselector::ColumnProjection;
+using dataSubselector::CompressedTable;
 using dataSubselector::CutController;
+using dataSubselector::Cuts;
+using dataSubselector::EventIndex;
+using dataSubselector::FilterPipeline;
 using dataSubselector::Gti;
+using dataSubselector::RowLayout;
+using dataSubselector::RowSelection;
+using dataSubselector::SelectionSplitter;
+using dataSubselector::TimePlanner;
+
+namespace {
+   typedef TimePlanner::RowRange_t RowRange_t;
+
+   /// Replace ranges with its intersection with other.  Both are
+   /// sorted and disjoint.
+   void intersectRanges(std::vector<RowRange_t> & ranges,
+                        const std::vector<RowRange_t> & other) {
+      std::vector<RowRange_t> result;
+      size_t i(0);
+      size_t j(0);
+      while (i < ranges.size() && j < other.size()) {
+         tip::Index_t first(std::max(ranges[i].first, other[j].first));
+         tip::Index_t last(std::min(ranges[i].second, other[j].second));
+         if (first < last) {
+            result.push_back(RowRange_t(first, last));
+         }
+         if (ranges[i].second < other[j].second) {
+            i++;
+         } else {
+            j++;
+         }
+      }
+      ranges.swap(result);
+   }
+
+}
 
 /**
  * @class DataFilter
@@ -76,12 +125,50 @@ private:
 
    mutable double m_tstart, m_tstop;
 
+   /// An output file and the parameters of the selection to be
+   /// written to it.
+   struct Selection {
+      std::string outfile;
+      CutController::ParMap pars;
+   };
+
    void copyTable(const std::string & extension,
                   CutController * cutController=0) const;
 
-   void copyGtis() const;
+   /// Copy the rows passing the filter expression from input files
+   /// of which at least one is tile-compressed, or to a compressed
+   /// output table, through CompressedTable.
+   void copyCompressedTables(const std::string & extension,
+                             const std::string & filterString,
+                             const CutController & cuts,
+                             const ColumnProjection & projection) const;
+
+   bool copyCandidateRows(const std::string & extension,
+                          const std::string & filterString,
+                          const CutController & cuts,
+                          const ColumnProjection & projection) const;
+
+   tip::Index_t candidateRows(const std::string & extension,
+                              const CutController & cuts,
+                              std::vector<RowRange_t> & ranges) const;
+
+   void writeSelection(const std::string & extension,
+                       const CutController & cuts) const;
+
+   void copyGtis(const CutController & cuts,
+                 const std::string & outfile) const;
+
+   void writeDateKeywords(const std::string & outfile) const;
+
+   void readSelections(const std::string & selectionFile,
+                       std::vector<Selection> & selections) const;
+
+   void copySelections(const std::vector<Selection> & selections,
+                       const std::string & extension) const;
 
-   void writeDateKeywords() const;
+   void prepareOutputFile(const std::string & outfile) const;
+
+   void clobberOutputFile(const std::string & outfile) const;
 
    static std::string s_cvs_id;
 };
@@ -160,11 +247,47 @@ void DataFilter::run() {
    pars["tmin"] = m_tmin;
    pars["tmax"] = m_tmax;
 
+   std::string selectionFile = m_pars["selections"];
+   facilities::Util::expandEnvVar(&selectionFile);
+   if (selectionFile != "" && selectionFile != "none" &&
+       selectionFile != "NONE") {
+// The selections are copied in one pass over the input, so the
+// options for reading or writing single selections do not apply.
+      std::string outtype = m_pars["outtype"];
+      bool skipAhead = m_pars["skipahead"];
+      int nthreads = m_pars["nthreads"];
+      if (outtype == "selection" || outtype == "SELECTION" || skipAhead ||
+          nthreads > 0) {
+         throw std::runtime_error("The outtype=selection, skipahead, and "
+                                  "nthreads options cannot be used with "
+                                  "a selections file.");
+      }
+// Write the outfile selection and those listed in selectionFile in
+// one pass over the input files.
+      std::vector<Selection> selections(1);
+      selections.front().outfile = m_outputFile;
+      selections.front().pars = CutController::parMap(pars);
+      readSelections(selectionFile, selections);
+      copySelections(selections, evtable);
+      formatter.info() << "Done." << std::endl;
+      return;
+   }
+
    CutController * cuts = 
       CutController::instance(pars, m_inputFiles, evtable);
+
+   std::string outtype = m_pars["outtype"];
+   if (outtype == "selection" || outtype == "SELECTION") {
+// Write the row ranges of the events that pass the cuts instead of
+// copying the events.
+      writeSelection(evtable, *cuts);
+      CutController::delete_instance();
+      formatter.info() << "Done." << std::endl;
+      return;
+   }
+
    copyTable(evtable, cuts);
-   copyGtis();
-   cuts->updateGti(m_outputFile);
+   copyGtis(*cuts, m_outputFile);
    CutController::delete_instance();
 
    double tmin, tmax;
@@ -175,7 +298,7 @@ void DataFilter::run() {
          m_tstart = std::max(m_tstart, tmin);
          m_tstop = std::min(m_tstop, tmax);
       }
-      writeDateKeywords();
+      writeDateKeywords(m_outputFile);
    }
 
    st_facilities::FitsUtil::writeChecksums(m_outputFile);
@@ -183,18 +306,18 @@ void DataFilter::run() {
    formatter.info() << "Done." << std::endl;
 }
 
-void DataFilter::writeDateKeywords() const {
-   tip::Image * phdu(tip::IFileSvc::instance().editImage(m_outputFile, ""));
+void DataFilter::writeDateKeywords(const std::string & outfile) const {
+   tip::Image * phdu(tip::IFileSvc::instance().editImage(outfile, ""));
    st_facilities::Util::writeDateKeywords(phdu, m_tstart, m_tstop, false);
    delete phdu;
 
    std::string evtable = m_pars["evtable"];
    tip::Table * table
-      = tip::IFileSvc::instance().editTable(m_outputFile, evtable);
+      = tip::IFileSvc::instance().editTable(outfile, evtable);
    st_facilities::Util::writeDateKeywords(table, m_tstart, m_tstop);
    delete table;
 
-   table = tip::IFileSvc::instance().editTable(m_outputFile, "GTI");
+   table = tip::IFileSvc::instance().editTable(outfile, "GTI");
    st_facilities::Util::writeDateKeywords(table, m_tstart, m_tstop);
    delete table;
 }
@@ -209,7 +332,27 @@ void DataFilter::copyTable(const std::string & extension,
                        << filterString << std::endl;
    }
 
-   if (m_inputFiles.size() == 1) { // use cfitsio directly
+   std::string columns = m_pars["columns"];
+   std::vector<std::string> colnames;
+   ColumnProjection::parseColumns(columns, colnames);
+   if (cuts) {
+      ColumnProjection::addCutColumns(cuts->cuts(), colnames);
+   }
+   ColumnProjection projection(m_inputFiles.front(), extension, colnames);
+
+   bool skipAhead = m_pars["skipahead"];
+   int nthreads = m_pars["nthreads"];
+   bool compress = m_pars["compress"];
+   if (cuts && (cuts->compressed() || compress)) {
+// Tile-compressed tables are read, and written, a tile at a time.
+      copyCompressedTables(extension, filterString, *cuts, projection);
+   } else if (m_inputFiles.size() == 1 && cuts && 
+       (skipAhead || nthreads > 0 || projection.active()) &&
+       copyCandidateRows(extension, filterString, *cuts, projection)) {
+// Only the rows that can pass the cuts were read, and only the
+// requested columns were written.
+   } else if (m_inputFiles.size() == 1 && !projection.active()) {
+// use cfitsio directly
       st_facilities::FitsUtil::fcopy(m_inputFiles.at(0), m_outputFile,
                                      extension, filterString, 
                                      m_pars["clobber"]);
@@ -221,28 +364,38 @@ void DataFilter::copyTable(const std::string & extension,
       header["TSTART"].get(m_tstart);
       header["TSTOP"].get(m_tstop);
       delete inputTable;
-   } else { // handle multiple input files using tip
+   } else { // handle multiple input files, or a projection, using tip
       // New schema : try to ensure that each (input) file is opened only
       // once. We don't know the size of the output file in advance so we grow
       // it as we go along. First file is handled differently from others,
-      // using fcopy as above. Others are read using tip.
+      // using fcopy as above, unless columns are dropped. Others are read
+      // using tip.
       
       std::vector<std::string>::const_iterator infile(m_inputFiles.begin());
       tip::Index_t nrows(0);
       tip::Index_t nsize(0);
 
-      st_facilities::FitsUtil::fcopy(*infile, m_outputFile,
-				     extension, filterString, 
-				     m_pars["clobber"]);
+      if (projection.active()) {
+// The other columns are removed while the output table is empty, and
+// the rows of every file, including the first, are copied by tip.
+         prepareOutputFile(m_outputFile);
+         projection.removeColumns(m_outputFile, extension);
+      } else {
+         st_facilities::FitsUtil::fcopy(*infile, m_outputFile,
+                                        extension, filterString, 
+                                        m_pars["clobber"]);
+      }
       // Get TSTART and TSTOP from copy in output file as it is quicker
       // than reopening the input file.
       tip::Table * outputTable 
 	= tip::IFileSvc::instance().editTable(m_outputFile, extension);
-      tip::Header & outputHeader(outputTable->getHeader());
-      outputHeader["TSTART"].get(m_tstart);
-      outputHeader["TSTOP"].get(m_tstop);
-      nsize = nrows = outputTable->getNumRecords();	  
-      infile++;
+      if (!projection.active()) {
+         tip::Header & outputHeader(outputTable->getHeader());
+         outputHeader["TSTART"].get(m_tstart);
+         outputHeader["TSTOP"].get(m_tstop);
+         nsize = nrows = outputTable->getNumRecords();	  
+         infile++;
+      }
 
       tip::Table::Iterator outputIt = outputTable->end();
       tip::Table::Record & output = *outputIt;
@@ -276,8 +429,13 @@ void DataFilter::copyTable(const std::string & extension,
          double tstart, tstop;
          header["TSTART"].get(tstart);
          header["TSTOP"].get(tstop);
-	 m_tstart = std::min(m_tstart, tstart);
-	 m_tstop = std::max(m_tstop, tstop);
+         if (infile == m_inputFiles.begin()) {
+            m_tstart = tstart;
+            m_tstop = tstop;
+         } else {
+            m_tstart = std::min(m_tstart, tstart);
+            m_tstop = std::max(m_tstop, tstop);
+         }
 
          tip::Table::ConstIterator inputIt = inputTable->begin();
          tip::ConstTableRecord & input = *inputIt;
@@ -306,11 +464,458 @@ void DataFilter::copyTable(const std::string & extension,
    delete outputTable;
 }
 
-void DataFilter::copyGtis() const {
+tip::Index_t DataFilter::candidateRows(const std::string & extension,
+                                       const CutController & cuts,
+                                       std::vector<RowRange_t> & ranges)
+   const {
+   const std::string & infile(m_inputFiles.front());
+   bool skipAhead = m_pars["skipahead"];
+   TimePlanner planner(cuts.cuts());
+   planner.addGti(Gti(infile));
+
+   const tip::Table * inputTable 
+      = tip::IFileSvc::instance().readTable(infile, extension);
+   tip::Index_t nrows(inputTable->getNumRecords());
+   const tip::Header & header(inputTable->getHeader());
+   header["TSTART"].get(m_tstart);
+   header["TSTOP"].get(m_tstop);
+
+   ranges.assign(1, RowRange_t(0, nrows));
+   if (!skipAhead) {
+      delete inputTable;
+      return nrows;
+   }
+
+// Skip the blocks of rows that the sidecar index, if any, shows
+// cannot pass the cuts.  The block summaries are exact whatever the
+// order of the rows, so they also apply the time cuts.
+   std::string indexFile(EventIndex::sidecarName(infile));
+   bool indexed(false);
+   if (st_facilities::Util::fileExists(indexFile)) {
+      EventIndex index(indexFile);
+      if (index.matches(*inputTable)) {
+         std::vector<RowRange_t> blocks;
+         index.rowRanges(cuts.cuts(), blocks);
+         intersectRanges(ranges, blocks);
+         indexed = true;
+      } else {
+         st_stream::StreamFormatter formatter("DataFilter",
+                                              "copyCandidateRows", 2);
+         formatter.warn() << "The index file " << indexFile << " does not "
+                          << "match " << infile << " and will be ignored."
+                          << std::endl;
+      }
+   }
+
+// Otherwise, find the rows within the time cuts by binary search of
+// the TIME column.  This requires the events to be sorted in time,
+// which skipahead asserts and which is only spot-checked here.
+   if (!indexed && planner.restricted()) {
+      if (TimePlanner::isSorted(*inputTable)) {
+         planner.rowRanges(*inputTable, ranges);
+      } else {
+         st_stream::StreamFormatter formatter("DataFilter",
+                                              "copyCandidateRows", 2);
+         formatter.warn() << "The events in " << infile << " are not "
+                          << "sorted in time, so the time cuts will be "
+                          << "applied to all rows." << std::endl;
+      }
+   }
+   delete inputTable;
+   return nrows;
+}
+
+bool DataFilter::copyCandidateRows(const std::string & extension,
+                                   const std::string & filterString,
+                                   const CutController & cuts,
+                                   const ColumnProjection & projection)
+   const {
+   const std::string & infile(m_inputFiles.front());
+// Rows are copied as raw bytes, which would not copy the heap of a
+// table with variable-length columns.
+   if (RowLayout(infile, extension).hasVariableLength()) {
+      return false;
+   }
+   std::vector<RowRange_t> ranges;
+   tip::Index_t nrows(candidateRows(extension, cuts, ranges));
+
+   tip::Index_t ncandidates(0);
+   for (size_t i(0); i < ranges.size(); i++) {
+      ncandidates += ranges[i].second - ranges[i].first;
+   }
+
+// Overlap the reading, filtering, and writing of the rows if worker
+// threads were requested and the cuts can be applied to the raw rows.
+   int nthreads = m_pars["nthreads"];
+   std::unique_ptr<FilterPipeline> pipeline;
+   if (nthreads > 0) {
+      pipeline.reset(new FilterPipeline(infile, extension, cuts.cuts(),
+                                        nthreads));
+      if (!pipeline->supported()) {
+         st_stream::StreamFormatter formatter("DataFilter",
+                                              "copyCandidateRows", 2);
+         formatter.warn() << "The cuts cannot be applied by the filtering "
+                          << "threads, so nthreads will be ignored."
+                          << std::endl;
+         pipeline.reset();
+      }
+   }
+   if (ncandidates == nrows && pipeline.get() == 0 && !projection.active()) {
+      return false;
+   }
+   st_stream::StreamFormatter formatter("DataFilter", "copyCandidateRows", 3);
+   formatter.info() << "Filtering " << ncandidates << " of " << nrows 
+                    << " candidate rows." << std::endl;
+
+   prepareOutputFile(m_outputFile);
+// Removing the other columns from the empty output table is cheap.
+   projection.removeColumns(m_outputFile, extension);
+   if (pipeline.get() != 0) {
+      if (projection.active()) {
+         pipeline->setProjection(&projection);
+      }
+      std::string schedule = m_pars["schedule"];
+      if (schedule == "chunks" || schedule == "CHUNKS") {
+         pipeline->runChunked(ranges, m_outputFile);
+      } else {
+         pipeline->run(ranges, m_outputFile);
+      }
+      return true;
+   }
+
+   CompressedTable input(infile, extension);
+   input.appendRows(m_outputFile, filterString, ranges, &projection);
+   return true;
+}
+
+void DataFilter::copyCompressedTables(const std::string & extension,
+                                      const std::string & filterString,
+                                      const CutController & cuts,
+                                      const ColumnProjection & projection)
+   const {
+   bool skipAhead = m_pars["skipahead"];
+   int nthreads = m_pars["nthreads"];
+   bool compress = m_pars["compress"];
+   if (nthreads > 0 || (skipAhead && cuts.compressed())) {
+      st_stream::StreamFormatter formatter("DataFilter",
+                                           "copyCompressedTables", 2);
+      formatter.warn() << "The event tables are tile-compressed, so "
+                       << (cuts.compressed() && skipAhead ? "skipahead and "
+                           : "")
+                       << "nthreads will be ignored." << std::endl;
+   }
+// Rows are copied as raw bytes, which would not copy the heap of a
+// table with variable-length columns.
+   if (RowLayout(m_inputFiles.front(), extension).hasVariableLength()) {
+      throw std::runtime_error("Tile-compressed event tables with "
+                               "variable-length columns are not "
+                               "supported.");
+   }
+
+   std::unique_ptr<CompressedTable::Writer> output;
+   for (size_t i(0); i < m_inputFiles.size(); i++) {
+      CompressedTable input(m_inputFiles[i], extension);
+      if (input.rowSize() != projection.inputRowSize()) {
+         throw std::runtime_error("The event table of " + m_inputFiles[i]
+                                  + " does not have the same columns "
+                                  + "as that of " + m_inputFiles.front()
+                                  + ".");
+      }
+      if (i == 0) {
+// The output is made from the first table, and the other columns are
+// removed while it is still empty.  Compressing the empty table is
+// cheap, and the rows are then compressed as they are appended.
+         clobberOutputFile(m_outputFile);
+         input.createFile(m_outputFile);
+         projection.removeColumns(m_outputFile, extension);
+         if (compress) {
+            CompressedTable::compress(m_outputFile, extension);
+         }
+         output.reset(new CompressedTable::Writer(m_outputFile, extension));
+      }
+// The candidate rows are found through tip, which can only read an
+// uncompressed table.
+      std::vector<RowRange_t> ranges(1, RowRange_t(0, input.getNumRecords()));
+      if (m_inputFiles.size() == 1 && skipAhead && !input.compressed()) {
+         candidateRows(extension, cuts, ranges);
+      }
+      input.appendRows(*output, filterString, ranges, &projection);
+
+// The header keywords of a compressed table are those of the
+// original table.
+      const tip::Table * inputTable 
+         = tip::IFileSvc::instance().readTable(m_inputFiles[i], extension);
+      const tip::Header & header(inputTable->getHeader());
+      double tstart, tstop;
+      header["TSTART"].get(tstart);
+      header["TSTOP"].get(tstop);
+      delete inputTable;
+      if (i == 0) {
+         m_tstart = tstart;
+         m_tstop = tstop;
+      } else {
+         m_tstart = std::min(m_tstart, tstart);
+         m_tstop = std::max(m_tstop, tstop);
+      }
+   }
+   output->close();
+}
+
+void DataFilter::writeSelection(const std::string & extension,
+                                const CutController & cuts) const {
+   if (m_inputFiles.size() != 1) {
+      throw std::runtime_error("A selection can only be written for a "
+                               "single input file.");
+   }
+   const std::string & infile(m_inputFiles.front());
+// The rows of a tile-compressed table are numbered as uncompressed,
+// and the candidate rows are found through tip, which can only read
+// an uncompressed table.
+   CompressedTable input(infile, extension);
+   std::vector<RowRange_t> ranges(1, RowRange_t(0, input.getNumRecords()));
+   if (!input.compressed()) {
+      candidateRows(extension, cuts, ranges);
+   }
+   RowSelection selection(input);
+
+// Apply the same filter expression as for a copy of the events, so
+// that the selection has exactly the rows that would be copied.
+   std::string filterString(cuts.filterString());
+   const tip::Index_t chunkSize(10000);
+   std::vector<char> rowStatus;
+   for (size_t i(0); i < ranges.size(); i++) {
+      for (tip::Index_t first(ranges[i].first); first < ranges[i].second;
+           first += chunkSize) {
+         tip::Index_t nchunk(std::min(chunkSize, ranges[i].second - first));
+         if (input.findRows(filterString, first, nchunk, rowStatus) == 0) {
+            continue;
+         }
+         for (tip::Index_t j(0); j < nchunk; j++) {
+            if (rowStatus[j]) {
+               selection.addRow(first + j);
+            }
+         }
+      }
+   }
+
+   Gti gti(infile);
+   cuts.applyTimeRangeCuts(gti);
+   selection.write(m_outputFile, cuts.cuts(), gti, infile, extension);
+   st_facilities::FitsUtil::writeChecksums(m_outputFile);
+
+   st_stream::StreamFormatter formatter("DataFilter", "writeSelection", 2);
+   formatter.info() << "Selected " << selection.numSelected() << " rows in "
+                    << selection.ranges().size() << " ranges." << std::endl;
+}
+
+void DataFilter::copyGtis(const CutController & cuts,
+                          const std::string & outfile) const {
+// Form the union of the input GTIs and apply the TIME range cuts in
+// memory so that the output GTI extension is written only once.
    Gti gti(m_inputFiles.front());
    for (size_t i(1); i < m_inputFiles.size(); i++) {
       Gti my_gti(m_inputFiles.at(i));
       gti |= my_gti;
    }
-   gti.writeExtension(m_outputFile);
+   cuts.applyTimeRangeCuts(gti);
+   gti.writeExtension(outfile);
+}
+
+void DataFilter::readSelections(const std::string & selectionFile,
+                                std::vector<Selection> & selections) const {
+// Each line gives an output file followed by par=value entries for
+// the parameters that differ from the gtselect parameters, e.g.,
+//
+//    roi_3c279.fits ra=194.05 dec=-5.79 rad=10
+//
+// INDEF may be given to remove a cut.
+   std::vector<std::string> lines;
+   st_facilities::Util::readLines(selectionFile, lines, "#", true);
+   const CutController::ParMap basePars(selections.front().pars);
+   for (size_t i(0); i < lines.size(); i++) {
+      std::vector<std::string> tokens;
+      facilities::Util::stringTokenize(lines[i], " \t", tokens);
+      if (tokens.empty() || tokens.front() == "") {
+         continue;
+      }
+      Selection selection;
+      selection.outfile = tokens.front();
+      facilities::Util::expandEnvVar(&selection.outfile);
+      selection.pars = basePars;
+      for (size_t j(1); j < tokens.size(); j++) {
+         std::vector<std::string> par;
+         facilities::Util::stringTokenize(tokens[j], "=", par);
+         if (par.size() != 2 || !CutController::isParName(par[0])) {
+            throw std::runtime_error("Invalid entry, " + tokens[j] 
+                                     + ", in selection file " 
+                                     + selectionFile);
+         }
+         if (par[1] == "INDEF") {
+            selection.pars.erase(par[0]);
+         } else {
+            selection.pars[par[0]] = std::atof(par[1].c_str());
+         }
+      }
+      selections.push_back(selection);
+   }
+}
+
+void DataFilter::prepareOutputFile(const std::string & outfile) const {
+   clobberOutputFile(outfile);
+// The new file has the structure of the input, with no rows.
+   tip::IFileSvc::instance().createFile(outfile, m_inputFiles.front());
+}
+
+void DataFilter::clobberOutputFile(const std::string & outfile) const {
+   if (st_facilities::Util::fileExists(outfile)) {
+      bool clobber = m_pars["clobber"];
+      if (!clobber) {
+         throw std::runtime_error("Output file, " + outfile + ", already "
+                                  + "exists, and you have specified "
+                                  + "'clobber' as 'no'.");
+      }
+      std::remove(outfile.c_str());
+   }
+}
+
+void DataFilter::copySelections(const std::vector<Selection> & selections,
+                                const std::string & extension) const {
+   st_stream::StreamFormatter formatter("DataFilter", "copySelections", 2);
+   size_t nsel(selections.size());
+
+   std::vector<std::unique_ptr<CutController> > controllers;
+   for (size_t k(0); k < nsel; k++) {
+      controllers.push_back(std::unique_ptr<CutController>(
+         new CutController(selections[k].pars, m_inputFiles, extension)));
+   }
+// Tile-compressed tables, which tip cannot read, are read and
+// written through CompressedTable.
+   bool compress = m_pars["compress"];
+   bool compressed(controllers.front()->compressed() || compress);
+   if (compressed && RowLayout(m_inputFiles.front(), extension)
+       .hasVariableLength()) {
+      throw std::runtime_error("Tile-compressed event tables with "
+                               "variable-length columns are not "
+                               "supported.");
+   }
+
+// Cuts shared by all of the selections are applied once by cfitsio
+// as the input is read, and only events passing at least one of the
+// selections are read.
+   std::vector<Cuts> selectionCuts;
+   for (size_t k(0); k < nsel; k++) {
+      selectionCuts.push_back(controllers[k]->cuts());
+   }
+   SelectionSplitter splitter(selectionCuts);
+   std::string filterString(splitter.filterString());
+   if (filterString != "") {
+      filterString += " && ";
+   }
+   filterString += "gtifilter()";
+   st_stream::StreamFormatter info("DataFilter", "copySelections", 3);
+   info.info() << "Applying filter string: " << filterString << std::endl;
+
+// The other columns are removed while the output tables are empty.
+// The rows are copied by tip, which copies only the fields of the
+// output table, or are projected as raw bytes.
+   std::string columns = m_pars["columns"];
+   std::vector<std::string> colnames;
+   ColumnProjection::parseColumns(columns, colnames);
+   for (size_t k(0); k < nsel; k++) {
+      ColumnProjection::addCutColumns(selectionCuts[k], colnames);
+   }
+   ColumnProjection projection(m_inputFiles.front(), extension, colnames);
+
+   std::vector<tip::Table *> outputTables;
+   std::vector<std::unique_ptr<CompressedTable::Writer> > writers;
+   std::vector<CompressedTable::Writer *> outputs;
+   for (size_t k(0); k < nsel; k++) {
+      const std::string & outfile(selections[k].outfile);
+      if (!compressed) {
+         prepareOutputFile(outfile);
+         projection.removeColumns(outfile, extension);
+         outputTables.push_back(tip::IFileSvc::instance()
+                                .editTable(outfile, extension));
+         continue;
+      }
+      clobberOutputFile(outfile);
+      CompressedTable(m_inputFiles.front(), extension).createFile(outfile);
+      projection.removeColumns(outfile, extension);
+      if (compress) {
+         CompressedTable::compress(outfile, extension);
+      }
+      writers.push_back(std::unique_ptr<CompressedTable::Writer>
+                        (new CompressedTable::Writer(outfile, extension)));
+      outputs.push_back(writers.back().get());
+   }
+   std::vector<tip::Index_t> nrows(nsel, 0);
+
+   for (size_t ifile(0); ifile < m_inputFiles.size(); ifile++) {
+// Only the header is read by tip if the rows are copied through
+// CompressedTable.
+      const tip::Table * inputTable 
+         = tip::IFileSvc::instance().readTable(m_inputFiles[ifile],
+                                               extension,
+                                               compressed ? "" : filterString);
+      const tip::Header & header(inputTable->getHeader());
+      double tstart, tstop;
+      header["TSTART"].get(tstart);
+      header["TSTOP"].get(tstop);
+      if (ifile == 0) {
+         m_tstart = tstart;
+         m_tstop = tstop;
+      } else {
+         m_tstart = std::min(m_tstart, tstart);
+         m_tstop = std::max(m_tstop, tstop);
+      }
+      if (!compressed) {
+         splitter.copyRows(*inputTable, outputTables, nrows);
+         delete inputTable;
+         continue;
+      }
+      delete inputTable;
+      CompressedTable input(m_inputFiles[ifile], extension);
+      if (input.rowSize() != projection.inputRowSize()) {
+         throw std::runtime_error("The event table of " + m_inputFiles[ifile]
+                                  + " does not have the same columns "
+                                  + "as that of " + m_inputFiles.front()
+                                  + ".");
+      }
+      splitter.appendRows(input, filterString, outputs, &projection);
+   }
+   for (size_t k(0); k < writers.size(); k++) {
+      writers[k]->close();
+      nrows[k] = writers[k]->numRecords();
+      outputTables.push_back(tip::IFileSvc::instance()
+                             .editTable(selections[k].outfile, extension));
+   }
+
+   for (size_t k(0); k < nsel; k++) {
+      controllers[k]->writeDssKeywords(outputTables[k]->getHeader());
+      outputTables[k]->getHeader().addHistory("Filter string: " 
+                                              + controllers[k]
+                                              ->filterString());
+      delete outputTables[k];
+   }
+
+   double tstart(m_tstart);
+   double tstop(m_tstop);
+   for (size_t k(0); k < nsel; k++) {
+      const std::string & outfile(selections[k].outfile);
+      copyGtis(*controllers[k], outfile);
+      const CutController::ParMap & pars(selections[k].pars);
+      CutController::ParMap::const_iterator tmin(pars.find("tmin"));
+      CutController::ParMap::const_iterator tmax(pars.find("tmax"));
+      m_tstart = tstart;
+      m_tstop = tstop;
+      if (tmin != pars.end() && tmax != pars.end() &&
+          (tmin->second != 0 || tmax->second != 0)) {
+         m_tstart = std::max(tstart, tmin->second);
+         m_tstop = std::min(tstop, tmax->second);
+      }
+      writeDateKeywords(outfile);
+      st_facilities::FitsUtil::writeChecksums(outfile);
+      formatter.info() << "Wrote " << nrows[k] << " events to " 
+                       << outfile << std::endl;
+   }
 }
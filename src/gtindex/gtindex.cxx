@@ -0,0 +1,111 @@
+/**
+ * @file gtindex.cxx
+ * @brief Write a sidecar index of block summaries for an event file.
+ * @author agent
+ *
+ * $Header$
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include "st_stream/StreamFormatter.h"
+
+#include "st_app/AppParGroup.h"
+#include "st_app/StApp.h"
+#include "st_app/StAppFactory.h"
+
+#include "facilities/Util.h"
+
+#include "tip/IFileSvc.h"
+#include "tip/Table.h"
+
+#include "st_facilities/Util.h"
+
+#include "dataSubselector/EventIndex.h"
+
+class EventIndexApp : public st_app::StApp {
+
+public:
+
+   EventIndexApp() : st_app::StApp(),
+                     m_pars(st_app::StApp::getParGroup("gtindex")) {
+      try {
+         setVersion(s_cvs_id);
+      } catch (std::exception & eObj) {
+         std::cerr << eObj.what() << std::endl;
+         std::exit(1);
+      } catch (...) {
+         std::cerr << "Caught unknown exception in EventIndexApp constructor."
+                   << std::endl;
+         std::exit(1);
+      }
+   }
+
+   virtual ~EventIndexApp() throw() {
+      try {
+      } catch (std::exception &eObj) {
+         std::cerr << eObj.what() << std::endl;
+      } catch (...) {
+      }
+   }
+
+   virtual void run();
+
+   virtual void banner() const;
+
+private:
+
+   st_app::AppParGroup & m_pars;
+
+   static std::string s_cvs_id;
+};
+
+std::string EventIndexApp::s_cvs_id("$Name$");
+
+st_app::StAppFactory<EventIndexApp> myAppFactory("gtindex");
+
+void EventIndexApp::banner() const {
+   int verbosity = m_pars["chatter"];
+   if (verbosity > 2) {
+      st_app::StApp::banner();
+   }
+}
+
+void EventIndexApp::run() {
+   m_pars.Prompt();
+   m_pars.Save();
+   std::string evfile = m_pars["evfile"];
+   std::string evtable = m_pars["evtable"];
+   std::string outfile = m_pars["outfile"];
+   int blocksize = m_pars["blocksize"];
+   double pixsize = m_pars["pixsize"];
+   bool clobber = m_pars["clobber"];
+
+   facilities::Util::expandEnvVar(&evfile);
+   facilities::Util::expandEnvVar(&outfile);
+   if (outfile == "DEFAULT" || outfile == "default") {
+      outfile = dataSubselector::EventIndex::sidecarName(evfile);
+   }
+   if (!clobber && st_facilities::Util::fileExists(outfile)) {
+      throw std::runtime_error("Output file, " + outfile + ", already "
+                               + "exists, and you have specified "
+                               + "'clobber' as 'no'.");
+   }
+
+   std::unique_ptr<const tip::Table>
+      events(tip::IFileSvc::instance().readTable(evfile, evtable));
+   dataSubselector::EventIndex index(*events, blocksize, pixsize);
+   index.write(outfile);
+
+   st_stream::StreamFormatter formatter("EventIndexApp", "run", 2);
+   if (!index.matches(*events)) {
+      formatter.warn() << evfile << " has no DATASUM keyword, so the "
+                       << "index will not be used.  Run fchecksum on "
+                       << "it first." << std::endl;
+   }
+   formatter.info() << "Wrote " << index.blocks().size()
+                    << " block summaries to " << outfile << std::endl;
+}
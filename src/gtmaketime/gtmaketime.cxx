@@ -28,10 +28,12 @@
 #include "st_facilities/FitsUtil.h"
 #include "st_facilities/Util.h"
 
+#include "dataSubselector/CompressedTable.h"
 #include "dataSubselector/Cuts.h"
 #include "dataSubselector/Gti.h"
 #include "dataSubselector/GtiCut.h"
 #include "dataSubselector/RangeCut.h"
+#include "dataSubselector/RowLayout.h"
 #include "dataSubselector/SkyConeCut.h"
 
 /**
@@ -152,9 +154,9 @@ std::string MakeTime::roiZenAngleCut() {
 
    double zmax(180);
    for (size_t i(0); i < cuts.size(); i++) {
-      if (cuts[i].type() == "range") {
+      if (cuts[i].kind() == dataSubselector::CutBase::RANGE) {
          const dataSubselector::RangeCut & rangeCut
-            = dynamic_cast<dataSubselector::RangeCut &>(const_cast<dataSubselector::CutBase &>(cuts[i]));
+            = static_cast<const dataSubselector::RangeCut &>(cuts[i]);
          if (rangeCut.colname() == "ZENITH_ANGLE") {
             zmax = rangeCut.maxVal();
          }
@@ -163,9 +165,9 @@ std::string MakeTime::roiZenAngleCut() {
 
    if (zmax < 180) {
       for (size_t i(0); i < cuts.size(); i++) {
-         if (cuts[i].type() == "SkyCone") {
+         if (cuts[i].kind() == dataSubselector::CutBase::SKYCONE) {
             const dataSubselector::SkyConeCut & skyConeCut
-               = dynamic_cast<dataSubselector::SkyConeCut &>(const_cast<dataSubselector::CutBase &>(cuts[i]));
+               = static_cast<const dataSubselector::SkyConeCut &>(cuts[i]);
             
             std::ostringstream filter;
             filter << " && angsep(RA_ZENITH,DEC_ZENITH," 
@@ -305,8 +307,27 @@ void MakeTime::copyTable() const {
    std::string extension = m_pars["evtable"];
    std::string filterString("gtifilter(\"" + gtifile + "\")");
 
-   st_facilities::FitsUtil::fcopy(m_evfile, m_outfile, extension,
-                                  filterString, m_pars["clobber"]);
+// Tile-compressed event tables are read, and written, a tile at a
+// time.  The output table is compressed while it is still empty, so
+// that the rows are compressed as they are appended.
+   bool compress = m_pars["compress"];
+   dataSubselector::CompressedTable evTable(m_evfile, extension);
+   if (evTable.compressed() || compress) {
+      if (dataSubselector::RowLayout(m_evfile, extension)
+          .hasVariableLength()) {
+         throw std::runtime_error("Tile-compressed event tables with "
+                                  "variable-length columns are not "
+                                  "supported.");
+      }
+      evTable.createFile(m_outfile);
+      if (compress) {
+         dataSubselector::CompressedTable::compress(m_outfile, extension);
+      }
+      evTable.appendRows(m_outfile, filterString);
+   } else {
+      st_facilities::FitsUtil::fcopy(m_evfile, m_outfile, extension,
+                                     filterString, m_pars["clobber"]);
+   }
    m_gti.writeExtension(m_outfile);
 
    st_facilities::FitsUtil::writeChecksums(m_outfile);
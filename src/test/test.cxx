@@ -13,8 +13,13 @@
 #include <cmath>
 #include <cstdio>
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
 
 #include <cppunit/ui/text/TextTestRunner.h>
 #include <cppunit/extensions/HelperMacros.h>
@@ -25,12 +30,32 @@
 
 #include "facilities/commonUtilities.h"
 
+#include "fitsio.h"
+
 #include "tip/IFileSvc.h"
 #include "tip/Table.h"
 
 #include "dataSubselector/BitMaskCut.h"
+#include "dataSubselector/BoundedQueue.h"
+#include "dataSubselector/ChunkScheduler.h"
+#include "dataSubselector/ColumnProjection.h"
+#include "dataSubselector/CompressedTable.h"
+#include "dataSubselector/ConeIndex.h"
+#include "dataSubselector/CutController.h"
 #include "dataSubselector/Cuts.h"
+#include "dataSubselector/EventIndex.h"
+#include "dataSubselector/FilterPipeline.h"
 #include "dataSubselector/Gti.h"
+#include "dataSubselector/GtiCut.h"
+#include "dataSubselector/IrfIndex.h"
+#include "dataSubselector/RangeSetCut.h"
+#include "dataSubselector/RowLayout.h"
+#include "dataSubselector/RowSelection.h"
+#include "dataSubselector/SchemaCuts.h"
+#include "dataSubselector/SelectionSplitter.h"
+#include "dataSubselector/SelectionStore.h"
+#include "dataSubselector/StaticCuts.h"
+#include "dataSubselector/TimePlanner.h"
 #include "dataSubselector/VersionCut.h"
 
 class DssTests : public CppUnit::TestFixture {
@@ -40,6 +65,8 @@ class DssTests : public CppUnit::TestFixture {
    CPPUNIT_TEST(test_accept2);
    CPPUNIT_TEST(compareGtis);
    CPPUNIT_TEST(updateGti);
+   CPPUNIT_TEST(writeGtiExtension);
+   CPPUNIT_TEST(readUnsortedGti);
    CPPUNIT_TEST(combineGtis);
    CPPUNIT_TEST(compareCuts);
    CPPUNIT_TEST(compareCutsWithoutGtis);
@@ -51,9 +78,28 @@ class DssTests : public CppUnit::TestFixture {
    CPPUNIT_TEST(test_removeRangeCuts);
    CPPUNIT_TEST(test_mergeRangeCuts);
    CPPUNIT_TEST(test_BitMaskCut);
+   CPPUNIT_TEST(test_validityMaskFiles);
    CPPUNIT_TEST(test_VersionCut);
    CPPUNIT_TEST(test_irfName);
+   CPPUNIT_TEST(test_IrfIndex);
    CPPUNIT_TEST(test_rangeCut);
+   CPPUNIT_TEST(test_StaticCuts);
+   CPPUNIT_TEST(test_moveCuts);
+   CPPUNIT_TEST(test_SchemaCuts);
+   CPPUNIT_TEST(test_boundRangeCut);
+   CPPUNIT_TEST(test_RangeSetCut);
+   CPPUNIT_TEST(test_ConeIndex);
+   CPPUNIT_TEST(test_TimePlanner);
+   CPPUNIT_TEST(test_EventIndex);
+   CPPUNIT_TEST(test_BoundedQueue);
+   CPPUNIT_TEST(test_ChunkScheduler);
+   CPPUNIT_TEST(test_RowSelection);
+   CPPUNIT_TEST(test_SelectionStore);
+   CPPUNIT_TEST(test_CompressedTable);
+   CPPUNIT_TEST(test_SelectionSplitter);
+   CPPUNIT_TEST(test_FilterPipeline);
+   CPPUNIT_TEST(test_ColumnProjection);
+   CPPUNIT_TEST(test_CutController);
 
    CPPUNIT_TEST_SUITE_END();
 
@@ -64,6 +110,8 @@ public:
    void test_accept2();
    void compareGtis();
    void updateGti();
+   void writeGtiExtension();
+   void readUnsortedGti();
    void combineGtis();
    void compareCuts();
    void compareCutsWithoutGtis();
@@ -75,9 +123,28 @@ public:
    void test_removeRangeCuts();
    void test_mergeRangeCuts();
    void test_BitMaskCut();
+   void test_validityMaskFiles();
    void test_VersionCut();
    void test_irfName();
+   void test_IrfIndex();
    void test_rangeCut();
+   void test_StaticCuts();
+   void test_moveCuts();
+   void test_SchemaCuts();
+   void test_boundRangeCut();
+   void test_RangeSetCut();
+   void test_ConeIndex();
+   void test_TimePlanner();
+   void test_EventIndex();
+   void test_BoundedQueue();
+   void test_ChunkScheduler();
+   void test_RowSelection();
+   void test_SelectionStore();
+   void test_CompressedTable();
+   void test_SelectionSplitter();
+   void test_FilterPipeline();
+   void test_ColumnProjection();
+   void test_CutController();
 
 private:
 
@@ -174,6 +241,74 @@ void DssTests::updateGti() {
    }
 }
 
+void DssTests::writeGtiExtension() {
+   std::string gtifile("gti_test.fits");
+   if (st_facilities::Util::fileExists(gtifile)) {
+      std::remove(gtifile.c_str());
+   }
+   tip::IFileSvc::instance().createFile(gtifile, m_infile);
+
+   dataSubselector::Gti gti;
+   for (size_t i(0); i < 100; i++) {
+      gti.insertInterval(10.*i, 10.*i + 5.);
+   }
+   gti.writeExtension(gtifile);
+
+   dataSubselector::Gti gti2(gtifile);
+   CPPUNIT_ASSERT(!(gti != gti2));
+
+// Overwrite with fewer intervals.
+   dataSubselector::Gti gti3 = gti.applyTimeRangeCut(0, 102.);
+   gti3.writeExtension(gtifile);
+
+   dataSubselector::Gti gti4(gtifile);
+   CPPUNIT_ASSERT(gti4.getNumIntervals() == 11);
+   CPPUNIT_ASSERT(!(gti3 != gti4));
+
+   const tip::Table * gtiTable = 
+      tip::IFileSvc::instance().readTable(gtifile, "GTI");
+   double ontime;
+   gtiTable->getHeader()["ONTIME"].get(ontime);
+   ASSERT_EQUALS(ontime, 52.);
+   delete gtiTable;
+
+   std::remove(gtifile.c_str());
+}
+
+void DssTests::readUnsortedGti() {
+   std::string gtifile("gti_test.fits");
+   if (st_facilities::Util::fileExists(gtifile)) {
+      std::remove(gtifile.c_str());
+   }
+   tip::IFileSvc::instance().createFile(gtifile, m_infile);
+
+   double intervals[4][2] = {{500, 700}, {100, 300}, {200, 400}, {800, 900}};
+   tip::Table * table = tip::IFileSvc::instance().editTable(gtifile, "GTI");
+   table->setNumRecords(4);
+   tip::Table::Iterator it = table->begin();
+   tip::Table::Record & row = *it;
+   for (size_t i(0); it != table->end(); ++it, i++) {
+      row["START"].set(intervals[i][0]);
+      row["STOP"].set(intervals[i][1]);
+   }
+   delete table;
+
+   const tip::Table * gtiTable = 
+      tip::IFileSvc::instance().readTable(gtifile, "GTI");
+   dataSubselector::Gti gti(*gtiTable);
+   delete gtiTable;
+
+   dataSubselector::Gti expected;
+   expected.insertInterval(100, 400);
+   expected.insertInterval(500, 700);
+   expected.insertInterval(800, 900);
+
+   CPPUNIT_ASSERT(gti.getNumIntervals() == 3);
+   CPPUNIT_ASSERT(!(gti != expected));
+
+   std::remove(gtifile.c_str());
+}
+
 void DssTests::cutsConstructor() {
    dataSubselector::Cuts my_cuts(m_infile, m_evtable);
 
@@ -416,6 +551,7 @@ void DssTests::mergeGtis() {
    newCuts.getGtiCuts(gtiCuts);
 
    CPPUNIT_ASSERT(gtiCuts.size() == 1);
+   CPPUNIT_ASSERT(newCuts.gtiCut() == gtiCuts.at(0));
 
    dataSubselector::Gti mergedGti;
    mergedGti.insertInterval(100., 700.);
@@ -690,6 +826,127 @@ void DssTests::test_BitMaskCut() {
    } catch (std::runtime_error &) {
       CPPUNIT_ASSERT(true);
    }
+
+   /// Cuts keep the validity masks that were current when they were
+   /// created, even if the process-wide masks are replaced.
+   dataSubselector::BitMaskCut::ValidityMasksPtr 
+      masks(dataSubselector::BitMaskCut::validityMasks());
+   CPPUNIT_ASSERT(masks);
+
+   std::ofstream outfile3(evtypeFile.c_str());
+   outfile3 << "3,3\n";
+   outfile3.close();
+   std::ofstream outfile4(evclassFile.c_str());
+   outfile4 << "128,128\n";
+   outfile4.close();
+   dataSubselector::BitMaskCut::setValidityMasks(evclassFile, evtypeFile);
+   std::remove(evclassFile.c_str());
+   std::remove(evtypeFile.c_str());
+
+   CPPUNIT_ASSERT(psf.supercedes(fb));
+   dataSubselector::BitMaskCut new_psf("EVENT_TYPE", 60, "P8");
+   try {
+      new_psf.supercedes(fb);
+      CPPUNIT_ASSERT(false);
+   } catch (std::runtime_error &) {
+   }
+   dataSubselector::BitMaskCut old_psf("EVENT_TYPE", 60, "P8", masks);
+   CPPUNIT_ASSERT(old_psf.supercedes(fb));
+
+   dataSubselector::BitMaskCut::setValidityMasks(masks);
+   CPPUNIT_ASSERT(dataSubselector::BitMaskCut::evclassValidityMasks() != 0);
+   CPPUNIT_ASSERT(dataSubselector::BitMaskCut::evtypeValidityMasks() != 0);
+
+/// A Cuts object gives its BitMaskCuts its own validity masks, e.g.,
+/// those of another CALDB root, rather than the process-wide ones.
+   outfile3.open(evtypeFile.c_str());
+   outfile3 << "3,3\n";
+   outfile3.close();
+   outfile4.open(evclassFile.c_str());
+   outfile4 << "128,128\n"
+            << "256,256\n";
+   outfile4.close();
+   dataSubselector::BitMaskCut::ValidityMasksPtr 
+      strict(new dataSubselector::BitMaskCut::ValidityMasks(evclassFile,
+                                                            evtypeFile));
+   std::remove(evclassFile.c_str());
+   std::remove(evtypeFile.c_str());
+
+   dataSubselector::Cuts strictCuts(strict);
+   CPPUNIT_ASSERT(strictCuts.validityMasks() == strict);
+   strictCuts.addBitMaskCut("EVENT_CLASS", 256, "P8");
+   CPPUNIT_ASSERT_THROW(strictCuts.findBitMaskCut()->supercedes(source),
+                        std::runtime_error);
+   dataSubselector::Cuts strictCopy(strictCuts);
+   CPPUNIT_ASSERT(strictCopy.validityMasks() == strict);
+   CPPUNIT_ASSERT_THROW(strictCopy.findBitMaskCut()->supercedes(source),
+                        std::runtime_error);
+
+   dataSubselector::Cuts defaultCuts;
+   CPPUNIT_ASSERT(!defaultCuts.validityMasks());
+   defaultCuts.addBitMaskCut("EVENT_CLASS", 256, "P8");
+   CPPUNIT_ASSERT(defaultCuts.findBitMaskCut()->supercedes(source));
+}
+
+void DssTests::test_validityMaskFiles() {
+   typedef dataSubselector::BitMaskCut::ValidityMasks ValidityMasks;
+   std::string evclassFile("evclass_validity_masks.txt");
+   std::string evtypeFile("evtype_validity_masks.txt");
+   std::ofstream evtype(evtypeFile.c_str());
+   evtype << "1,1\n";
+   evtype.close();
+
+// For a duplicated bit mask, the last entry is used.
+   std::ofstream evclass(evclassFile.c_str());
+   evclass << "# bit mask, validity mask\n"
+           << "128,1920\n"
+           << "256 , 1792\n"
+           << "128,128\n";
+   evclass.close();
+   dataSubselector::BitMaskCut::ValidityMasksPtr 
+      masks(new ValidityMasks(evclassFile, evtypeFile));
+   dataSubselector::BitMaskCut source("EVENT_CLASS", 128, "P8", masks);
+   dataSubselector::BitMaskCut clean("EVENT_CLASS", 256, "P8", masks);
+   CPPUNIT_ASSERT(clean.supercedes(dataSubselector::BitMaskCut(
+                     "EVENT_CLASS", 256, "P8", masks)));
+   CPPUNIT_ASSERT(source.supercedes(dataSubselector::BitMaskCut(
+                     "EVENT_CLASS", 128, "P8", masks)));
+   CPPUNIT_ASSERT_THROW(clean.supercedes(source), std::runtime_error);
+
+// Lines without a comma-separated pair of masks are rejected.
+   const char * malformed[] = {"128 1920\n", "128\n", ",1920\n"};
+   for (size_t i(0); i < 3; i++) {
+      evclass.open(evclassFile.c_str());
+      evclass << "256,1792\n" << malformed[i];
+      evclass.close();
+      CPPUNIT_ASSERT_THROW(ValidityMasks(evclassFile, evtypeFile),
+                           std::runtime_error);
+   }
+   std::remove(evclassFile.c_str());
+   std::remove(evtypeFile.c_str());
+}
+
+namespace {
+/// A cut defined outside of this package that uses the type string
+/// of one of its cut classes.
+class ExternalCut : public dataSubselector::CutBase {
+public:
+   ExternalCut() : CutBase("range") {}
+   virtual bool accept(tip::ConstTableRecord &) const {return true;}
+   virtual bool accept(const std::map<std::string, double> &) const {
+      return true;
+   }
+   virtual ExternalCut * clone() const {return new ExternalCut(*this);}
+protected:
+   virtual bool equals(const CutBase &) const {return true;}
+   virtual void getKeyValues(std::string & type, std::string & unit,
+                             std::string & value, std::string & ref) const {
+      type = "range";
+      unit = "MeV";
+      value = "100:1000";
+      ref = "";
+   }
+};
 }
 
 void DssTests::test_VersionCut() {
@@ -706,9 +963,24 @@ void DssTests::test_VersionCut() {
    CPPUNIT_ASSERT(!(new_cut == cut));
    CPPUNIT_ASSERT(new_cut.supercedes(cut));
    CPPUNIT_ASSERT(new_cut.type() == "version");
+   CPPUNIT_ASSERT(new_cut.kind() == dataSubselector::CutBase::VERSION);
 
    dataSubselector::VersionCut cut_copy(new_cut);
    CPPUNIT_ASSERT(cut_copy.type() == "version");
+   CPPUNIT_ASSERT(dataSubselector::CutBase::kindOf("version") 
+                  == dataSubselector::CutBase::VERSION);
+   CPPUNIT_ASSERT(dataSubselector::CutBase::kindOf("foo") 
+                  == dataSubselector::CutBase::NONE);
+
+// Cuts from outside of the package are never taken for RangeCuts.
+   ExternalCut external;
+   CPPUNIT_ASSERT(external.type() == "range");
+   CPPUNIT_ASSERT(external.kind() == dataSubselector::CutBase::NONE);
+   dataSubselector::Cuts cuts;
+   cuts.addCut(external);
+   CPPUNIT_ASSERT(cuts.size() == 1);
+   CPPUNIT_ASSERT(cuts[0].kind() == dataSubselector::CutBase::NONE);
+   CPPUNIT_ASSERT(cuts.rangeCuts("ENERGY").empty());
 }
 
 void DssTests::test_irfName() {
@@ -724,6 +996,36 @@ void DssTests::test_irfName() {
    CPPUNIT_ASSERT(cuts1.conversionTypeCut()->minVal() == 1);
    CPPUNIT_ASSERT(cuts1.conversionTypeCut()->maxVal() == 1);
    CPPUNIT_ASSERT(cuts1.pass_ver() == "P7V6");
+   CPPUNIT_ASSERT(cuts1.rangeCuts("CONVERSION_TYPE").size() == 1);
+   CPPUNIT_ASSERT(cuts1.rangeCuts("ENERGY").empty());
+
+// The indices must follow copies of the Cuts object.
+   dataSubselector::Cuts cuts1_copy(cuts1);
+   CPPUNIT_ASSERT(cuts1_copy.findBitMaskCut() != 0);
+   CPPUNIT_ASSERT(cuts1_copy.findBitMaskCut() != cuts1.findBitMaskCut());
+   CPPUNIT_ASSERT(cuts1_copy.findBitMaskCut()->mask() == 4);
+   CPPUNIT_ASSERT(cuts1_copy.conversionTypeCut()->minVal() == 1);
+   CPPUNIT_ASSERT(cuts1_copy.findBitMaskCuts().size() == 1);
+   std::unique_ptr<dataSubselector::BitMaskCut> copy(cuts1.bitMaskCut());
+   CPPUNIT_ASSERT(copy.get() != cuts1.findBitMaskCut());
+   CPPUNIT_ASSERT(copy->mask() == 4);
+
+// All of the bit mask cuts are returned in the order they were applied.
+   dataSubselector::Cuts orderedCuts;
+   orderedCuts.addBitMaskCut("EVENT_TYPE", 1, "P8R2");
+   orderedCuts.addBitMaskCut("EVENT_CLASS", 4, "P8R2");
+   std::vector<const dataSubselector::BitMaskCut *> 
+      found(orderedCuts.findBitMaskCuts());
+   CPPUNIT_ASSERT(found.size() == 2);
+   CPPUNIT_ASSERT(found[0]->colname() == "EVENT_TYPE");
+   CPPUNIT_ASSERT(found[1]->colname() == "EVENT_CLASS");
+   std::vector<dataSubselector::BitMaskCut *> copies(orderedCuts.bitMaskCuts());
+   CPPUNIT_ASSERT(copies.size() == 2);
+   CPPUNIT_ASSERT(copies[0]->colname() == "EVENT_TYPE");
+   CPPUNIT_ASSERT(copies[1]->colname() == "EVENT_CLASS");
+   for (size_t i(0); i < copies.size(); i++) {
+      delete copies[i];
+   }
 
    dataSubselector::Cuts cuts2;
    cuts2.setIrfs("P7TRANSIENT_V6");
@@ -746,6 +1048,38 @@ void DssTests::test_irfName() {
    /* CPPUNIT_ASSERT(cuts5.CALDB_implied_irfs() != "P7REP_SOURCE_V10"); */
 }
 
+void DssTests::test_IrfIndex() {
+   dataSubselector::IrfIndex::IrfIndexPtr 
+      index(dataSubselector::IrfIndex::instance());
+   // The index for a given CALDB is read only once.
+   CPPUNIT_ASSERT(index == dataSubselector::IrfIndex::instance());
+
+   unsigned int mask(0);
+   CPPUNIT_ASSERT(index->mask("P7SOURCE_V6", mask));
+   CPPUNIT_ASSERT(mask == 4);
+   CPPUNIT_ASSERT(!index->mask("NOT_AN_IRF", mask));
+
+   const std::vector<std::string> & irfs(index->irfs(4));
+   CPPUNIT_ASSERT(std::find(irfs.begin(), irfs.end(), "P7SOURCE_V6")
+                  != irfs.end());
+   CPPUNIT_ASSERT(index->irfs(0).empty());
+
+   const dataSubselector::IrfIndex::IrfVersions_t & 
+      versions(index->versions("P7V6", 4));
+   CPPUNIT_ASSERT(!versions.empty());
+   CPPUNIT_ASSERT(versions.front().first >= 6);
+   CPPUNIT_ASSERT(index->latest("P7V6", 4) == versions.front().second);
+   for (size_t i(1); i < versions.size(); i++) {
+      CPPUNIT_ASSERT(versions[i-1].first >= versions[i].first);
+   }
+   CPPUNIT_ASSERT(index->versions("P7V6", 0).empty());
+   CPPUNIT_ASSERT(index->latest("NOT_A_PASS", 4) == "");
+
+   std::map<std::string, unsigned int> mapping;
+   dataSubselector::Cuts::read_bitmask_mapping(mapping);
+   CPPUNIT_ASSERT(mapping.size() == index->masks().size());
+}
+
 void DssTests::test_rangeCut() {
    dataSubselector::Cuts my_cuts;
    my_cuts.addRangeCut("CALIB_VERSION", "dimensionless", 1, 1,
@@ -755,6 +1089,1225 @@ void DssTests::test_rangeCut() {
    CPPUNIT_ASSERT(my_cuts.accept(params));
 }
 
+void DssTests::test_StaticCuts() {
+   dataSubselector::Gti gti;
+   gti.insertInterval(100., 200.);
+   gti.insertInterval(300., 400.);
+
+   dataSubselector::Cuts cuts;
+   cuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cuts.addSkyConeCut(83.57, 22.01, 10.);
+   cuts.addGtiCut(gti);
+   cuts.addBitMaskCut("EVENT_CLASS", 128, "P8R2");
+
+   typedef dataSubselector::StaticCuts<dataSubselector::RangeCut,
+                                       dataSubselector::SkyConeCut,
+                                       dataSubselector::GtiCut,
+                                       dataSubselector::BitMaskCut> Cuts4_t;
+   Cuts4_t static_cuts(cuts);
+   CPPUNIT_ASSERT(static_cuts.cuts() == cuts);
+   CPPUNIT_ASSERT(static_cuts.get<0>().colname() == "ENERGY");
+
+   const size_t nevents(6);
+   double energy[nevents] = {50., 200., 200., 200., 200., 2e5};
+   double ra[nevents] = {83., 83., 83., 120., 83., 83.};
+   double dec[nevents] = {22., 22., 22., 22., 22., 22.};
+   double time[nevents] = {150., 150., 250., 150., 350., 150.};
+   double evclass[nevents] = {128., 128 + 256., 128., 128., 64., 128.};
+   bool expected[nevents] = {false, true, false, false, false, false};
+
+   dataSubselector::ColumnBlock block(nevents);
+   block.addColumn("ENERGY", energy);
+   block.addColumn("RA", ra);
+   block.addColumn("DEC", dec);
+   block.addColumn("TIME", time);
+   block.addColumn("EVENT_CLASS", evclass);
+   std::vector<char> accepted;
+   static_cuts.accept(block, accepted);
+   CPPUNIT_ASSERT(accepted.size() == nevents);
+
+   std::map<std::string, double> params;
+   for (size_t i(0); i < nevents; i++) {
+      params["ENERGY"] = energy[i];
+      params["RA"] = ra[i];
+      params["DEC"] = dec[i];
+      params["TIME"] = time[i];
+      params["EVENT_CLASS"] = evclass[i];
+      CPPUNIT_ASSERT(cuts.accept(params) == expected[i]);
+      CPPUNIT_ASSERT(static_cuts.accept(params) == expected[i]);
+      CPPUNIT_ASSERT(static_cast<bool>(accepted[i]) == expected[i]);
+   }
+
+   // The composition must match.
+   dataSubselector::Cuts other;
+   other.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   try {
+      Cuts4_t bad(other);
+      CPPUNIT_ASSERT(false);
+   } catch (std::runtime_error &) {
+   }
+}
+
+void DssTests::test_moveCuts() {
+   dataSubselector::Gti gti;
+   gti.insertInterval(100., 200.);
+   dataSubselector::Cuts cuts;
+   cuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cuts.addGtiCut(gti);
+   dataSubselector::Cuts cuts_copy(cuts);
+
+// Moving transfers the cut objects themselves.
+   const dataSubselector::GtiCut * gti_cut(cuts.gtiCut());
+   dataSubselector::Cuts moved(std::move(cuts));
+   CPPUNIT_ASSERT(moved.gtiCut() == gti_cut);
+   CPPUNIT_ASSERT(moved == cuts_copy);
+   CPPUNIT_ASSERT(moved.rangeCuts("ENERGY").size() == 1);
+   CPPUNIT_ASSERT(cuts.size() == 0);
+   CPPUNIT_ASSERT(cuts.gtiCut() == 0);
+
+   dataSubselector::Cuts assigned;
+   assigned.addSkyConeCut(83.57, 22.01, 10.);
+   assigned = std::move(moved);
+   CPPUNIT_ASSERT(assigned.gtiCut() == gti_cut);
+   CPPUNIT_ASSERT(assigned == cuts_copy);
+   CPPUNIT_ASSERT(moved.size() == 0);
+
+// The moved-from objects remain usable.
+   moved.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   CPPUNIT_ASSERT(moved.size() == 1);
+   CPPUNIT_ASSERT(moved.rangeCuts("ENERGY").size() == 1);
+}
+
+void DssTests::test_SchemaCuts() {
+   dataSubselector::Gti gti;
+   gti.insertInterval(100., 200.);
+
+   dataSubselector::Cuts cuts;
+   cuts.addSkyConeCut(83.57, 22.01, 10.);
+   cuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cuts.addGtiCut(gti);
+   cuts.addBitMaskCut("EVENT_CLASS", 128, "P8R2");
+   cuts.addVersionCut("IRF_VERSION", "V6");
+   cuts.addRangeCut("ZENITH_ANGLE", "deg", 0., 90.);
+
+// ZENITH_ANGLE is absent, so that cut is passed.
+   dataSubselector::ColumnSchema schema;
+   unsigned int energy = schema.addColumn("ENERGY");
+   unsigned int time = schema.addColumn("TIME");
+   unsigned int ra = schema.addColumn("RA");
+   unsigned int dec = schema.addColumn("DEC");
+   unsigned int evclass = schema.addColumn("EVENT_CLASS");
+   CPPUNIT_ASSERT(schema.addColumn("ENERGY") == energy);
+   CPPUNIT_ASSERT(schema.size() == 5);
+
+   dataSubselector::SchemaCuts schema_cuts(cuts, schema);
+
+   const size_t nevents(5);
+   double values[nevents][5] = {{200., 150., 83., 22., 128.},
+                                {50., 150., 83., 22., 128.},
+                                {200., 250., 83., 22., 128.},
+                                {200., 150., 120., 22., 128.},
+                                {200., 150., 83., 22., 64.}};
+   std::vector<std::vector<double> > columns(schema.size(),
+                                             std::vector<double>(nevents));
+   std::vector<const double *> column_ptrs(schema.size());
+   for (size_t j(0); j < schema.size(); j++) {
+      for (size_t i(0); i < nevents; i++) {
+         columns[j][i] = values[i][j];
+      }
+      column_ptrs[j] = &columns[j][0];
+   }
+   std::vector<char> accepted;
+   schema_cuts.accept(&column_ptrs[0], nevents, accepted);
+   CPPUNIT_ASSERT(accepted.size() == nevents);
+
+   std::map<std::string, double> params;
+   for (size_t i(0); i < nevents; i++) {
+      params["ENERGY"] = values[i][energy];
+      params["TIME"] = values[i][time];
+      params["RA"] = values[i][ra];
+      params["DEC"] = values[i][dec];
+      params["EVENT_CLASS"] = values[i][evclass];
+      bool expected(cuts.accept(params));
+      CPPUNIT_ASSERT(expected == (i == 0));
+      CPPUNIT_ASSERT(schema_cuts.accept(values[i]) == expected);
+      CPPUNIT_ASSERT(static_cast<bool>(accepted[i]) == expected);
+   }
+
+// A cut on a vector element uses the slot of the element, not that
+// of the bare column name.
+   dataSubselector::Cuts vector_cuts;
+   vector_cuts.addRangeCut("CALIB_VERSION", "dimensionless", 1, 1,
+                           dataSubselector::RangeCut::CLOSED, 1);
+   std::vector<std::pair<double, double> > intervals;
+   intervals.push_back(std::make_pair(0., 2.));
+   vector_cuts.addRangeSetCut("CALIB_VERSION", "dimensionless", intervals, 2);
+
+   dataSubselector::ColumnSchema bare_schema;
+   bare_schema.addColumn("CALIB_VERSION");
+   dataSubselector::SchemaCuts bare_cuts(vector_cuts, bare_schema);
+   double bare_value[] = {5.};
+   CPPUNIT_ASSERT(bare_cuts.accept(bare_value));
+
+   dataSubselector::ColumnSchema vector_schema;
+   vector_schema.addColumn("CALIB_VERSION");
+   vector_schema.addColumn("CALIB_VERSION[1]");
+   vector_schema.addColumn("CALIB_VERSION[2]");
+   dataSubselector::SchemaCuts element_cuts(vector_cuts, vector_schema);
+   double element_values[4][3] = {{5., 1., 1.},
+                                  {5., 0., 1.},
+                                  {5., 1., 3.},
+                                  {1., 2., 0.}};
+   for (size_t i(0); i < 4; i++) {
+      std::map<std::string, double> element_params;
+      element_params["CALIB_VERSION"] = element_values[i][0];
+      element_params["CALIB_VERSION[1]"] = element_values[i][1];
+      element_params["CALIB_VERSION[2]"] = element_values[i][2];
+      bool expected(vector_cuts.accept(element_params));
+      CPPUNIT_ASSERT(expected == (i == 0));
+      CPPUNIT_ASSERT(element_cuts.accept(element_values[i]) == expected);
+   }
+}
+
+void DssTests::test_boundRangeCut() {
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+
+   dataSubselector::RangeCut energy_cut("ENERGY", "MeV", 100., 1e3);
+   dataSubselector::RangeCut calib_cut("CALIB_VERSION", "dimensionless", 
+                                       1, 1, 
+                                       dataSubselector::RangeCut::CLOSED, 1);
+   dataSubselector::RangeCut::Bound energy(energy_cut.bind(*table));
+   dataSubselector::RangeCut::Bound calib(calib_cut.bind(*table));
+
+   tip::Index_t record(0);
+   tip::Table::ConstIterator it(table->begin());
+   for ( ; it != table->end(); ++it, ++record) {
+      tip::ConstTableRecord & row(*it);
+      double value;
+      row["ENERGY"].get(value);
+      CPPUNIT_ASSERT(energy.value(record) == value);
+      CPPUNIT_ASSERT(energy.accept(record) == energy_cut.accept(row));
+      std::vector<double> calib_version;
+      row["CALIB_VERSION"].get(calib_version);
+      CPPUNIT_ASSERT(calib.value(record) == calib_version.at(0));
+      CPPUNIT_ASSERT(calib.accept(record) == calib_cut.accept(row));
+   }
+   CPPUNIT_ASSERT(record == table->getNumRecords());
+}
+
+void DssTests::test_RangeSetCut() {
+   typedef dataSubselector::RangeSetCut::Interval_t Interval_t;
+   std::vector<Interval_t> windows;
+   windows.push_back(Interval_t(0.6, 0.7));
+   windows.push_back(Interval_t(0.1, 0.2));
+   windows.push_back(Interval_t(0.15, 0.3));
+   windows.push_back(Interval_t(0.5, 0.5));
+   dataSubselector::RangeSetCut cut("PULSE_PHASE", "dimensionless", windows);
+
+// Overlapping ranges are merged and the result is sorted.
+   CPPUNIT_ASSERT(cut.intervals().size() == 3);
+   CPPUNIT_ASSERT(cut.intervals()[0] == Interval_t(0.1, 0.3));
+   CPPUNIT_ASSERT(cut.intervals()[1] == Interval_t(0.5, 0.5));
+
+   double values[] = {0.05, 0.1, 0.11, 0.3, 0.35, 0.5, 0.55, 0.7, 0.8};
+   bool expected[] = {false, false, true, true, false, true, false, true,
+                      false};
+   std::map<std::string, double> params;
+   for (size_t i(0); i < sizeof(values)/sizeof(double); i++) {
+      CPPUNIT_ASSERT(cut.accept(values[i]) == expected[i]);
+      params["PULSE_PHASE"] = values[i];
+      CPPUNIT_ASSERT(cut.accept(params) == expected[i]);
+   }
+   CPPUNIT_ASSERT(cut.filterString() == 
+                  "((0.10000000000000000555 < PULSE_PHASE && "
+                  "PULSE_PHASE <= 0.2999999999999999889) || "
+                  "(0.5 <= PULSE_PHASE && PULSE_PHASE <= 0.5) || "
+                  "(0.5999999999999999778 < PULSE_PHASE && "
+                  "PULSE_PHASE <= 0.69999999999999995559))");
+
+// Open-ended ranges.
+   dataSubselector::RangeSetCut bands("ENERGY", "MeV", ":100,1000:3000,1e4:",
+                                      0);
+   CPPUNIT_ASSERT(bands.accept(50.));
+   CPPUNIT_ASSERT(!bands.accept(500.));
+   CPPUNIT_ASSERT(bands.accept(2000.));
+   CPPUNIT_ASSERT(bands.accept(1e5));
+   CPPUNIT_ASSERT(bands.supercedes(
+                     dataSubselector::RangeSetCut("ENERGY", "MeV", 
+                                                  ":1000,1e4:", 0)) == false);
+   CPPUNIT_ASSERT(dataSubselector::RangeSetCut("ENERGY", "MeV", "2000:2500",
+                                               0).supercedes(bands));
+
+// Round trip through the DSS keywords.
+   std::string testfile("dss_range_set.fits");
+   if (st_facilities::Util::fileExists(testfile)) {
+      std::remove(testfile.c_str());
+   }
+   tip::IFileSvc::instance().createFile(testfile, m_infile);
+   tip::Table * table = 
+      tip::IFileSvc::instance().editTable(testfile, "EVENTS");
+// The values are written at 17 significant digits, so the windows
+// above need more than the 68 characters of a header card.
+   dataSubselector::Cuts long_cuts;
+   long_cuts.addRangeSetCut("PULSE_PHASE", "dimensionless", windows);
+   CPPUNIT_ASSERT_THROW(long_cuts.writeDssKeywords(table->getHeader()),
+                        std::runtime_error);
+
+   std::vector<Interval_t> quarters;
+   quarters.push_back(Interval_t(0.125, 0.375));
+   quarters.push_back(Interval_t(0.625, 0.875));
+   dataSubselector::Cuts cuts;
+   cuts.addRangeSetCut("PULSE_PHASE", "dimensionless", quarters);
+   cuts.addCut(bands);
+   cuts.writeDssKeywords(table->getHeader());
+   delete table;
+
+   dataSubselector::Cuts new_cuts(testfile, "EVENTS", false);
+   CPPUNIT_ASSERT(new_cuts.size() == 2);
+   CPPUNIT_ASSERT(new_cuts == cuts);
+   CPPUNIT_ASSERT(new_cuts[0].kind() == dataSubselector::CutBase::RANGE_SET);
+   CPPUNIT_ASSERT(new_cuts.filterString() == cuts.filterString());
+
+// An unbounded interval accepts everything and adds no filter term.
+   const double inf(std::numeric_limits<double>::infinity());
+   std::vector<std::pair<double, double> > everything;
+   everything.push_back(std::make_pair(-inf, inf));
+   dataSubselector::RangeSetCut all_phases("PULSE_PHASE", "dimensionless",
+                                           everything);
+   CPPUNIT_ASSERT(all_phases.filterString() == "");
+   CPPUNIT_ASSERT(all_phases.accept(0.5));
+
+// A RangeSetCut on TIME is a time cut, so it is applied to the GTIs.
+   dataSubselector::RangeSetCut time_windows("TIME", "s", windows);
+   CPPUNIT_ASSERT(dataSubselector::Cuts::isTimeCut(time_windows));
+   CPPUNIT_ASSERT(!dataSubselector::Cuts::isTimeCut(bands));
+}
+
+void DssTests::test_ConeIndex() {
+// Include cones that straddle RA = 0, contain a pole, and overlap.
+   std::vector<dataSubselector::SkyConeCut> cones;
+   cones.push_back(dataSubselector::SkyConeCut(83.63, 22.01, 1.));
+   cones.push_back(dataSubselector::SkyConeCut(359.5, -10., 3.));
+   cones.push_back(dataSubselector::SkyConeCut(120., 85., 10.));
+   cones.push_back(dataSubselector::SkyConeCut(84.5, 22.5, 2.));
+   cones.push_back(dataSubselector::SkyConeCut(200., -60., 20.));
+
+   dataSubselector::ConeIndex index(cones);
+   CPPUNIT_ASSERT(index.numPixels() > 0);
+
+   std::vector<unsigned int> found;
+   size_t ninside(0);
+   size_t noutside(0);
+   for (double dec(-89.95); dec < 90.; dec += 0.1) {
+      for (double ra(0.05); ra < 360.; ra += 0.3) {
+         std::vector<unsigned int> expected;
+         for (unsigned int k(0); k < cones.size(); k++) {
+            if (cones[k].accept(ra, dec)) {
+               expected.push_back(k);
+            }
+         }
+         CPPUNIT_ASSERT(index.accept(ra, dec) == !expected.empty());
+         index.findCones(ra, dec, found);
+         std::sort(found.begin(), found.end());
+         CPPUNIT_ASSERT(found == expected);
+         dataSubselector::ConeIndex::Status status(index.status(ra, dec));
+         if (status == dataSubselector::ConeIndex::INSIDE) {
+            CPPUNIT_ASSERT(!expected.empty());
+            ninside++;
+         } else if (status == dataSubselector::ConeIndex::OUTSIDE) {
+            CPPUNIT_ASSERT(expected.empty());
+            noutside++;
+         }
+      }
+   }
+   CPPUNIT_ASSERT(ninside > 0);
+   CPPUNIT_ASSERT(noutside > 0);
+}
+
+void DssTests::test_TimePlanner() {
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   tip::Index_t nrows(table->getNumRecords());
+   CPPUNIT_ASSERT(dataSubselector::TimePlanner::isSorted(*table));
+
+   std::vector<dataSubselector::TimePlanner::RowRange_t> ranges;
+   dataSubselector::Cuts cuts;
+   dataSubselector::TimePlanner unrestricted(cuts);
+   CPPUNIT_ASSERT(!unrestricted.restricted());
+   unrestricted.rowRanges(*table, ranges);
+   CPPUNIT_ASSERT(ranges.size() == 1);
+   CPPUNIT_ASSERT(ranges[0].first == 0 && ranges[0].second == nrows);
+
+   dataSubselector::Gti gti;
+   gti.insertInterval(0., 1e4);
+   gti.insertInterval(1.5e4, 3e4);
+   gti.insertInterval(3.5e4, 5e4);
+   cuts.addGtiCut(gti);
+   cuts.addRangeCut("TIME", "s", 2e4, 4e4);
+
+   dataSubselector::TimePlanner planner(cuts);
+   CPPUNIT_ASSERT(planner.restricted());
+   CPPUNIT_ASSERT(planner.intervals().size() == 2);
+   CPPUNIT_ASSERT(planner.intervals()[0].first == 2e4);
+   CPPUNIT_ASSERT(planner.intervals()[0].second == 3e4);
+   CPPUNIT_ASSERT(planner.intervals()[1].first == 3.5e4);
+   CPPUNIT_ASSERT(planner.intervals()[1].second == 4e4);
+
+   planner.rowRanges(*table, ranges);
+   CPPUNIT_ASSERT(!ranges.empty());
+   size_t irange(0);
+   tip::Index_t record(0);
+   tip::Table::ConstIterator it(table->begin());
+   for ( ; it != table->end(); ++it, ++record) {
+      double time;
+      (*it)["TIME"].get(time);
+      bool allowed((2e4 <= time && time <= 3e4) ||
+                   (3.5e4 <= time && time <= 4e4));
+      while (irange < ranges.size() && ranges[irange].second <= record) {
+         irange++;
+      }
+      bool planned(irange < ranges.size() && ranges[irange].first <= record);
+      CPPUNIT_ASSERT(allowed == planned);
+      if (cuts.accept(*it)) {
+         CPPUNIT_ASSERT(planned);
+      }
+   }
+}
+
+void DssTests::test_EventIndex() {
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   tip::Index_t nrows(table->getNumRecords());
+
+   dataSubselector::EventIndex index(*table, 50, 5.);
+   CPPUNIT_ASSERT(index.matches(*table));
+   CPPUNIT_ASSERT(index.blocks().size() == size_t((nrows + 49)/50));
+   CPPUNIT_ASSERT(index.rangeColumns().size() == 3);
+
+   std::string indexFile("event_index.fits");
+   index.write(indexFile);
+   dataSubselector::EventIndex readIndex(indexFile);
+   CPPUNIT_ASSERT(readIndex.matches(*table));
+
+// Neither an index nor a selection matches a table without DATASUM.
+   std::string nosumFile("events_nosum.fits");
+   st_facilities::FitsUtil::fcopy(m_infile, nosumFile, m_evtable, "", true);
+   {
+      std::unique_ptr<tip::Table>
+         nosum(tip::IFileSvc::instance().editTable(nosumFile, m_evtable));
+      nosum->getHeader().erase("DATASUM");
+   }
+   {
+      std::unique_ptr<const tip::Table>
+         nosum(tip::IFileSvc::instance().readTable(nosumFile, m_evtable));
+      CPPUNIT_ASSERT(nosum->getNumRecords() == nrows);
+      CPPUNIT_ASSERT(!readIndex.matches(*nosum));
+      dataSubselector::EventIndex nosumIndex(*nosum, 50, 5.);
+      CPPUNIT_ASSERT(!nosumIndex.matches(*nosum));
+      dataSubselector::RowSelection selection(*nosum);
+      CPPUNIT_ASSERT(!selection.matches(*nosum));
+   }
+   std::remove(nosumFile.c_str());
+   CPPUNIT_ASSERT(readIndex.rangeColumns() == index.rangeColumns());
+   CPPUNIT_ASSERT(readIndex.maskColumns() == index.maskColumns());
+   CPPUNIT_ASSERT(readIndex.blocks().size() == index.blocks().size());
+   for (size_t i(0); i < index.blocks().size(); i++) {
+      const dataSubselector::EventIndex::Block & block(index.blocks()[i]);
+      const dataSubselector::EventIndex::Block & 
+         readBlock(readIndex.blocks()[i]);
+      CPPUNIT_ASSERT(readBlock.first == block.first);
+      CPPUNIT_ASSERT(readBlock.nrows == block.nrows);
+      CPPUNIT_ASSERT(readBlock.minValues == block.minValues);
+      CPPUNIT_ASSERT(readBlock.maxValues == block.maxValues);
+      CPPUNIT_ASSERT(readBlock.masks == block.masks);
+      CPPUNIT_ASSERT(readBlock.pixels == block.pixels);
+   }
+   std::remove(indexFile.c_str());
+
+// Every row that passes the cuts must lie in a candidate block, and
+// the TIME cut should exclude some blocks of this time-ordered file.
+   dataSubselector::Cuts cuts;
+   cuts.addRangeCut("TIME", "s", 2e4, 4e4);
+   cuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cuts.addSkyConeCut(83.57, 22.01, 20.);
+   std::vector<dataSubselector::EventIndex::RowRange_t> ranges;
+   readIndex.rowRanges(cuts, ranges);
+   tip::Index_t ncandidates(0);
+   for (size_t i(0); i < ranges.size(); i++) {
+      ncandidates += ranges[i].second - ranges[i].first;
+   }
+   CPPUNIT_ASSERT(ncandidates < nrows);
+
+   size_t irange(0);
+   tip::Index_t record(0);
+   tip::Table::ConstIterator it(table->begin());
+   for ( ; it != table->end(); ++it, ++record) {
+      while (irange < ranges.size() && ranges[irange].second <= record) {
+         irange++;
+      }
+      if (cuts.accept(*it)) {
+         CPPUNIT_ASSERT(irange < ranges.size() &&
+                        ranges[irange].first <= record);
+      }
+   }
+}
+
+void DssTests::test_BoundedQueue() {
+   dataSubselector::BoundedQueue<int> queue(4);
+   CPPUNIT_ASSERT(queue.capacity() == 4);
+
+// The producer runs ahead of the consumer by at most the capacity of
+// the queue, and the items arrive in order.
+   const int nitems(1000);
+   std::thread producer([&queue]() {
+         for (int i(0); i < nitems; i++) {
+            queue.push(i);
+         }
+         queue.close();
+      });
+   int item;
+   int expected(0);
+   while (queue.pop(item)) {
+      CPPUNIT_ASSERT(item == expected);
+      expected++;
+   }
+   producer.join();
+   CPPUNIT_ASSERT(expected == nitems);
+
+// Items cannot be added once the queue is closed.
+   CPPUNIT_ASSERT(!queue.push(0));
+   CPPUNIT_ASSERT(!queue.pop(item));
+
+   CPPUNIT_ASSERT_THROW(dataSubselector::BoundedQueue<int>(0),
+                        std::runtime_error);
+}
+
+void DssTests::test_ChunkScheduler() {
+// Accept the even values of each chunk, and stitch the accepted values
+// together using the prefix sums of the per-chunk counts.  The cost
+// of the chunks varies, so that some of them are stolen.
+   const size_t nchunks(100);
+   const size_t chunkSize(1000);
+   std::vector<size_t> counts(nchunks, 0);
+   std::vector<unsigned int> calls(nchunks, 0);
+   std::vector<std::vector<size_t> > accepted(nchunks);
+   dataSubselector::ChunkScheduler scheduler(4);
+   CPPUNIT_ASSERT(scheduler.numThreads() == 4);
+   scheduler.run(nchunks, [&](size_t chunk, unsigned int thread) {
+         CPPUNIT_ASSERT(thread < 4);
+         calls[chunk]++;
+         size_t step(chunk < nchunks/4 ? 1 : 10);
+         for (size_t i(chunk*chunkSize); i < (chunk + 1)*chunkSize;
+              i += step) {
+            if (i % 2 == 0) {
+               accepted[chunk].push_back(i);
+            }
+         }
+         counts[chunk] = accepted[chunk].size();
+      });
+   for (size_t chunk(0); chunk < nchunks; chunk++) {
+      CPPUNIT_ASSERT(calls[chunk] == 1);
+   }
+
+   std::vector<size_t> offsets;
+   dataSubselector::ChunkScheduler::prefixSums(counts, offsets);
+   CPPUNIT_ASSERT(offsets.size() == nchunks + 1);
+   std::vector<size_t> output(offsets.back());
+   scheduler.run(nchunks, [&](size_t chunk, unsigned int) {
+         std::copy(accepted[chunk].begin(), accepted[chunk].end(),
+                   output.begin() + offsets[chunk]);
+      });
+   for (size_t i(1); i < output.size(); i++) {
+      CPPUNIT_ASSERT(output[i - 1] < output[i]);
+   }
+   CPPUNIT_ASSERT(output.front() == 0);
+   CPPUNIT_ASSERT(output.size() == nchunks/4*chunkSize/2
+                  + (nchunks - nchunks/4)*chunkSize/10);
+
+// Exceptions thrown by a task are passed to the caller.
+   CPPUNIT_ASSERT_THROW(scheduler.run(nchunks, [](size_t chunk, unsigned int) {
+            if (chunk == 50) {
+               throw std::runtime_error("test");
+            }
+         }), std::runtime_error);
+   CPPUNIT_ASSERT_THROW(dataSubselector::ChunkScheduler(0),
+                        std::runtime_error);
+}
+
+void DssTests::test_RowSelection() {
+   dataSubselector::RowSelection rows;
+   rows.addRow(3);
+   rows.addRow(4);
+   rows.addRow(5);
+   rows.addRange(dataSubselector::RowSelection::RowRange_t(6, 10));
+   rows.addRow(20);
+   CPPUNIT_ASSERT(rows.numSelected() == 8);
+   CPPUNIT_ASSERT(rows.ranges().size() == 2);
+   CPPUNIT_ASSERT(rows.ranges()[0].first == 3);
+   CPPUNIT_ASSERT(rows.ranges()[0].second == 10);
+   CPPUNIT_ASSERT(!rows.contains(2));
+   CPPUNIT_ASSERT(rows.contains(3));
+   CPPUNIT_ASSERT(rows.contains(9));
+   CPPUNIT_ASSERT(!rows.contains(10));
+   CPPUNIT_ASSERT(rows.contains(20));
+   CPPUNIT_ASSERT(!rows.contains(21));
+   CPPUNIT_ASSERT_THROW(rows.addRow(15), std::runtime_error);
+
+// The selected rows are those accepted by the cuts.
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   dataSubselector::Cuts cuts;
+   cuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cuts.addSkyConeCut(83.57, 22.01, 20.);
+   dataSubselector::RowSelection selection(cuts.select(*table));
+   CPPUNIT_ASSERT(selection.matches(*table));
+   CPPUNIT_ASSERT(selection.numSelected() > 0);
+   CPPUNIT_ASSERT(selection.numSelected() < table->getNumRecords());
+   tip::Index_t row(0);
+   tip::Table::ConstIterator it(table->begin());
+   for ( ; it != table->end(); ++it, ++row) {
+      CPPUNIT_ASSERT(selection.contains(row) == cuts.accept(*it));
+   }
+
+// Write and read back the selection.
+   std::string selectionFile("row_selection.fits");
+   dataSubselector::Gti gti(m_infile);
+   selection.write(selectionFile, cuts, gti, m_infile, m_evtable);
+   dataSubselector::RowSelection readSelection(selectionFile);
+   CPPUNIT_ASSERT(readSelection.matches(*table));
+   CPPUNIT_ASSERT(readSelection.ranges() == selection.ranges());
+   CPPUNIT_ASSERT(readSelection.numSelected() == selection.numSelected());
+   CPPUNIT_ASSERT(readSelection.sourceFile() == m_infile);
+   CPPUNIT_ASSERT(readSelection.sourceExtension() == m_evtable);
+   dataSubselector::Cuts readCuts(selectionFile, "SELECTION", false);
+   CPPUNIT_ASSERT(readCuts.compareWithoutGtis(cuts));
+   std::remove(selectionFile.c_str());
+}
+
+void DssTests::test_SelectionStore() {
+   typedef dataSubselector::RowSelection::RowRange_t RowRange_t;
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   tip::Index_t nrows(table->getNumRecords());
+
+// Set algebra on selections of the same table.
+   dataSubselector::RowSelection a(*table);
+   a.addRange(RowRange_t(0, 10));
+   a.addRange(RowRange_t(20, 30));
+   dataSubselector::RowSelection b(*table);
+   b.addRange(RowRange_t(5, 25));
+   dataSubselector::RowSelection both(a);
+   both &= b;
+   CPPUNIT_ASSERT(both.numSelected() == 10);
+   CPPUNIT_ASSERT(both.ranges().size() == 2);
+   CPPUNIT_ASSERT(both.contains(5) && !both.contains(10) && both.contains(24));
+   dataSubselector::RowSelection either(a);
+   either |= b;
+   CPPUNIT_ASSERT(either.numSelected() == 30);
+   CPPUNIT_ASSERT(either.ranges().size() == 1);
+   CPPUNIT_ASSERT_THROW(a &= dataSubselector::RowSelection(),
+                        std::runtime_error);
+
+// The first selection stores a selection for each cut.  Changing the
+// sky cone reuses the stored energy selection.
+   dataSubselector::SelectionStore store(".");
+   dataSubselector::Cuts cuts;
+   cuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cuts.addSkyConeCut(83.57, 22.01, 20.);
+   std::vector<unsigned int> cached, uncached;
+   cuts.planSelection(*table, store, cached, uncached);
+   for (size_t i(0); i < uncached.size(); i++) {
+      std::remove(store.fileName(cuts[uncached[i]], *table).c_str());
+   }
+   cuts.planSelection(*table, store, cached, uncached);
+   CPPUNIT_ASSERT(cached.empty() && uncached.size() == 2);
+
+   dataSubselector::RowSelection selection(cuts.select(*table, store));
+   CPPUNIT_ASSERT(selection.ranges() == cuts.select(*table).ranges());
+   cuts.planSelection(*table, store, cached, uncached);
+   CPPUNIT_ASSERT(cached.size() == 2 && uncached.empty());
+   CPPUNIT_ASSERT(cuts.select(*table, store).ranges() == selection.ranges());
+
+// The selections stored in one pass are those of the individual cuts.
+   for (unsigned int i(0); i < cuts.size(); i++) {
+      dataSubselector::Cuts single;
+      single.addCut(cuts[i]);
+      dataSubselector::RowSelection stored;
+      CPPUNIT_ASSERT(store.find(cuts[i], *table, stored));
+      CPPUNIT_ASSERT(stored.ranges() == single.select(*table).ranges());
+   }
+
+   dataSubselector::Cuts newCuts;
+   newCuts.addRangeCut("ENERGY", "MeV", 100., 1e5);
+   newCuts.addSkyConeCut(83.57, 22.01, 10.);
+   newCuts.planSelection(*table, store, cached, uncached);
+   CPPUNIT_ASSERT(cached.size() == 1 && uncached.size() == 1);
+   dataSubselector::RowSelection newSelection(newCuts.select(*table, store,
+                                                             false));
+   CPPUNIT_ASSERT(newSelection.ranges() == newCuts.select(*table).ranges());
+   CPPUNIT_ASSERT(newSelection.numSelected() < selection.numSelected());
+   CPPUNIT_ASSERT(newSelection.numSelected() < nrows);
+
+   for (unsigned int i(0); i < cuts.size(); i++) {
+      std::remove(store.fileName(cuts[i], *table).c_str());
+   }
+
+// GTIs that differ only beyond the precision of their DSS description
+// have different keys.
+   dataSubselector::Gti gti1, gti2;
+   gti1.insertInterval(239557417., 239560000.);
+   gti2.insertInterval(239557417. + 1e-6, 239560000.);
+   dataSubselector::GtiCut gtiCut1(gti1);
+   dataSubselector::GtiCut gtiCut2(gti2);
+   std::ostringstream description1, description2;
+   gtiCut1.writeCut(description1, 1);
+   gtiCut2.writeCut(description2, 1);
+   CPPUNIT_ASSERT(description1.str() == description2.str());
+   CPPUNIT_ASSERT(dataSubselector::SelectionStore::cutKey(gtiCut1)
+                  != dataSubselector::SelectionStore::cutKey(gtiCut2));
+   CPPUNIT_ASSERT(dataSubselector::SelectionStore::cutKey(gtiCut1)
+                  == dataSubselector::SelectionStore::cutKey(
+                     dataSubselector::GtiCut(gti1)));
+}
+
+namespace {
+/// Replace EVENT_ID and RECON_VERSION with values that vary from row
+/// to row, and add 64-bit integer, bit, and scaled integer columns,
+/// so that each encoding decoded by FilterPipeline is present.
+void addPipelineColumns(const std::string & fitsFile,
+                        const std::string & extension) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, fitsFile.c_str(), READWRITE, &status);
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   long nrows(0);
+   fits_get_num_rows(fptr, &nrows, &status);
+   int ncols(0);
+   fits_get_num_cols(fptr, &ncols, &status);
+   int eventIdCol(0), reconCol(0);
+   fits_get_colnum(fptr, CASEINSEN, const_cast<char *>("EVENT_ID"),
+                   &eventIdCol, &status);
+   fits_get_colnum(fptr, CASEINSEN, const_cast<char *>("RECON_VERSION"),
+                   &reconCol, &status);
+   fits_insert_col(fptr, ncols + 1, const_cast<char *>("INDEX64"),
+                   const_cast<char *>("K"), &status);
+   fits_insert_col(fptr, ncols + 2, const_cast<char *>("FLAGS32"),
+                   const_cast<char *>("32X"), &status);
+   fits_insert_col(fptr, ncols + 3, const_cast<char *>("FLAGS12"),
+                   const_cast<char *>("12X"), &status);
+   fits_insert_col(fptr, ncols + 4, const_cast<char *>("SCALED"),
+                   const_cast<char *>("J"), &status);
+   std::ostringstream tscal, tzero;
+   tscal << "TSCAL" << ncols + 4;
+   tzero << "TZERO" << ncols + 4;
+   double scale(0.5), zero(-20.);
+   fits_write_key(fptr, TDOUBLE, tscal.str().c_str(), &scale, 0, &status);
+   fits_write_key(fptr, TDOUBLE, tzero.str().c_str(), &zero, 0, &status);
+   fits_set_hdustruc(fptr, &status);
+   for (long row(0); row < nrows && status == 0; row++) {
+      LONGLONG firstrow(row + 1);
+      int eventId(row);
+      short reconVersion(row % 7 - 3);
+      LONGLONG index64((row - 200)*(1LL << 33));
+      double scaled(0.5*row - 20.);
+// The first bit of a bit column is the most significant.
+      unsigned int flags32(static_cast<unsigned int>(row)*2654435761u);
+      unsigned int flags12(flags32 >> 20);
+      char bits32[32], bits12[12];
+      for (int k(0); k < 32; k++) {
+         bits32[k] = (flags32 >> (31 - k)) & 1;
+      }
+      for (int k(0); k < 12; k++) {
+         bits12[k] = (flags12 >> (11 - k)) & 1;
+      }
+      fits_write_col(fptr, TINT, eventIdCol, firstrow, 1, 1, &eventId,
+                     &status);
+      fits_write_col(fptr, TSHORT, reconCol, firstrow, 1, 1, &reconVersion,
+                     &status);
+      fits_write_col(fptr, TLONGLONG, ncols + 1, firstrow, 1, 1, &index64,
+                     &status);
+      fits_write_col_bit(fptr, ncols + 2, firstrow, 1, 32, bits32, &status);
+      fits_write_col_bit(fptr, ncols + 3, firstrow, 1, 12, bits12, &status);
+      fits_write_col(fptr, TDOUBLE, ncols + 4, firstrow, 1, 1, &scaled,
+                     &status);
+   }
+   fits_close_file(fptr, &status);
+   CPPUNIT_ASSERT(status == 0);
+}
+
+/// Read the raw bytes of all of the rows of a table.
+void readRows(const std::string & fitsFile, const std::string & extension,
+              std::vector<unsigned char> & bytes) {
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, fitsFile.c_str(), READONLY, &status);
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(extension.c_str()),
+                   0, &status);
+   long nrows(0);
+   long rowSize(0);
+   fits_get_num_rows(fptr, &nrows, &status);
+   fits_read_key(fptr, TLONG, "NAXIS1", &rowSize, 0, &status);
+   bytes.resize(static_cast<size_t>(nrows)*rowSize);
+   if (!bytes.empty()) {
+      fits_read_tblbytes(fptr, 1, 1, bytes.size(), &bytes[0], &status);
+   }
+   fits_close_file(fptr, &status);
+   CPPUNIT_ASSERT(status == 0);
+}
+}
+
+void DssTests::test_CompressedTable() {
+   std::string outfile("compressed_events.fits");
+   st_facilities::FitsUtil::fcopy(m_infile, outfile, m_evtable, "", true);
+   CPPUNIT_ASSERT(!dataSubselector::CompressedTable::isCompressed(outfile,
+                                                                 m_evtable));
+   dataSubselector::CompressedTable::compress(outfile, m_evtable);
+   CPPUNIT_ASSERT(dataSubselector::CompressedTable::isCompressed(outfile,
+                                                                m_evtable));
+   {
+      std::unique_ptr<const tip::Table>
+         table(tip::IFileSvc::instance().readTable(outfile, m_evtable));
+      CPPUNIT_ASSERT(dataSubselector::CompressedTable::
+                     isCompressed(table->getHeader()));
+   }
+
+// The header keywords and the other extensions are kept.
+   dataSubselector::Cuts inputCuts(m_infile, m_evtable, false);
+   dataSubselector::Cuts outputCuts(outfile, m_evtable, false);
+   CPPUNIT_ASSERT(outputCuts == inputCuts);
+   CPPUNIT_ASSERT(dataSubselector::Gti(outfile).getNumIntervals() 
+                  == dataSubselector::Gti(m_infile).getNumIntervals());
+
+// The rows are uncompressed a tile at a time.
+   std::unique_ptr<const tip::Table>
+      input(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   tip::Index_t nrows(input->getNumRecords());
+   std::vector<unsigned char> inputBytes;
+   readRows(m_infile, m_evtable, inputBytes);
+   dataSubselector::CompressedTable events(outfile, m_evtable);
+   CPPUNIT_ASSERT(events.compressed());
+   CPPUNIT_ASSERT(events.getNumRecords() == nrows);
+   CPPUNIT_ASSERT(static_cast<size_t>(nrows*events.rowSize()) 
+                  == inputBytes.size());
+   std::vector<unsigned char> bytes(inputBytes.size());
+   events.readRows(0, nrows, &bytes[0]);
+   CPPUNIT_ASSERT(bytes == inputBytes);
+
+   std::vector<double> energies;
+   events.readColumn("ENERGY", 0, nrows, energies);
+   CPPUNIT_ASSERT(static_cast<tip::Index_t>(energies.size()) == nrows);
+   tip::Index_t row(0);
+   tip::Table::ConstIterator it(input->begin());
+   for ( ; it != input->end(); ++it, row++) {
+      double energy;
+      (*it)["ENERGY"].get(energy);
+      CPPUNIT_ASSERT(energies[row] == energy);
+   }
+
+// Cuts select the same rows of the compressed table as of the
+// original, reading only the columns they use.
+   dataSubselector::Cuts cuts;
+   cuts.addRangeCut("ENERGY", "MeV", 1000., 1e5);
+   cuts.addRangeCut("ZENITH_ANGLE", "deg", 0., 90.);
+   cuts.addSkyConeCut(83.57, 22.01, 20.);
+   CPPUNIT_ASSERT(events.schema(cuts).size() == 4);
+   dataSubselector::RowSelection packedSelection(cuts.select(events));
+   dataSubselector::RowSelection inputSelection(cuts.select(*input));
+   CPPUNIT_ASSERT(packedSelection.numSelected() > 0);
+   CPPUNIT_ASSERT(packedSelection.ranges() == inputSelection.ranges());
+
+// Appending the rows that pass a filter expression to an empty copy
+// gives the same rows as cfitsio row filtering of the original table.
+   std::string filterString("ENERGY > 1000 && ZENITH_ANGLE < 90");
+   std::string reference("compressed_reference.fits");
+   std::string filtered("compressed_filtered.fits");
+   st_facilities::FitsUtil::fcopy(m_infile, reference, m_evtable,
+                                  filterString, true);
+   events.createFile(filtered);
+   tip::Index_t nout(events.appendRows(filtered, filterString));
+   std::vector<unsigned char> referenceBytes, filteredBytes;
+   readRows(reference, m_evtable, referenceBytes);
+   readRows(filtered, m_evtable, filteredBytes);
+   CPPUNIT_ASSERT(nout > 0 && nout < nrows);
+   CPPUNIT_ASSERT(static_cast<size_t>(nout*events.rowSize())
+                  == referenceBytes.size());
+   CPPUNIT_ASSERT(filteredBytes == referenceBytes);
+   CPPUNIT_ASSERT(dataSubselector::Cuts(filtered, m_evtable, false) 
+                  == inputCuts);
+   CPPUNIT_ASSERT(dataSubselector::Gti(filtered).getNumIntervals() 
+                  == dataSubselector::Gti(m_infile).getNumIntervals());
+
+// Rows appended to a compressed output are compressed as they are
+// written.  The partial last tile of the first append is completed by
+// the second.
+   std::string appended("compressed_appended.fits");
+   events.createFile(appended);
+   dataSubselector::CompressedTable::compress(appended, m_evtable);
+   tip::Index_t half(nrows/2);
+   {
+      dataSubselector::CompressedTable::Writer output(appended, m_evtable, 7);
+      output.append(&inputBytes[0], half);
+      output.close();
+      CPPUNIT_ASSERT(output.numRecords() == half);
+   }
+   {
+      dataSubselector::CompressedTable::Writer output(appended, m_evtable);
+      CPPUNIT_ASSERT(output.rowSize() == events.rowSize());
+      CPPUNIT_ASSERT(output.numRecords() == half);
+      output.append(&inputBytes[half*events.rowSize()], nrows - half);
+   }
+   dataSubselector::CompressedTable appendedEvents(appended, m_evtable);
+   CPPUNIT_ASSERT(appendedEvents.compressed());
+   CPPUNIT_ASSERT(appendedEvents.getNumRecords() == nrows);
+   appendedEvents.readRows(0, nrows, &bytes[0]);
+   CPPUNIT_ASSERT(bytes == inputBytes);
+   CPPUNIT_ASSERT(dataSubselector::Cuts(appended, m_evtable, false) 
+                  == inputCuts);
+
+// Uncompressed tables are read in place.
+   dataSubselector::CompressedTable uncompressed(m_infile, m_evtable);
+   CPPUNIT_ASSERT(!uncompressed.compressed());
+   CPPUNIT_ASSERT(uncompressed.getNumRecords() == nrows);
+   CPPUNIT_ASSERT(uncompressed.rowSize() == events.rowSize());
+
+   std::remove(outfile.c_str());
+   std::remove(reference.c_str());
+   std::remove(filtered.c_str());
+   std::remove(appended.c_str());
+}
+
+void DssTests::test_SelectionSplitter() {
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+
+// Two ROIs with the same energy cut, so that only the cones differ,
+// and a third selection without a cone.
+   std::vector<dataSubselector::Cuts> selections(2);
+   selections[0].addRangeCut("ENERGY", "MeV", 100., 1e5);
+   selections[0].addSkyConeCut(83.57, 22.01, 20.);
+   selections[1].addRangeCut("ENERGY", "MeV", 100., 1e5);
+   selections[1].addSkyConeCut(83.57, 22.01, 10.);
+   for (size_t nsel(2); nsel <= 3; nsel++) {
+      if (nsel == 3) {
+         selections.push_back(dataSubselector::Cuts());
+         selections[2].addRangeCut("ENERGY", "MeV", 100., 1e5);
+         selections[2].addRangeCut("ZENITH_ANGLE", "deg", 0., 90.);
+      }
+// Grow the outputs in small blocks to exercise the resizing.
+      dataSubselector::SelectionSplitter splitter(selections, 7);
+      CPPUNIT_ASSERT(splitter.size() == nsel);
+      CPPUNIT_ASSERT(splitter.common().size() == 1);
+      CPPUNIT_ASSERT(splitter.residual(0).size() == 1);
+
+      std::vector<std::string> outfiles;
+      std::vector<tip::Table *> outputs;
+      for (size_t k(0); k < nsel; k++) {
+         std::ostringstream outfile;
+         outfile << "split_events_" << k << ".fits";
+         outfiles.push_back(outfile.str());
+         tip::IFileSvc::instance().createFile(outfiles[k], m_infile);
+         outputs.push_back(tip::IFileSvc::instance()
+                           .editTable(outfiles[k], m_evtable));
+      }
+
+// Copy the input twice, as for two input files.
+      std::vector<tip::Index_t> nrows(nsel, 0);
+      for (size_t ifile(0); ifile < 2; ifile++) {
+         std::unique_ptr<const tip::Table>
+            input(tip::IFileSvc::instance()
+                  .readTable(m_infile, m_evtable, splitter.filterString()));
+         splitter.copyRows(*input, outputs, nrows);
+      }
+
+// The same rows are appended as raw bytes to compressed outputs, in
+// tiles that do not line up with the input blocks.
+      dataSubselector::CompressedTable input(m_infile, m_evtable);
+      std::vector<std::string> packedFiles;
+      std::vector<std::unique_ptr<dataSubselector::CompressedTable::Writer> >
+         writers;
+      std::vector<dataSubselector::CompressedTable::Writer *> packed;
+      for (size_t k(0); k < nsel; k++) {
+         std::ostringstream packedFile;
+         packedFile << "split_packed_" << k << ".fits";
+         packedFiles.push_back(packedFile.str());
+         input.createFile(packedFiles[k]);
+         dataSubselector::CompressedTable::compress(packedFiles[k], m_evtable);
+         writers.push_back(std::unique_ptr<dataSubselector::CompressedTable::
+                           Writer>(new dataSubselector::CompressedTable::
+                                   Writer(packedFiles[k], m_evtable, 5)));
+         packed.push_back(writers.back().get());
+      }
+      for (size_t ifile(0); ifile < 2; ifile++) {
+         splitter.appendRows(input, splitter.filterString(), packed);
+      }
+
+      for (size_t k(0); k < nsel; k++) {
+         dataSubselector::RowSelection selected(selections[k].select(*table));
+         CPPUNIT_ASSERT(selected.numSelected() > 0);
+         CPPUNIT_ASSERT(nrows[k] == 2*selected.numSelected());
+         CPPUNIT_ASSERT(outputs[k]->getNumRecords() == nrows[k]);
+         const tip::Table & output(*outputs[k]);
+         tip::Table::ConstIterator it(output.begin());
+         for ( ; it != output.end(); ++it) {
+            CPPUNIT_ASSERT(selections[k].accept(*it));
+         }
+         delete outputs[k];
+
+         writers[k]->close();
+         CPPUNIT_ASSERT(writers[k]->numRecords() == nrows[k]);
+         std::vector<unsigned char> outputBytes;
+         readRows(outfiles[k], m_evtable, outputBytes);
+         dataSubselector::CompressedTable packedTable(packedFiles[k],
+                                                      m_evtable);
+         CPPUNIT_ASSERT(packedTable.compressed());
+         CPPUNIT_ASSERT(packedTable.getNumRecords() == nrows[k]);
+         std::vector<unsigned char> packedBytes(outputBytes.size());
+         packedTable.readRows(0, nrows[k], &packedBytes[0]);
+         CPPUNIT_ASSERT(packedBytes == outputBytes);
+         std::remove(outfiles[k].c_str());
+         std::remove(packedFiles[k].c_str());
+      }
+   }
+}
+
+void DssTests::test_FilterPipeline() {
+   typedef dataSubselector::FilterPipeline::RowRange_t RowRange_t;
+   std::string infile("pipeline_events.fits");
+   std::string reference("pipeline_reference.fits");
+   std::string outfile("pipeline_output.fits");
+   st_facilities::FitsUtil::fcopy(m_infile, infile, m_evtable, "", true);
+   addPipelineColumns(infile, m_evtable);
+   tip::Index_t nrows;
+   {
+      std::unique_ptr<const tip::Table>
+         table(tip::IFileSvc::instance().readTable(infile, m_evtable));
+      nrows = table->getNumRecords();
+   }
+
+// Cuts on the float (E), double (D), and sky position columns, as for
+// a typical selection, on the 32- (J), 16- (I), and 64-bit (K)
+// integer columns, and on the bit (X) and scaled integer columns.
+   std::vector<dataSubselector::Cuts> cutSets(3);
+   cutSets[0].addRangeCut("ENERGY", "MeV", 100., 1e5);
+   cutSets[0].addRangeCut("ZENITH_ANGLE", "deg", 0., 90.);
+   cutSets[0].addRangeCut("TIME", "s", 2e4, 6e4);
+   cutSets[0].addSkyConeCut(83.57, 22.01, 20.);
+   cutSets[1].addRangeCut("EVENT_ID", "", 100., 350.);
+   cutSets[1].addRangeCut("RECON_VERSION", "", -2., 1.);
+   cutSets[1].addRangeCut("INDEX64", "", -50.*(1LL << 33), 100.*(1LL << 33));
+   cutSets[2].addRangeCut("SCALED", "", 10., 80.);
+   cutSets[2].addBitMaskCut("FLAGS32", 1 << 5, "P8R2");
+   cutSets[2].addBitMaskCut("FLAGS12", 1 << 3, "P8R2");
+
+// All of the rows, and two ranges of them, as given by an index.
+   std::vector<std::vector<RowRange_t> > rangeSets(2);
+   rangeSets[0].push_back(RowRange_t(0, nrows));
+   rangeSets[1].push_back(RowRange_t(0, 100));
+   rangeSets[1].push_back(RowRange_t(250, nrows));
+   std::vector<std::string> rangeFilters;
+   rangeFilters.push_back("");
+   rangeFilters.push_back(" && (#ROW <= 100 || #ROW > 250)");
+
+   for (size_t i(0); i < cutSets.size(); i++) {
+      for (size_t j(0); j < rangeSets.size(); j++) {
+// The reference output is made by cfitsio's row filtering.
+         std::string filterString(cutSets[i].filterString()
+                                  + " && gtifilter()" + rangeFilters[j]);
+         st_facilities::FitsUtil::fcopy(infile, reference, m_evtable,
+                                        filterString, true);
+         std::vector<unsigned char> expected;
+         readRows(reference, m_evtable, expected);
+         CPPUNIT_ASSERT(!expected.empty());
+
+// Small chunks, so that several are in flight at once.
+         dataSubselector::FilterPipeline pipeline(infile, m_evtable,
+                                                  cutSets[i], 3, 37);
+         CPPUNIT_ASSERT(pipeline.supported());
+         for (size_t chunked(0); chunked < 2; chunked++) {
+            std::remove(outfile.c_str());
+            tip::IFileSvc::instance().createFile(outfile, infile);
+            tip::Index_t nout(chunked ?
+                              pipeline.runChunked(rangeSets[j], outfile) :
+                              pipeline.run(rangeSets[j], outfile));
+            CPPUNIT_ASSERT(nout > 0 && nout < nrows);
+            std::vector<unsigned char> output;
+            readRows(outfile, m_evtable, output);
+            CPPUNIT_ASSERT(output.size() == expected.size());
+            CPPUNIT_ASSERT(output == expected);
+
+// Appending to a table that already has rows returns only the
+// number of rows added.
+            CPPUNIT_ASSERT(pipeline.run(rangeSets[j], outfile) == nout);
+            readRows(outfile, m_evtable, output);
+            CPPUNIT_ASSERT(output.size() == 2*expected.size());
+         }
+      }
+   }
+   std::remove(infile.c_str());
+   std::remove(reference.c_str());
+   std::remove(outfile.c_str());
+}
+
+void DssTests::test_ColumnProjection() {
+   std::vector<std::string> colnames;
+   dataSubselector::ColumnProjection::parseColumns("all", colnames);
+   CPPUNIT_ASSERT(colnames.empty());
+   CPPUNIT_ASSERT(!dataSubselector::ColumnProjection(m_infile, m_evtable,
+                                                     colnames).active());
+   dataSubselector::ColumnProjection::parseColumns("time, energy ra,DEC "
+                                                   "EVENT_ID", colnames);
+   CPPUNIT_ASSERT(colnames.size() == 5);
+   colnames.push_back("NO_SUCH_COLUMN");
+   CPPUNIT_ASSERT_THROW(dataSubselector::ColumnProjection(m_infile, m_evtable,
+                                                          colnames),
+                        std::runtime_error);
+   colnames.pop_back();
+
+// The columns of the range cuts written to the outputs are kept, once
+// each, whether or not they were requested.
+   dataSubselector::Cuts inputCuts(m_infile, m_evtable);
+   dataSubselector::Cuts cuts(inputCuts);
+   cuts.addRangeCut("ZENITH_ANGLE", "deg", 0, 100);
+   dataSubselector::ColumnProjection::addCutColumns(cuts, colnames);
+   CPPUNIT_ASSERT(colnames.size() == 6);
+   CPPUNIT_ASSERT(colnames.back() == "ZENITH_ANGLE");
+
+   dataSubselector::ColumnProjection projection(m_infile, m_evtable,
+                                                colnames);
+   CPPUNIT_ASSERT(projection.active());
+   CPPUNIT_ASSERT(projection.outputRowSize() == 4 + 4 + 4 + 4 + 8 + 4);
+
+// The columns are removed from the empty output tables.  The rows
+// are then written as projected raw bytes, as by gtselect for a
+// single input file, or copied by tip, as for several input files.
+   std::string rawfile("projected_raw.fits");
+   std::string tipfile("projected_tip.fits");
+   std::vector<std::string> outfiles;
+   outfiles.push_back(rawfile);
+   outfiles.push_back(tipfile);
+   for (size_t i(0); i < outfiles.size(); i++) {
+      std::remove(outfiles[i].c_str());
+      tip::IFileSvc::instance().createFile(outfiles[i], m_infile);
+      projection.removeColumns(outfiles[i], m_evtable);
+      std::unique_ptr<tip::Table>
+         output(tip::IFileSvc::instance().editTable(outfiles[i], m_evtable));
+      cuts.writeDssKeywords(output->getHeader());
+   }
+
+   std::vector<unsigned char> bytes;
+   readRows(m_infile, m_evtable, bytes);
+   long nrows(bytes.size()/projection.inputRowSize());
+   projection.project(&bytes[0], nrows, &bytes[0]);
+   int status(0);
+   fitsfile * fptr(0);
+   fits_open_file(&fptr, rawfile.c_str(), READWRITE, &status);
+   fits_movnam_hdu(fptr, BINARY_TBL, const_cast<char *>(m_evtable.c_str()),
+                   0, &status);
+   fits_insert_rows(fptr, 0, nrows, &status);
+   fits_write_tblbytes(fptr, 1, 1, static_cast<LONGLONG>(nrows)
+                       *projection.outputRowSize(), &bytes[0], &status);
+   fits_close_file(fptr, &status);
+   CPPUNIT_ASSERT(status == 0);
+
+   std::unique_ptr<const tip::Table>
+      input(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   {
+      std::unique_ptr<tip::Table>
+         output(tip::IFileSvc::instance().editTable(tipfile, m_evtable));
+      output->setNumRecords(input->getNumRecords());
+      tip::Table::Iterator outputIt(output->begin());
+      tip::Table::ConstIterator inputIt(input->begin());
+      for ( ; inputIt != input->end(); ++inputIt, ++outputIt) {
+         *outputIt = *inputIt;
+      }
+   }
+
+   dataSubselector::Gti inputGti(m_infile);
+   const char * kept[] = {"ENERGY", "RA", "DEC", "ZENITH_ANGLE", "TIME",
+                          "EVENT_ID"};
+   for (size_t i(0); i < outfiles.size(); i++) {
+// The kept columns, in their original order.
+      dataSubselector::RowLayout layout(outfiles[i], m_evtable);
+      CPPUNIT_ASSERT(layout.fields().size() == 6);
+      CPPUNIT_ASSERT(layout.rowSize() == projection.outputRowSize());
+      for (size_t j(0); j < layout.fields().size(); j++) {
+         CPPUNIT_ASSERT(layout.fields()[j].name == kept[j]);
+      }
+      std::unique_ptr<const tip::Table>
+         output(tip::IFileSvc::instance().readTable(outfiles[i], m_evtable));
+      CPPUNIT_ASSERT(output->getNumRecords() == input->getNumRecords());
+      tip::Table::ConstIterator inputIt(input->begin());
+      tip::Table::ConstIterator outputIt(output->begin());
+      for ( ; inputIt != input->end(); ++inputIt, ++outputIt) {
+         for (size_t j(0); j < 6; j++) {
+            double inputValue, outputValue;
+            (*inputIt)[kept[j]].get(inputValue);
+            (*outputIt)[kept[j]].get(outputValue);
+            CPPUNIT_ASSERT(outputValue == inputValue);
+         }
+      }
+// The DSS keywords and GTIs are kept, and the columns of the range
+// cuts are found when the DSS keywords are read.
+      dataSubselector::Cuts outputCuts(outfiles[i], m_evtable);
+      CPPUNIT_ASSERT(outputCuts == cuts);
+      CPPUNIT_ASSERT(!(dataSubselector::Gti(outfiles[i]) != inputGti));
+      std::remove(outfiles[i].c_str());
+   }
+}
+
+void DssTests::test_CutController() {
+// Controllers built from parameter maps are independent, so several
+// selections can be prepared in one process.
+   std::vector<std::string> evfiles(1, m_infile);
+   dataSubselector::CutController::ParMap lowPars;
+   lowPars["emin"] = 30;
+   lowPars["emax"] = 1000;
+   dataSubselector::CutController::ParMap highPars;
+   highPars["emin"] = 1000;
+   highPars["emax"] = 200000;
+   highPars["zmax"] = 100;
+   dataSubselector::CutController low(lowPars, evfiles, m_evtable);
+   dataSubselector::CutController high(highPars, evfiles, m_evtable);
+
+   const std::vector<dataSubselector::RangeCut *> &
+      lowEnergy(low.cuts().rangeCuts("ENERGY"));
+   CPPUNIT_ASSERT(lowEnergy.size() == 1);
+   CPPUNIT_ASSERT(lowEnergy[0]->minVal() == 30);
+   CPPUNIT_ASSERT(lowEnergy[0]->maxVal() == 1000);
+   const std::vector<dataSubselector::RangeCut *> &
+      highEnergy(high.cuts().rangeCuts("ENERGY"));
+   CPPUNIT_ASSERT(highEnergy.size() == 1);
+   CPPUNIT_ASSERT(highEnergy[0]->minVal() == 1000);
+   CPPUNIT_ASSERT(highEnergy[0]->maxVal() == 200000);
+   CPPUNIT_ASSERT(low.cuts().rangeCuts("ZENITH_ANGLE").empty());
+   CPPUNIT_ASSERT(high.cuts().rangeCuts("ZENITH_ANGLE").size() == 1);
+
+// Building another controller leaves the others unchanged.
+   dataSubselector::CutController low2(lowPars, evfiles, m_evtable);
+   CPPUNIT_ASSERT(low2.cuts() == low.cuts());
+   CPPUNIT_ASSERT(!(high.cuts() == low.cuts()));
+
+   std::unique_ptr<const tip::Table>
+      table(tip::IFileSvc::instance().readTable(m_infile, m_evtable));
+   size_t nlow(0), nhigh(0);
+   for (tip::Table::ConstIterator it(table->begin());
+        it != table->end(); ++it) {
+      double energy, zenith;
+      (*it)["ENERGY"].get(energy);
+      (*it)["ZENITH_ANGLE"].get(zenith);
+      bool lowAccepted(low.accept(*it));
+      bool highAccepted(high.accept(*it));
+      CPPUNIT_ASSERT(!lowAccepted || energy <= 1000);
+      CPPUNIT_ASSERT(!highAccepted || (energy >= 1000 && zenith <= 100));
+      nlow += lowAccepted;
+      nhigh += highAccepted;
+   }
+   CPPUNIT_ASSERT(nlow > 0);
+   CPPUNIT_ASSERT(nhigh > 0);
+}
+
 int main(int iargc, char * argv[]) {
 
    if (iargc > 1 && std::string(argv[1]) == "-d") {